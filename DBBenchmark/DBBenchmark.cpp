@@ -0,0 +1,154 @@
+/**
+ * Kommandozeilenprogramm zu DBMyBenchmark: fuehrt die Microbenchmarks aus und schreibt das
+ * Ergebnis von run() als JSON auf stdout, Meldungen (ab WARN) auf stderr.
+ *
+ * Aufruf: DBBenchmark [-T Typen] [-t Threads] [-p Pufferbloecke] [-i Indexpufferbloecke]
+ *                     [-k Schluessel] [-d Duplikate] [-l Suchen] [-r Bereichslaenge]
+ *                     [-f Dateibloecke] [-s Seed]
+ * Listen durch Kommas getrennt, z.B. -T INT,VCHAR -t 1,2,4; sonst die Voreinstellung von
+ * DBMyBenchmark::Config. Die Dateien der Laeufe werden im aktuellen Verzeichnis angelegt und
+ * danach geloescht.
+ */
+
+
+#include <hubDB/DBMyBenchmark.h>
+#include <hubDB/DBException.h>
+#include <log4cxx/basicconfigurator.h>
+#include <log4cxx/consoleappender.h>
+#include <log4cxx/simplelayout.h>
+#include <log4cxx/level.h>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+using namespace HubDB::Index;
+using namespace HubDB::Exception;
+using namespace log4cxx;
+
+/**
+ * Dateien ueber den Puffermanager des Laufs; Reste eines abgebrochenen Laufs werden ersetzt
+ */
+class BenchmarkFiles : public DBMyBenchmarkFiles {
+public:
+    DBFile &create(DBBufferMgr &bufMgr, const string &name) {
+        try {
+            bufMgr.dropFile(name);
+        } catch (DBException &e) {}
+        bufMgr.createFile(name);
+        return bufMgr.openFile(name);
+    }
+
+    void drop(DBBufferMgr &bufMgr, DBFile &file) {
+        string name = file.getFileName();
+        bufMgr.closeFile(file);
+        bufMgr.dropFile(name);
+    }
+};
+
+/**
+ * Durch Kommas getrennte Liste aus arg; false bei einem Eintrag, der keine Zahl > 0 ist
+ */
+static bool parse_numbers(const string &arg, vector<uint> &numbers) {
+    numbers.clear();
+    stringstream ss(arg);
+    string item;
+    while (getline(ss, item, ',')) {
+        char *end;
+        unsigned long n = strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || n == 0)
+            return false;
+        numbers.push_back(n);
+    }
+    return numbers.empty() == false;
+}
+
+static bool parse_number(const string &arg, uint &number) {
+    vector<uint> numbers;
+    if (parse_numbers(arg, numbers) == false || numbers.size() != 1)
+        return false;
+    number = numbers[0];
+    return true;
+}
+
+static bool parse_types(const string &arg, vector<AttrTypeEnum> &types) {
+    types.clear();
+    stringstream ss(arg);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item == "INT")
+            types.push_back(INT);
+        else if (item == "DOUBLE")
+            types.push_back(DOUBLE);
+        else if (item == "VCHAR")
+            types.push_back(VCHAR);
+        else
+            return false;
+    }
+    return types.empty() == false;
+}
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-T INT,DOUBLE,VCHAR] [-t threads,...] [-p poolBlocks,...]"
+         << " [-i indexPoolBlocks] [-k keys] [-d duplicates] [-l lookups] [-r scanLength]"
+         << " [-f fileBlocks] [-s seed]" << endl;
+}
+
+int main(int argc, char **argv) {
+    AppenderPtr appender(new ConsoleAppender(LayoutPtr(new SimpleLayout()), ConsoleAppender::getSystemErr()));
+    BasicConfigurator::configure(appender);
+    Logger::getRootLogger()->setLevel(Level::getWarn());
+
+    DBMyBenchmark::Config config;
+    int opt;
+    bool ok = true;
+    while (ok && (opt = getopt(argc, argv, "T:t:p:i:k:d:l:r:f:s:")) != -1) {
+        switch (opt) {
+            case 'T':
+                ok = parse_types(optarg, config.types);
+                break;
+            case 't':
+                ok = parse_numbers(optarg, config.threads);
+                break;
+            case 'p':
+                ok = parse_numbers(optarg, config.poolSizes);
+                break;
+            case 'i':
+                ok = parse_number(optarg, config.indexPoolBlocks);
+                break;
+            case 'k':
+                ok = parse_number(optarg, config.keys);
+                break;
+            case 'd':
+                ok = parse_number(optarg, config.duplicates);
+                break;
+            case 'l':
+                ok = parse_number(optarg, config.lookups);
+                break;
+            case 'r':
+                ok = parse_number(optarg, config.scanLength);
+                break;
+            case 'f':
+                ok = parse_number(optarg, config.fileBlocks);
+                break;
+            case 's':
+                ok = parse_number(optarg, config.seed);
+                break;
+            default:
+                ok = false;
+        }
+    }
+    if (ok == false || optind != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        BenchmarkFiles files;
+        DBMyBenchmark benchmark(files, config);
+        cout << benchmark.run() << endl;
+    } catch (DBException &e) {
+        cerr << "benchmark failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * Microbenchmarks fuer DBMyIndex, DBMyHashIndex und DBMyBufferMgr, um Regressionen in fixBlock,
+ * find und insert zu messen. Je Attributtyp und Threadanzahl:
+ * - insert_random, insert_sequential: config.keys Schluessel in zufaelliger bzw. aufsteigender
+ *   Reihenfolge in einen eindeutigen Index
+ * - insert_duplicates: ebenso viele Eintraege, je Schluessel config.duplicates TIDs
+ *   (nicht eindeutiger Index)
+ * - find_point: Suche zufaelliger vorhandener Schluessel im Index aus insert_random
+ * - scan_range: findBatch() ueber config.scanLength aufeinanderfolgende Schluessel ab einem
+ *   zufaelligen Schluessel (DBMyIndex hat keine eigene Bereichssuche)
+ * - hash_insert_random, hash_find_point: wie insert_random und find_point, aber mit einem
+ *   eindeutigen DBMyHashIndex (Vergleich der Gleichheitssuche mit DBMyIndex)
+ * Je Puffergroesse und Threadanzahl:
+ * - fix_unfix: fixBlock/unfixBlock zufaelliger Bloecke einer Datei mit config.fileBlocks Bloecken
+ *
+ * Die Threads eines Laufs teilen sich Index bzw. Puffer, jeder bearbeitet seinen Anteil.
+ * Gemessen wird vom Start bis zum Ende des letzten Threads; Schluessel werden vorher erzeugt.
+ * run() liefert alle Ergebnisse als JSON, z.B.
+ *   {"benchmark": "DBMyIndex", "config": {...}, "results": [{"name": "find_point",
+ *    "type": "INT", "threads": 4, "poolBlocks": 1024, "operations": 400000,
+ *    "seconds": 0.21, "opsPerSecond": 1904761.9, "nsPerOp": 525.0}, ...]}
+ * Bei fix_unfix fehlt "type", bei scan_range zaehlt jede Bereichssuche als eine Operation.
+ */
+
+
+#include <hubDB/DBMyBenchmark.h>
+#include <hubDB/DBMyBufferMgr.h>
+#include <hubDB/DBException.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <system_error>
+
+using namespace HubDB::Index;
+using namespace HubDB::Manager;
+using namespace HubDB::Exception;
+
+LoggerPtr DBMyBenchmark::logger(Logger::getLogger("HubDB.Index.DBMyBenchmark"));
+
+/**
+ * Voreinstellung: alle Attributtypen, 1 und 4 Threads, 100000 Schluessel
+ */
+DBMyBenchmark::Config::Config() :
+        indexPoolBlocks(1024), keys(100000), duplicates(16), lookups(100000), scanLength(100),
+        fileBlocks(4096), seed(1) {
+    types.push_back(INT);
+    types.push_back(DOUBLE);
+    types.push_back(VCHAR);
+    threads.push_back(1);
+    threads.push_back(4);
+    poolSizes.push_back(64);
+    poolSizes.push_back(1024);
+}
+
+/** Konstruktor
+ * - DBMyBenchmarkFiles & files (legt die Dateien der Laeufe an und loescht sie wieder)
+ * - const Config & config (Umfang der Laeufe)
+ */
+DBMyBenchmark::DBMyBenchmark(DBMyBenchmarkFiles &files, const Config &config) :
+        files(files), config(config) {
+    if (logger != NULL) {
+        LOG4CXX_INFO(logger, "DBMyBenchmark()");
+    }
+    if (config.keys == 0 || config.duplicates == 0 || config.scanLength == 0 || config.fileBlocks == 0)
+        throw DBException("benchmark sizes must not be 0");
+}
+
+/**
+ * Fuehrt alle Laeufe aus und gibt die Ergebnisse als JSON zurueck
+ */
+string DBMyBenchmark::run() {
+    LOG4CXX_INFO(logger, "run()");
+
+    results.clear();
+    for (uint t = 0; t < config.types.size(); ++t) {
+        for (uint i = 0; i < config.threads.size(); ++i) {
+            index_runs(config.types[t], max(config.threads[i], 1u));
+            hash_runs(config.types[t], max(config.threads[i], 1u));
+        }
+    }
+    for (uint p = 0; p < config.poolSizes.size(); ++p) {
+        for (uint i = 0; i < config.threads.size(); ++i)
+            buffer_run(config.poolSizes[p], max(config.threads[i], 1u));
+    }
+    return to_json();
+}
+
+/**
+ * Einfuege-, Such- und Bereichslaeufe fuer einen Attributtyp; jeder Einfuegelauf beginnt mit
+ * einem leeren Index in einem eigenen Puffer
+ */
+void DBMyBenchmark::index_runs(AttrTypeEnum type, uint threads) {
+    workload inserts[] = {INSERT_RANDOM, INSERT_SEQUENTIAL, INSERT_DUPLICATES};
+    mt19937 random(config.seed);
+    for (uint i = 0; i < sizeof(inserts) / sizeof(inserts[0]); ++i) {
+        DBMyBufferMgr bufMgr(threads > 1, config.indexPoolBlocks);
+        run_state state;
+        state.kind = inserts[i];
+        state.bufMgr = &bufMgr;
+        state.threads = threads;
+        state.index = NULL;
+        //Eintrag i fuegt Schluessel order[i] % keys.size() mit TID order[i] ein
+        uint distinct = state.kind == INSERT_DUPLICATES ? max(config.keys / config.duplicates, 1u) : config.keys;
+        for (uint k = 0; k < distinct; ++k)
+            state.keys.push_back(make_key(type, k));
+        for (uint k = 0; k < config.keys; ++k)
+            state.order.push_back(k);
+        if (state.kind != INSERT_SEQUENTIAL)
+            shuffle(state.order.begin(), state.order.end(), random);
+
+        state.file = &files.create(bufMgr, string("benchmark_") + workloadName(state.kind) + "_" + typeName(type)
+                                           + "_" + TO_STR(threads));
+        try {
+            state.index = new DBMyIndex(bufMgr, *state.file, type, WRITE, state.kind != INSERT_DUPLICATES);
+            measure(state, type, config.indexPoolBlocks, config.keys);
+            if (state.kind == INSERT_RANDOM) {
+                state.kind = FIND_POINT;
+                measure(state, type, config.indexPoolBlocks, (unsigned long) config.lookups * threads);
+                state.kind = SCAN_RANGE;
+                measure(state, type, config.indexPoolBlocks,
+                        (unsigned long) max(config.lookups / config.scanLength, 1u) * threads);
+            }
+        } catch (DBException &e) {
+            release(state);
+            throw;
+        }
+        release(state);
+    }
+}
+
+/**
+ * Einfuege- und Suchlauf mit DBMyHashIndex; Schluessel und Reihenfolge wie bei insert_random
+ */
+void DBMyBenchmark::hash_runs(AttrTypeEnum type, uint threads) {
+    mt19937 random(config.seed);
+    DBMyBufferMgr bufMgr(threads > 1, config.indexPoolBlocks);
+    run_state state;
+    state.kind = HASH_INSERT_RANDOM;
+    state.bufMgr = &bufMgr;
+    state.threads = threads;
+    state.index = NULL;
+    for (uint k = 0; k < config.keys; ++k) {
+        state.keys.push_back(make_key(type, k));
+        state.order.push_back(k);
+    }
+    shuffle(state.order.begin(), state.order.end(), random);
+
+    state.file = &files.create(bufMgr, string("benchmark_hash_") + typeName(type) + "_" + TO_STR(threads));
+    try {
+        for (uint part = 0; part < threads; ++part)
+            state.hashIndexes.push_back(new DBMyHashIndex(bufMgr, *state.file, type, WRITE, true));
+        measure(state, type, config.indexPoolBlocks, config.keys);
+        state.kind = HASH_FIND_POINT;
+        measure(state, type, config.indexPoolBlocks, (unsigned long) config.lookups * threads);
+    } catch (DBException &e) {
+        release(state);
+        throw;
+    }
+    release(state);
+}
+
+/**
+ * fix/unfix-Lauf mit poolBlocks Pufferbloecken
+ */
+void DBMyBenchmark::buffer_run(uint poolBlocks, uint threads) {
+    DBMyBufferMgr bufMgr(threads > 1, poolBlocks);
+    run_state state;
+    state.kind = FIX_UNFIX;
+    state.bufMgr = &bufMgr;
+    state.threads = threads;
+    state.index = NULL;
+    state.file = &files.create(bufMgr, "benchmark_fix_unfix_" + TO_STR(poolBlocks) + "_" + TO_STR(threads));
+    try {
+        for (uint b = 0; b < config.fileBlocks; ++b) {
+            DBBACB bacb = state.bufMgr->fixNewBlock(*state.file);
+            bacb.setModified();
+            state.bufMgr->unfixBlock(bacb);
+        }
+        measure(state, INT, poolBlocks, (unsigned long) config.lookups * threads);
+    } catch (DBException &e) {
+        release(state);
+        throw;
+    }
+    release(state);
+}
+
+/**
+ * Gibt Index, Datei und Schluessel eines Laufs frei
+ */
+void DBMyBenchmark::release(run_state &state) {
+    if (state.index != NULL)
+        delete state.index;
+    state.index = NULL;
+    for (uint i = 0; i < state.hashIndexes.size(); ++i)
+        delete state.hashIndexes[i];
+    state.hashIndexes.clear();
+    files.drop(*state.bufMgr, *state.file);
+    for (uint i = 0; i < state.keys.size(); ++i)
+        delete state.keys[i];
+    state.keys.clear();
+}
+
+/**
+ * Misst state.kind mit state.threads Threads: der Aufrufer bearbeitet Anteil 0, die uebrigen je
+ * ein eigener Thread. Laesst sich ein Thread nicht starten, uebernimmt der Aufrufer dessen Anteil;
+ * das Ergebnis nennt die Anzahl der tatsaechlich gelaufenen Threads.
+ */
+void DBMyBenchmark::measure(run_state &state, AttrTypeEnum type, uint poolBlocks, unsigned long operations) {
+    LOG4CXX_DEBUG(logger, string("measure ") + workloadName(state.kind) + " threads: " + TO_STR(state.threads));
+
+    state.error = NULL;
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (uint part = 1; part < state.threads; ++part) {
+        try {
+            workers.push_back(thread(&DBMyBenchmark::worker, this, std::ref(state), part));
+        } catch (system_error &e) {
+            LOG4CXX_WARN(logger, "could not start benchmark thread");
+            break;
+        }
+    }
+    worker(state, 0);
+    for (uint part = workers.size() + 1; part < state.threads; ++part)
+        worker(state, part);
+    for (uint i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (state.error != NULL)
+        rethrow_exception(state.error);
+
+    result r;
+    r.kind = state.kind;
+    r.type = type;
+    r.threads = workers.size() + 1;
+    r.poolBlocks = poolBlocks;
+    r.operations = operations;
+    r.seconds = elapsed.count();
+    results.push_back(r);
+}
+
+/**
+ * Anteil part eines Laufs; eine Ausnahme wird in state.error vermerkt
+ */
+void DBMyBenchmark::worker(run_state &state, uint part) {
+    try {
+        switch (state.kind) {
+            case INSERT_RANDOM:
+            case INSERT_SEQUENTIAL:
+            case INSERT_DUPLICATES:
+            case HASH_INSERT_RANDOM:
+                insert_part(state, part);
+                break;
+            case FIND_POINT:
+            case HASH_FIND_POINT:
+                find_part(state, part);
+                break;
+            case SCAN_RANGE:
+                scan_part(state, part);
+                break;
+            case FIX_UNFIX:
+                fix_part(state, part);
+                break;
+        }
+    } catch (...) {
+        //Ausnahmen duerfen den Thread nicht verlassen
+        lock_guard<mutex> guard(state.errorMutex);
+        if (state.error == NULL)
+            state.error = current_exception();
+    }
+}
+
+/**
+ * Fuegt den part-ten Abschnitt von state.order ein
+ */
+void DBMyBenchmark::insert_part(run_state &state, uint part) {
+    DBIndex &index = state.hashIndexes.empty() ? (DBIndex &) *state.index : *state.hashIndexes[part];
+    uint begin = (uint64_t) state.order.size() * part / state.threads;
+    uint end = (uint64_t) state.order.size() * (part + 1) / state.threads;
+    for (uint i = begin; i < end; ++i) {
+        TID tid;
+        tid.page = state.order[i];
+        tid.slot = 0;
+        index.insert(*state.keys[state.order[i] % state.keys.size()], tid);
+    }
+}
+
+void DBMyBenchmark::find_part(run_state &state, uint part) {
+    DBIndex &index = state.hashIndexes.empty() ? (DBIndex &) *state.index : *state.hashIndexes[part];
+    mt19937 random(config.seed + part + 1);
+    DBListTID tids;
+    for (uint i = 0; i < config.lookups; ++i) {
+        tids.clear();
+        index.find(*state.keys[random() % state.keys.size()], tids);
+    }
+}
+
+void DBMyBenchmark::scan_part(run_state &state, uint part) {
+    mt19937 random(config.seed + part + 1);
+    uint length = min(config.scanLength, (uint) state.keys.size());
+    vector<const DBAttrType *> range(length);
+    vector<DBListTID> found;
+    for (uint i = max(config.lookups / config.scanLength, 1u); i > 0; --i) {
+        uint first = random() % (state.keys.size() - length + 1);
+        for (uint j = 0; j < length; ++j)
+            range[j] = state.keys[first + j];
+        state.index->findBatch(range, found);
+    }
+}
+
+void DBMyBenchmark::fix_part(run_state &state, uint part) {
+    mt19937 random(config.seed + part + 1);
+    for (uint i = 0; i < config.lookups; ++i) {
+        DBBACB bacb = state.bufMgr->fixBlock(*state.file, random() % config.fileBlocks, LOCK_SHARED);
+        state.bufMgr->unfixBlock(bacb);
+    }
+}
+
+/**
+ * k-ter Schluessel des Typs; die Reihenfolge der Schluessel entspricht der von k
+ */
+DBAttrType *DBMyBenchmark::make_key(AttrTypeEnum type, uint k) const {
+    if (type == INT)
+        return new DBIntType(k);
+    if (type == DOUBLE)
+        return new DBDoubleType(k + 0.5);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "k%010u", k);
+    return new DBVCharType(buf);
+}
+
+/**
+ * Ergebnisse als JSON, siehe Kopf der Datei
+ */
+string DBMyBenchmark::to_json() const {
+    stringstream ss;
+    ss << setprecision(9);
+    ss << "{" << endl;
+    ss << "  \"benchmark\": \"DBMyIndex\"," << endl;
+    ss << "  \"config\": {\"keys\": " << config.keys << ", \"duplicates\": " << config.duplicates
+       << ", \"lookups\": " << config.lookups << ", \"scanLength\": " << config.scanLength
+       << ", \"fileBlocks\": " << config.fileBlocks << ", \"indexPoolBlocks\": " << config.indexPoolBlocks
+       << ", \"seed\": " << config.seed << "}," << endl;
+    ss << "  \"results\": [";
+    for (uint i = 0; i < results.size(); ++i) {
+        const result &r = results[i];
+        ss << (i == 0 ? "" : ",") << endl;
+        ss << "    {\"name\": \"" << workloadName(r.kind) << "\"";
+        if (r.kind != FIX_UNFIX)
+            ss << ", \"type\": \"" << typeName(r.type) << "\"";
+        ss << ", \"threads\": " << r.threads << ", \"poolBlocks\": " << r.poolBlocks
+           << ", \"operations\": " << r.operations << ", \"seconds\": " << r.seconds;
+        if (r.seconds > 0 && r.operations > 0)
+            ss << ", \"opsPerSecond\": " << r.operations / r.seconds << ", \"nsPerOp\": "
+               << r.seconds * 1e9 / r.operations;
+        ss << "}";
+    }
+    ss << endl << "  ]" << endl << "}" << endl;
+    return ss.str();
+}
+
+const char *DBMyBenchmark::workloadName(workload kind) {
+    switch (kind) {
+        case INSERT_RANDOM:
+            return "insert_random";
+        case INSERT_SEQUENTIAL:
+            return "insert_sequential";
+        case INSERT_DUPLICATES:
+            return "insert_duplicates";
+        case FIND_POINT:
+            return "find_point";
+        case SCAN_RANGE:
+            return "scan_range";
+        case FIX_UNFIX:
+            return "fix_unfix";
+        case HASH_INSERT_RANDOM:
+            return "hash_insert_random";
+        case HASH_FIND_POINT:
+            return "hash_find_point";
+    }
+    return "unknown";
+}
+
+const char *DBMyBenchmark::typeName(AttrTypeEnum type) {
+    if (type == INT)
+        return "INT";
+    if (type == DOUBLE)
+        return "DOUBLE";
+    return "VCHAR";
+}
@@ -1,11 +1,15 @@
 #include <hubDB/DBMyBufferMgr.h>
 #include <hubDB/DBException.h>
 #include <hubDB/DBMonitorMgr.h>
+#include <hubDB/DBMyLatency.h>
 
 using namespace HubDB::Manager;
 using namespace HubDB::Exception;
 
 LoggerPtr DBMyBufferMgr::logger(Logger::getLogger("HubDB.Buffer.DBMyBufferMgr"));
+atomic<DBMyBufferMgr::WriteAheadHook> DBMyBufferMgr::writeAheadHook(NULL);
+// so oft wartet fixBlock auf den Log oder laufende Operationen, deren Bloecke alle Verdraengungskandidaten sind
+const uint maxWriteAheadWaits = 500;
 int myBMgr = DBMyBufferMgr::registerClass();
 
 extern "C" void * createDBMyBufferMgr(int nArgs,va_list ap);
@@ -20,6 +24,7 @@ DBMyBufferMgr::DBMyBufferMgr(bool doThreading, int cnt) :
     for (int i = 0; i < maxBlockCnt; i++) {
         bcbList[i] = NULL;
     }
+    refused.assign(maxBlockCnt, false);
 
     ageBits = new unsigned int[maxBlockCnt];
     // init is already done
@@ -36,6 +41,9 @@ DBMyBufferMgr::DBMyBufferMgr(bool doThreading, int cnt) :
         setBit(i);
     }
 
+    latencyFixHit = DBMyLatency::series("DBMyBufferMgr::fixBlock", "", "hit");
+    latencyFixMiss = DBMyLatency::series("DBMyBufferMgr::fixBlock", "", "miss");
+
     if (logger != NULL)
         LOG4CXX_DEBUG(logger, "this:\n" + toString("\t"));
 }
@@ -47,7 +55,11 @@ DBMyBufferMgr::~DBMyBufferMgr() {
         for (int i = 0; i < maxBlockCnt; ++i) {
             if (bcbList[i] != NULL) {
                 try {
-                    flushBCBBlock(*bcbList[i]);
+                    // Aenderungen einer nicht beendeten Operation duerfen nicht in die Datei
+                    if (mayFlush(*bcbList[i]))
+                        flushBCBBlock(*bcbList[i]);
+                    else
+                        LOG4CXX_ERROR(logger, "block of a running operation not written");
                 } catch (DBException &e) {}
                 delete bcbList[i];
             }
@@ -112,30 +124,90 @@ DBBCB *DBMyBufferMgr::fixBlock(DBFile &file, BlockNo blockNo, DBBCBLockMode mode
     LOG4CXX_DEBUG(logger, "read: " + TO_STR(read));
     LOG4CXX_DEBUG(logger, "this:\n" + toString("\t"));
 
+    DBMyLatency::Timer timer(latencyFixMiss);
     int i = findBlock(file, blockNo);
+    if (i != -1)
+        timer.setSeries(latencyFixHit);
 
     LOG4CXX_DEBUG(logger, "i:" + TO_STR(i));
 
-    if (i == -1) {
+    uint waits = 0;
+    while (i == -1) {
 
 	    int minAgeIdx = maxBlockCnt;
-	
-        for (i = 0; i < maxBlockCnt; ++i) {
-            // search for the oldest unfixed block
-            unsigned int minAge = gloCnt;
-            if (getBit(i) == 1 && ageBits[i] < minAge) {
-                minAgeIdx = i;
-                minAge = ageBits[i];
-				if( minAge == 0 )
-					break; // no entry can be older than this!
+        // blocks the write-ahead log does not allow to be written yet (marked in refused, reset
+        // before the lock is released): first one whose log has to be synced, first one of this
+        // thread's and of another running operation, first one whose log failed
+        int syncIdx = -1, hereIdx = -1, blockedIdx = -1, failedIdx = -1;
+
+        do {
+            minAgeIdx = maxBlockCnt;
+            for (i = 0; i < maxBlockCnt; ++i) {
+                // search for the oldest unfixed block
+                unsigned int minAge = gloCnt;
+                if (getBit(i) == 1 && refused[i] == false && ageBits[i] < minAge) {
+                    minAgeIdx = i;
+                    minAge = ageBits[i];
+                    if( minAge == 0 )
+                        break; // no entry can be older than this!
+                }
+
             }
 
+            i = minAgeIdx;
+
+            if (i == maxBlockCnt)
+                break;
+            if (bcbList[i] != NULL && bcbList[i]->getDirty() == false) {
+                WriteAheadState state = writeAheadState(*bcbList[i], false);
+                if (state != WRITE_NOW) {
+                    refused[i] = true;
+                    refusedIdx.push_back(i);
+                }
+                if (state == WRITE_AFTER_SYNC && syncIdx == -1)
+                    syncIdx = i;
+                if (state == WRITE_BLOCKED_HERE && hereIdx == -1)
+                    hereIdx = i;
+                if (state == WRITE_BLOCKED && blockedIdx == -1)
+                    blockedIdx = i;
+                if (state == WRITE_FAILED && failedIdx == -1)
+                    failedIdx = i;
+            }
+        } while (refused[i] == true);
+        for (uint j = 0; j < refusedIdx.size(); ++j)
+            refused[refusedIdx[j]] = false;
+        refusedIdx.clear();
+
+        if (i == maxBlockCnt) {
+            // no victim can be written right now: let the write-ahead log sync or wait for the
+            // other operation, without holding the buffer lock, then search again (the block may
+            // be loaded by then); pages of this thread's running operation stay until it ends
+            int waitIdx = syncIdx != -1 ? syncIdx : blockedIdx;
+            if (waitIdx == -1 && failedIdx != -1)
+                throw DBBufferMgrException("no more free pages, the write-ahead log failed");
+            if (waitIdx == -1 && hereIdx != -1)
+                throw DBBufferMgrException("no more free pages, all unfixed pages belong to this thread's operation");
+            if (waitIdx == -1)
+                throw DBBufferMgrException("no more free pages");
+            // also sync waits: a log that never gets durable must not keep fixBlock here forever
+            if (++waits > maxWriteAheadWaits)
+                throw DBBufferMgrException("no more free pages, the write-ahead log releases none of the unfixed pages");
+            string waitFile = bcbList[waitIdx]->getFileBlock().getFileName();
+            BlockNo waitBlock = bcbList[waitIdx]->getFileBlock().getBlockNo();
+            WriteAheadHook hook = writeAheadHook.load();
+            unlock();
+            try {
+                // a failed write of the log is not a lack of free pages
+                if (hook != NULL)
+                    hook(waitFile, waitBlock, true);
+            } catch (DBException &e) {
+                lock();
+                throw;
+            }
+            lock();
+            i = findBlock(file, blockNo);
+            continue;
         }
-		
-		i = minAgeIdx;
-		
-        if (i == maxBlockCnt)
-            throw DBBufferMgrException("no more free pages");
 
         if (bcbList[i] != NULL) {
             if (bcbList[i]->getDirty() == false)
@@ -145,6 +217,7 @@ DBBCB *DBMyBufferMgr::fixBlock(DBFile &file, BlockNo blockNo, DBBCBLockMode mode
         bcbList[i] = new DBBCB(file, blockNo);
         if (read == true)
             fileMgr.readFileBlock(bcbList[i]->getFileBlock());
+        break;
     }
 
     DBBCB *rc = bcbList[i];
@@ -206,6 +279,8 @@ void DBMyBufferMgr::closeAllOpenBlocks(DBFile &file) {
         if (bcbList[i] != NULL && bcbList[i]->getFileBlock() == file) {
             if (bcbList[i]->isUnlocked() == false)
                 throw DBBufferMgrException("can not close fileblock because it is still lock");
+            if (mayFlush(*bcbList[i]) == false)
+                throw DBBufferMgrException("can not close fileblock because a running operation changed it");
             flushBCBBlock(*bcbList[i]);
             delete bcbList[i];
             bcbList[i] = NULL;
@@ -238,6 +313,29 @@ int DBMyBufferMgr::findBlock(DBBCB *bcb) {
     return pos;
 }
 
+/**
+ * Fragt vor dem Schreiben von bcb den Write-Ahead-Log (setWriteAheadHook()); wait siehe
+ * WriteAheadHook
+ */
+DBMyBufferMgr::WriteAheadState DBMyBufferMgr::writeAheadState(DBBCB &bcb, bool wait) {
+    WriteAheadHook hook = writeAheadHook.load();
+    if (hook == NULL)
+        return WRITE_NOW;
+    return hook(bcb.getFileBlock().getFileName(), bcb.getFileBlock().getBlockNo(), wait);
+}
+
+/**
+ * Beim Schliessen: darf bcb geschrieben werden? Der Log wird dazu ggf. unter der Puffersperre
+ * geschrieben (ein nicht gefixter Block kann dabei nicht erneut geaendert werden).
+ * false: der Block gehoert zu einer noch laufenden Aenderung; scheitert der Log, fliegt dessen Exception.
+ */
+bool DBMyBufferMgr::mayFlush(DBBCB &bcb) {
+    WriteAheadState state = writeAheadState(bcb, false);
+    if (state == WRITE_AFTER_SYNC || state == WRITE_FAILED)
+        state = writeAheadState(bcb, true);
+    return state == WRITE_NOW;
+}
+
 extern "C" void *createDBMyBufferMgr(int nArgs,va_list ap) {
     DBMyBufferMgr *b = NULL;
     bool t;
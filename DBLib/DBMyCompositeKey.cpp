@@ -0,0 +1,194 @@
+/**
+ * Zusammengesetzte Schluessel fuer DBMyIndex.
+ *
+ * Gespeichert werden die Schluesselattribute nacheinander in ihrer festen Laenge
+ * (DBAttrType::getSize4Type), danach die mitgespeicherten Attribute. Fehlen diese
+ * (z.B. bei einem Suchschluessel), werden ihre Bytes mit Nullen gefuellt.
+ */
+
+#include <hubDB/DBMyCompositeKey.h>
+#include <hubDB/DBException.h>
+
+using namespace HubDB::Index;
+using namespace HubDB::Exception;
+
+/**
+ * Kopie eines einzelnen Attributwertes ueber seine Byte-Darstellung
+ */
+static DBAttrType *copy_attr(const DBAttrType &val) {
+    vector<char> raw(DBAttrType::getSize4Type(val.type()), 0);
+    val.write(&raw[0]);
+    return DBAttrType::read(&raw[0], val.type());
+}
+
+/**
+ * Leerer Schluessel (ohne Werte), z.B. als Ziel fuer operator=
+ */
+DBMyCompositeKey::DBMyCompositeKey(const vector<AttrTypeEnum> &keyTypes, const vector<AttrTypeEnum> &includeTypes) :
+        keyTypes(keyTypes), includeTypes(includeTypes) {
+}
+
+/**
+ * Schluessel aus Werten, die Objekte in keys und included gehen in den Besitz des Schluessels ueber.
+ * included darf fuer Suchschluessel leer sein.
+ */
+DBMyCompositeKey::DBMyCompositeKey(const vector<AttrTypeEnum> &keyTypes, const vector<AttrTypeEnum> &includeTypes,
+                                   const vector<DBAttrType *> &keys, const vector<DBAttrType *> &included) :
+        keyTypes(keyTypes), includeTypes(includeTypes), keys(keys), included(included) {
+    if (keys.size() != keyTypes.size() || (included.empty() == false && included.size() != includeTypes.size())) {
+        clear();
+        throw DBException("composite key does not match its attribute types");
+    }
+}
+
+DBMyCompositeKey::DBMyCompositeKey(const DBMyCompositeKey &ref) :
+        DBAttrType(), keyTypes(ref.keyTypes), includeTypes(ref.includeTypes) {
+    operator=(ref);
+}
+
+DBMyCompositeKey::~DBMyCompositeKey() {
+    clear();
+}
+
+void DBMyCompositeKey::clear() {
+    for (uint i = 0; i < keys.size(); ++i)
+        delete keys[i];
+    for (uint i = 0; i < included.size(); ++i)
+        delete included[i];
+    keys.clear();
+    included.clear();
+}
+
+/**
+ * Laenge der Byte-Darstellung der Attribute types
+ */
+uint DBMyCompositeKey::getSize(const vector<AttrTypeEnum> &types) {
+    uint size = 0;
+    for (uint i = 0; i < types.size(); ++i)
+        size += DBAttrType::getSize4Type(types[i]);
+    return size;
+}
+
+/**
+ * Liest einen Schluessel samt mitgespeicherten Attributen (muss vom Aufrufer geloescht werden)
+ */
+DBMyCompositeKey *DBMyCompositeKey::read(const char *ptr, const vector<AttrTypeEnum> &keyTypes,
+                                         const vector<AttrTypeEnum> &includeTypes) {
+    DBMyCompositeKey *key = new DBMyCompositeKey(keyTypes, includeTypes);
+    for (uint i = 0; i < keyTypes.size(); ++i) {
+        key->keys.push_back(DBAttrType::read(ptr, keyTypes[i]));
+        ptr += DBAttrType::getSize4Type(keyTypes[i]);
+    }
+    for (uint i = 0; i < includeTypes.size(); ++i) {
+        key->included.push_back(DBAttrType::read(ptr, includeTypes[i]));
+        ptr += DBAttrType::getSize4Type(includeTypes[i]);
+    }
+    return key;
+}
+
+/**
+ * Schreibt Schluessel- und mitgespeicherte Attribute ab ptr,
+ * Rueckgabe: Zeiger hinter das letzte geschriebene Byte
+ */
+char *DBMyCompositeKey::write(char *ptr) const {
+    for (uint i = 0; i < keys.size(); ++i) {
+        uint size = DBAttrType::getSize4Type(keyTypes[i]);
+        memset(ptr, 0, size);
+        keys[i]->write(ptr);
+        ptr += size;
+    }
+    for (uint i = 0; i < includeTypes.size(); ++i) {
+        uint size = DBAttrType::getSize4Type(includeTypes[i]);
+        memset(ptr, 0, size);
+        if (i < included.size())
+            included[i]->write(ptr);
+        ptr += size;
+    }
+    return ptr;
+}
+
+/**
+ * Typ des ersten Schluesselattributs
+ */
+enum AttrTypeEnum DBMyCompositeKey::type() const {
+    return keyTypes[0];
+}
+
+string DBMyCompositeKey::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "(";
+    for (uint i = 0; i < keys.size(); ++i)
+        ss << (i > 0 ? ", " : "") << keys[i]->toString();
+    ss << ")";
+    if (included.empty() == false) {
+        ss << " include (";
+        for (uint i = 0; i < included.size(); ++i)
+            ss << (i > 0 ? ", " : "") << included[i]->toString();
+        ss << ")";
+    }
+    return ss.str();
+}
+
+/**
+ * Lexikographischer Vergleich der Schluesselattribute: <0, 0 oder >0
+ */
+int DBMyCompositeKey::compare(const DBAttrType &ref) const {
+    const DBMyCompositeKey *other = dynamic_cast<const DBMyCompositeKey *>(&ref);
+    if (other == NULL || other->keys.size() != keys.size())
+        throw DBException("composite key compared with incompatible key");
+    for (uint i = 0; i < keys.size(); ++i) {
+        if (keys[i]->operator<(*other->keys[i]))
+            return -1;
+        if (other->keys[i]->operator<(*keys[i]))
+            return 1;
+    }
+    return 0;
+}
+
+bool DBMyCompositeKey::operator==(const DBAttrType &ref) const {
+    return compare(ref) == 0;
+}
+
+bool DBMyCompositeKey::operator!=(const DBAttrType &ref) const {
+    return compare(ref) != 0;
+}
+
+bool DBMyCompositeKey::operator<(const DBAttrType &ref) const {
+    return compare(ref) < 0;
+}
+
+bool DBMyCompositeKey::operator<=(const DBAttrType &ref) const {
+    return compare(ref) <= 0;
+}
+
+bool DBMyCompositeKey::operator>(const DBAttrType &ref) const {
+    return compare(ref) > 0;
+}
+
+bool DBMyCompositeKey::operator>=(const DBAttrType &ref) const {
+    return compare(ref) >= 0;
+}
+
+/**
+ * Uebernimmt alle Werte (auch die mitgespeicherten) aus einem anderen zusammengesetzten Schluessel
+ */
+DBAttrType &DBMyCompositeKey::operator=(const DBAttrType &ref) {
+    const DBMyCompositeKey *other = dynamic_cast<const DBMyCompositeKey *>(&ref);
+    if (other == NULL)
+        throw DBException("composite key assigned from incompatible key");
+    if (other == this)
+        return *this;
+    clear();
+    keyTypes = other->keyTypes;
+    includeTypes = other->includeTypes;
+    for (uint i = 0; i < other->keys.size(); ++i)
+        keys.push_back(copy_attr(*other->keys[i]));
+    for (uint i = 0; i < other->included.size(); ++i)
+        included.push_back(copy_attr(*other->included[i]));
+    return *this;
+}
+
+DBMyCompositeKey &DBMyCompositeKey::operator=(const DBMyCompositeKey &ref) {
+    operator=((const DBAttrType &) ref);
+    return *this;
+}
@@ -0,0 +1,684 @@
+/**
+ * Erweiterbares Hashing (Extendible Hashing) als Alternative zu DBMyIndex fuer reine
+ * Gleichheitssuchen. Auswahl pro Index ueber den Klassennamen "DBMyHashIndex".
+ *
+ * Aufbau der Indexdatei:
+ * Block 0 enthaelt die Metadaten: globale Tiefe, Anzahl der Verzeichnisbloecke,
+ * erster freier Block, danach die Nummern der Verzeichnisbloecke.
+ * Verzeichnisbloecke: 2^globale Tiefe Blocknummern von Buckets, Index = untere Bits des Hashwerts.
+ * Buckets: Kopf (lokale Tiefe, Anzahl, naechster Ueberlaufblock) gefolgt von den Eintraegen
+ * (Schluessel, TID). Laesst sich ein voller Bucket nicht spalten (alle Schluessel mit gleichem
+ * Hashwert oder maximale Tiefe erreicht), wird eine Kette von Ueberlaufbloecken angehaengt.
+ * Freie Bloecke: die ersten Bytes enthalten die Nummer des naechsten freien Blocks.
+ *
+ * Sperrprotokoll:
+ * - Das Verzeichnis wird im Speicher gehalten und ueber eine Version je Indexdatei validiert.
+ *   Eine Suche fixt damit im Normalfall nur den Bucket selbst.
+ * - Aenderungen am Verzeichnis, an der Freiliste und an der Laenge einer Kette geschehen nur
+ *   unter exklusiver Sperre des Metablocks, der immer vor dem Bucket gefixt wird.
+ * - Buckets werden nicht wieder zusammengelegt; leere Ueberlaufbloecke bleiben bis zur
+ *   naechsten Umstrukturierung der Kette erhalten.
+ */
+
+
+#include <hubDB/DBMyHashIndex.h>
+#include <hubDB/DBException.h>
+#include <algorithm>
+
+using namespace HubDB::Index;
+using namespace HubDB::Exception;
+
+LoggerPtr DBMyHashIndex::logger(Logger::getLogger("HubDB.Index.DBMyHashIndex"));
+// Verzeichnisversion je Indexdatei, gemeinsam fuer alle Instanzen im Prozess
+map<string, atomic<unsigned long> > DBMyHashIndex::directoryVersions;
+mutex DBMyHashIndex::directoryVersionsMutex;
+
+// registerClass()-Methode am Ende dieser Datei: macht die Klasse der Factory bekannt
+int rMyHashIdx = DBMyHashIndex::registerClass();
+const BlockNo DBMyHashIndex::metaBlockNo(0);
+// markiert einen nicht vorhandenen Ueberlaufblock bzw. das Ende der Freiliste
+const BlockNo DBMyHashIndex::noBlockNo(-1);
+// hoechstens 2^maxDepth Verzeichniseintraege
+const uint DBMyHashIndex::maxDepth(24);
+// Funktion bekannt machen
+extern "C" void *createDBMyHashIndex(int nArgs, va_list ap);
+
+// Metablock: globale Tiefe, Anzahl Verzeichnisbloecke, erster freier Block
+int sizeOfMetaHead = sizeof(uint) * 2 + sizeof(BlockNo);
+// Bucket: lokale Tiefe, Anzahl Eintraege, naechster Ueberlaufblock
+int sizeOfBucketHead = sizeof(uint) * 2 + sizeof(BlockNo);
+
+/**
+ * Heap-Reihenfolge der Tupel-TIDs
+ */
+static bool less_tid(const TID &a, const TID &b) {
+    return a.page < b.page || (a.page == b.page && a.slot < b.slot);
+}
+
+/**
+ * Ausgabe des Indexes zum Debuggen
+ */
+string DBMyHashIndex::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "[DBMyHashIndex]" << endl;
+    ss << DBIndex::toString(linePrefix + "\t") << endl;
+    ss << linePrefix << "unique: " << unique << endl;
+    ss << linePrefix << "entriesPerBucket: " << entriesPerBucket() << endl;
+    ss << linePrefix << "globalDepth: " << globalDepth << endl;
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
+
+/** Konstruktor
+ * - DBBufferMgr & bufferMgr (Referenz auf Buffermanager)
+ * - DBFile & file (Referenz auf Dateiobjekt)
+ * - enum AttrTypeEnum (Typ des Indexattributs)
+ * - ModType mode (Accesstyp: READ, WRITE - siehe DBTypes.h)
+ * - bool unique (ist Attribute unique)
+ */
+DBMyHashIndex::DBMyHashIndex(DBBufferMgr &bufferMgr, DBFile &file,
+                             enum AttrTypeEnum attrType, ModType mode, bool unique) :
+        DBIndex(bufferMgr, file, attrType, mode, unique),
+        globalDepth(0),
+        directoryVersion(NULL),
+        cachedVersion(0) {
+    if (logger != NULL) {
+        LOG4CXX_INFO(logger, "DBMyHashIndex()");
+    }
+
+    assert(entriesPerBucket() > 1);
+
+    if (bufMgr.getBlockCnt(file) == 0) {
+        LOG4CXX_DEBUG(logger, "initializeIndex");
+        initializeIndex();
+    }
+
+    {
+        lock_guard<mutex> guard(directoryVersionsMutex);
+        directoryVersion = &directoryVersions[file.getFileName()];
+    }
+    load_directory();
+
+    if (logger != NULL) {
+        LOG4CXX_DEBUG(logger, "this:\n" + toString("\t"));
+    }
+}
+
+DBMyHashIndex::~DBMyHashIndex() {
+    LOG4CXX_INFO(logger, "~DBMyHashIndex()");
+    unfixBACBs(false);
+}
+
+/**
+ * Freigeben aller vom Index geblockten Bloecke
+ */
+void DBMyHashIndex::unfixBACBs(bool setDirty) {
+    LOG4CXX_INFO(logger, "unfixBACBs()");
+    LOG4CXX_DEBUG(logger, "setDirty: " + TO_STR(setDirty));
+    while (bacbStack.empty() == false) {
+        try {
+            if (bacbStack.top().getModified()) {
+                if (setDirty == true)
+                    bacbStack.top().setDirty();
+            }
+            bufMgr.unfixBlock(bacbStack.top());
+        } catch (DBException e) {
+        }
+        bacbStack.pop();
+    }
+}
+
+/**
+ * Gibt alle Bloecke der aktuellen Operation wieder frei
+ */
+void DBMyHashIndex::unfix_all() {
+    while (bacbStack.empty() == false) {
+        bufMgr.unfixBlock(bacbStack.top());
+        bacbStack.pop();
+    }
+}
+
+/**
+ * Laenge eines gespeicherten Schluessels
+ */
+uint DBMyHashIndex::keySize() const {
+    return DBAttrType::getSize4Type(attrType);
+}
+
+/**
+ * Laenge eines Eintrags (Schluessel, TID) im Bucket
+ */
+uint DBMyHashIndex::entrySize() const {
+    return keySize() + sizeof(TID);
+}
+
+/**
+ * Eintraege pro Bucketblock
+ */
+uint DBMyHashIndex::entriesPerBucket() const {
+    return (DBFileBlock::getBlockSize() - sizeOfBucketHead) / entrySize();
+}
+
+/**
+ * Verzeichniseintraege pro Verzeichnisblock
+ */
+uint DBMyHashIndex::dirEntriesPerBlock() const {
+    return DBFileBlock::getBlockSize() / sizeof(BlockNo);
+}
+
+/**
+ * Hoechstzahl der Verzeichnisbloecke, begrenzt durch den Platz im Metablock
+ */
+uint DBMyHashIndex::maxDirBlocks() const {
+    return (DBFileBlock::getBlockSize() - sizeOfMetaHead) / sizeof(BlockNo);
+}
+
+/**
+ * Schreibt den Schluessel normiert (mit Nullen aufgefuellt) nach key, so dass
+ * gleiche Werte byteweise gleich sind
+ */
+void DBMyHashIndex::encode_key(const DBAttrType &val, char *key) const {
+    memset(key, 0, keySize());
+    val.write(key);
+    if (attrType == DOUBLE) {
+        // -0.0 und 0.0 sind gleich
+        double d;
+        memcpy(&d, key, sizeof(double));
+        if (d == 0) {
+            d = 0;
+            memcpy(key, &d, sizeof(double));
+        }
+    }
+}
+
+/**
+ * FNV-1a ueber den normierten Schluessel
+ */
+uint DBMyHashIndex::hash(const char *key) const {
+    uint h = 2166136261u;
+    for (uint i = 0; i < keySize(); ++i) {
+        h ^= (unsigned char) key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Erstelle Indexdatei.
+ * Block 0: Metadaten (globale Tiefe 0, ein Verzeichnisblock, leere Freiliste),
+ * Block 1: Verzeichnis, Block 2: leerer Bucket
+ */
+void DBMyHashIndex::initializeIndex() {
+    LOG4CXX_INFO(logger, "initializeIndex()");
+    if (bufMgr.getBlockCnt(file) != 0)
+        throw DBIndexException("can not initializie exisiting table");
+
+    try {
+        bacbStack.push(bufMgr.fixNewBlock(file));
+        char *ptr = bacbStack.top().getDataPtr();
+        uint depth = 0, dirBlocks = 1;
+        BlockNo freeHead = noBlockNo, dirBlock = metaBlockNo + 1;
+        memcpy(ptr, &depth, sizeof(uint));
+        memcpy(ptr + sizeof(uint), &dirBlocks, sizeof(uint));
+        memcpy(ptr + sizeof(uint) * 2, &freeHead, sizeof(BlockNo));
+        memcpy(ptr + sizeOfMetaHead, &dirBlock, sizeof(BlockNo));
+        bacbStack.top().setModified();
+
+        bacbStack.push(bufMgr.fixNewBlock(file));
+        BlockNo bucket = dirBlock + 1;
+        memcpy(bacbStack.top().getDataPtr(), &bucket, sizeof(BlockNo));
+        bacbStack.top().setModified();
+
+        bacbStack.push(bufMgr.fixNewBlock(file));
+        bucket_header head = {0, 0, noBlockNo};
+        write_header(bacbStack.top().getDataPtr(), head);
+        bacbStack.top().setModified();
+        unfix_all();
+    } catch (DBException e) {
+        unfix_all();
+        throw e;
+    }
+
+    assert(bacbStack.empty() == true);
+}
+
+/**
+ * Liest globale Tiefe und Verzeichnis; der Metablock (meta_ptr) muss gefixt sein
+ */
+void DBMyHashIndex::read_directory(char *meta_ptr, vector<BlockNo> &dir, uint &depth) {
+    uint dirBlocks;
+    memcpy(&depth, meta_ptr, sizeof(uint));
+    memcpy(&dirBlocks, meta_ptr + sizeof(uint), sizeof(uint));
+    dir.resize(1u << depth);
+    uint perBlock = dirEntriesPerBlock();
+    for (uint b = 0; b < dirBlocks && b * perBlock < dir.size(); ++b) {
+        BlockNo block;
+        memcpy(&block, meta_ptr + sizeOfMetaHead + b * sizeof(BlockNo), sizeof(BlockNo));
+        DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_SHARED);
+        uint n = min(perBlock, (uint) dir.size() - b * perBlock);
+        memcpy(&dir[b * perBlock], bacb.getDataPtr(), n * sizeof(BlockNo));
+        bufMgr.unfixBlock(bacb);
+    }
+}
+
+/**
+ * Laedt das Verzeichnis in den Speicher (directory, globalDepth)
+ */
+void DBMyHashIndex::load_directory() {
+    unsigned long version = directoryVersion->load();
+    DBBACB meta = bufMgr.fixBlock(file, metaBlockNo, LOCK_SHARED);
+    try {
+        read_directory(meta.getDataPtr(), directory, globalDepth);
+    } catch (DBException e) {
+        bufMgr.unfixBlock(meta);
+        throw e;
+    }
+    bufMgr.unfixBlock(meta);
+    cachedVersion = version;
+}
+
+/**
+ * Fixt den Bucket fuer den Hashwert h im Modus mode und legt ihn auf bacbStack.
+ * Hat sich das Verzeichnis inzwischen geaendert, wird es neu geladen und erneut gefixt.
+ */
+void DBMyHashIndex::fix_bucket(uint h, DBBCBLockMode mode) {
+    while (true) {
+        if (cachedVersion != directoryVersion->load())
+            load_directory();
+        BlockNo block = directory[h & ((1u << globalDepth) - 1)];
+        bacbStack.push(bufMgr.fixBlock(file, block, mode));
+        // Spaltungen erhoehen die Version, solange sie den Bucket exklusiv halten
+        if (cachedVersion == directoryVersion->load())
+            return;
+        bufMgr.unfixBlock(bacbStack.top());
+        bacbStack.pop();
+    }
+}
+
+/**
+ * Liest den Kopf eines Buckets
+ */
+void DBMyHashIndex::read_header(char *ptr, bucket_header &head) const {
+    memcpy(&head.local_depth, ptr, sizeof(uint));
+    memcpy(&head.count, ptr + sizeof(uint), sizeof(uint));
+    memcpy(&head.next, ptr + sizeof(uint) * 2, sizeof(BlockNo));
+}
+
+/**
+ * Schreibt den Kopf eines Buckets
+ */
+void DBMyHashIndex::write_header(char *ptr, const bucket_header &head) const {
+    memcpy(ptr, &head.local_depth, sizeof(uint));
+    memcpy(ptr + sizeof(uint), &head.count, sizeof(uint));
+    memcpy(ptr + sizeof(uint) * 2, &head.next, sizeof(BlockNo));
+}
+
+/**
+ * Haengt die Eintraege des Buckets primary und seiner Ueberlaufkette an buf an.
+ * Rueckgabe: Anzahl der Bloecke der Kette
+ */
+uint DBMyHashIndex::read_chain(DBBACB &primary, vector<char> &buf) {
+    bucket_header head;
+    read_header(primary.getDataPtr(), head);
+    buf.insert(buf.end(), primary.getDataPtr() + sizeOfBucketHead,
+               primary.getDataPtr() + sizeOfBucketHead + head.count * entrySize());
+    uint blocks = 1;
+    // die Kette ist nur ueber den exklusiv oder geteilt gefixten primary erreichbar
+    while (head.next != noBlockNo) {
+        DBBACB bacb = bufMgr.fixBlock(file, head.next, LOCK_SHARED);
+        read_header(bacb.getDataPtr(), head);
+        buf.insert(buf.end(), bacb.getDataPtr() + sizeOfBucketHead,
+                   bacb.getDataPtr() + sizeOfBucketHead + head.count * entrySize());
+        bufMgr.unfixBlock(bacb);
+        ++blocks;
+    }
+    return blocks;
+}
+
+/**
+ * Position des Eintrags mit Schluessel key (und, falls tid != NULL, dieser TID) in buf, sonst -1
+ */
+int DBMyHashIndex::find_entry(const vector<char> &buf, const char *key, const TID *tid) const {
+    uint count = buf.size() / entrySize();
+    for (uint i = 0; i < count; ++i) {
+        const char *entry = &buf[i * entrySize()];
+        if (memcmp(entry, key, keySize()) != 0)
+            continue;
+        if (tid == NULL)
+            return i;
+        TID t;
+        t.read(entry + keySize());
+        if (t.page == tid->page && t.slot == tid->slot)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Verteilt count Eintraege aus buf auf bacb und dessen Ueberlaufkette.
+ * Ohne meta werden nur vorhandene Kettenbloecke benutzt (ueberzaehlige bleiben leer erhalten),
+ * mit meta (exklusiv gefixt) werden Bloecke angehaengt bzw. freigegeben.
+ */
+void DBMyHashIndex::write_chain(DBBACB &bacb, const char *buf, uint count, DBBACB *meta) {
+    char *ptr = bacb.getDataPtr();
+    bucket_header head;
+    read_header(ptr, head);
+    head.count = min(count, entriesPerBucket());
+    if (head.count > 0)
+        memcpy(ptr + sizeOfBucketHead, buf, head.count * entrySize());
+
+    if (count > head.count || (meta == NULL && head.next != noBlockNo)) {
+        DBBACB next = head.next == noBlockNo ?
+                      fix_free_block(*meta) : bufMgr.fixBlock(file, head.next, LOCK_EXCLUSIVE);
+        try {
+            if (head.next == noBlockNo) {
+                bucket_header empty = {head.local_depth, 0, noBlockNo};
+                write_header(next.getDataPtr(), empty);
+                head.next = next.getBlockNo();
+            }
+            write_chain(next, buf + head.count * entrySize(), count - head.count, meta);
+        } catch (DBException e) {
+            bufMgr.unfixBlock(next);
+            throw e;
+        }
+        bufMgr.unfixBlock(next);
+    } else if (head.next != noBlockNo) {
+        free_chain(head.next, *meta);
+        head.next = noBlockNo;
+    }
+    write_header(ptr, head);
+    bacb.setModified();
+}
+
+/**
+ * Haengt die Kette ab block an die Freiliste im (exklusiv gefixten) Metablock
+ */
+void DBMyHashIndex::free_chain(BlockNo block, DBBACB &meta) {
+    char *freeHead = meta.getDataPtr() + sizeof(uint) * 2;
+    while (block != noBlockNo) {
+        DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_EXCLUSIVE);
+        bucket_header head;
+        read_header(bacb.getDataPtr(), head);
+        memcpy(bacb.getDataPtr(), freeHead, sizeof(BlockNo));
+        bacb.setModified();
+        bufMgr.unfixBlock(bacb);
+        memcpy(freeHead, &block, sizeof(BlockNo));
+        block = head.next;
+    }
+    meta.setModified();
+}
+
+/**
+ * Fixt einen freien Block exklusiv: aus der Freiliste des (exklusiv gefixten) Metablocks
+ * oder neu am Dateiende
+ */
+DBBACB DBMyHashIndex::fix_free_block(DBBACB &meta) {
+    char *freeHead = meta.getDataPtr() + sizeof(uint) * 2;
+    BlockNo block;
+    memcpy(&block, freeHead, sizeof(BlockNo));
+    if (block == noBlockNo)
+        return bufMgr.fixNewBlock(file);
+    DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_EXCLUSIVE);
+    memcpy(freeHead, bacb.getDataPtr(), sizeof(BlockNo));
+    meta.setModified();
+    return bacb;
+}
+
+/**
+ * Schreibt Verzeichnis und globale Tiefe zurueck; fehlende Verzeichnisbloecke werden angelegt
+ */
+void DBMyHashIndex::write_directory(DBBACB &meta, const vector<BlockNo> &dir, uint depth) {
+    char *ptr = meta.getDataPtr();
+    uint dirBlocks;
+    memcpy(&dirBlocks, ptr + sizeof(uint), sizeof(uint));
+    uint perBlock = dirEntriesPerBlock();
+    for (uint b = 0; b * perBlock < dir.size(); ++b) {
+        BlockNo block = noBlockNo;
+        if (b < dirBlocks)
+            memcpy(&block, ptr + sizeOfMetaHead + b * sizeof(BlockNo), sizeof(BlockNo));
+        DBBACB bacb = block != noBlockNo ?
+                      bufMgr.fixBlock(file, block, LOCK_EXCLUSIVE) : fix_free_block(meta);
+        if (block == noBlockNo) {
+            // neuer Verzeichnisblock
+            block = bacb.getBlockNo();
+            memcpy(ptr + sizeOfMetaHead + b * sizeof(BlockNo), &block, sizeof(BlockNo));
+            dirBlocks = b + 1;
+        }
+        uint n = min(perBlock, (uint) dir.size() - b * perBlock);
+        memcpy(bacb.getDataPtr(), &dir[b * perBlock], n * sizeof(BlockNo));
+        bacb.setModified();
+        bufMgr.unfixBlock(bacb);
+    }
+    memcpy(ptr, &depth, sizeof(uint));
+    memcpy(ptr + sizeof(uint), &dirBlocks, sizeof(uint));
+    meta.setModified();
+}
+
+/**
+ * Fuegt entry unter exklusiver Sperre des Metablocks ein, wenn im Bucket (inzwischen) Platz ist
+ * oder er sich nicht spalten laesst (dann mit Ueberlaufblock). Sonst wird der Bucket
+ * gespalten, ggf. nach Verdopplung des Verzeichnisses.
+ * Rueckgabe: true, wenn entry eingefuegt wurde; false, wenn der Aufrufer es erneut versuchen soll
+ */
+bool DBMyHashIndex::restructure(uint h, const char *entry) {
+    bacbStack.push(bufMgr.fixBlock(file, metaBlockNo, LOCK_EXCLUSIVE));
+    DBBACB &meta = bacbStack.top();
+    vector<BlockNo> dir;
+    uint depth;
+    read_directory(meta.getDataPtr(), dir, depth);
+
+    BlockNo old = dir[h & ((1u << depth) - 1)];
+    bacbStack.push(bufMgr.fixBlock(file, old, LOCK_EXCLUSIVE));
+    DBBACB &bucket = bacbStack.top();
+    bucket_header head;
+    read_header(bucket.getDataPtr(), head);
+    vector<char> buf;
+    uint blocks = read_chain(bucket, buf);
+    uint count = buf.size() / entrySize();
+
+    TID tid;
+    tid.read(entry + keySize());
+    if (unique && find_entry(buf, entry, NULL) != -1)
+        throw DBIndexUniqueKeyException("key already exists in unique index");
+    if (unique == false && find_entry(buf, entry, &tid) != -1)
+        throw DBIndexException("tid already exists for key");
+
+    // Spalten nur, wenn sich die Schluessel im Hashwert unterscheiden
+    bool splittable = false;
+    for (uint i = 0; i < count && splittable == false; ++i)
+        splittable = hash(&buf[i * entrySize()]) != h;
+    if (head.local_depth >= maxDepth)
+        splittable = false;
+    if (splittable && head.local_depth == depth &&
+        (dir.size() * 2 + dirEntriesPerBlock() - 1) / dirEntriesPerBlock() > maxDirBlocks())
+        splittable = false;
+
+    if (count < blocks * entriesPerBucket() || splittable == false) {
+        buf.insert(buf.end(), entry, entry + entrySize());
+        write_chain(bucket, &buf[0], count + 1, &meta);
+        unfix_all();
+        return true;
+    }
+
+    LOG4CXX_DEBUG(logger, "split bucket " + TO_STR(old));
+    if (head.local_depth == depth) {
+        //Verzeichnis verdoppeln, die obere Haelfte zeigt auf dieselben Buckets
+        size_t n = dir.size();
+        dir.resize(2 * n);
+        copy(dir.begin(), dir.begin() + n, dir.begin() + n);
+        ++depth;
+    }
+    uint bit = 1u << head.local_depth;
+    bacbStack.push(fix_free_block(meta));
+    DBBACB &sibling = bacbStack.top();
+    bucket_header sibHead = {head.local_depth + 1, 0, noBlockNo};
+    write_header(sibling.getDataPtr(), sibHead);
+    head.local_depth++;
+    write_header(bucket.getDataPtr(), head);
+
+    vector<char> low, high;
+    for (uint i = 0; i < count; ++i) {
+        const char *e = &buf[i * entrySize()];
+        vector<char> &target = (hash(e) & bit) ? high : low;
+        target.insert(target.end(), e, e + entrySize());
+    }
+    write_chain(bucket, low.empty() ? NULL : &low[0], low.size() / entrySize(), &meta);
+    write_chain(sibling, high.empty() ? NULL : &high[0], high.size() / entrySize(), &meta);
+
+    for (uint i = 0; i < dir.size(); ++i)
+        if (dir[i] == old && (i & bit))
+            dir[i] = sibling.getBlockNo();
+    write_directory(meta, dir, depth);
+    // noch unter den Sperren, damit fix_bucket keinen veralteten Bucket behaelt
+    directoryVersion->fetch_add(1);
+    unfix_all();
+    return false;
+}
+
+/**
+ * Sucht im Index nach einem bestimmten Wert
+ * - const DBAttrType & val: zu suchender Schluesselwert
+ * - DBListTID & tids: Referenz auf Liste von TID Objekten
+ * Die TIDs werden in Heap-Reihenfolge geliefert.
+ */
+void DBMyHashIndex::find(const DBAttrType &val, DBListTID &tids) {
+    LOG4CXX_INFO(logger, "find()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+
+    vector<char> key(keySize());
+    encode_key(val, &key[0]);
+    vector<TID> found;
+    try {
+        fix_bucket(hash(&key[0]), LOCK_SHARED);
+        vector<char> buf;
+        read_chain(bacbStack.top(), buf);
+        unfix_all();
+        uint count = buf.size() / entrySize();
+        for (uint i = 0; i < count; ++i) {
+            const char *entry = &buf[i * entrySize()];
+            if (memcmp(entry, &key[0], keySize()) == 0) {
+                TID tid;
+                tid.read(entry + keySize());
+                found.push_back(tid);
+            }
+        }
+    } catch (DBException &e) {
+        unfix_all();
+        throw;
+    }
+    sort(found.begin(), found.end(), less_tid);
+    tids.assign(found.begin(), found.end());
+}
+
+/**
+ * Einfuegen eines Schluesselwertes (moeglicherweise bereits vorhanden) zusammen mit einer Tupel-TID
+ * - const DBAttrType & val: Schluesselwert
+ * - const TID & tid: Tupel-TID
+ */
+void DBMyHashIndex::insert(const DBAttrType &val, const TID &tid) {
+    LOG4CXX_INFO(logger, "insert()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    LOG4CXX_DEBUG(logger, "tid: " + tid.toString());
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+
+    vector<char> entry(entrySize());
+    encode_key(val, &entry[0]);
+    tid.write(&entry[keySize()]);
+    uint h = hash(&entry[0]);
+    try {
+        while (true) {
+            fix_bucket(h, LOCK_EXCLUSIVE);
+            DBBACB &bucket = bacbStack.top();
+            vector<char> buf;
+            uint blocks = read_chain(bucket, buf);
+            uint count = buf.size() / entrySize();
+            if (unique && find_entry(buf, &entry[0], NULL) != -1)
+                throw DBIndexUniqueKeyException("key already exists in unique index");
+            if (unique == false && find_entry(buf, &entry[0], &tid) != -1)
+                throw DBIndexException("tid already exists for key");
+            if (count < blocks * entriesPerBucket()) {
+                // Platz in der vorhandenen Kette
+                buf.insert(buf.end(), entry.begin(), entry.end());
+                write_chain(bucket, &buf[0], count + 1, NULL);
+                unfix_all();
+                return;
+            }
+            unfix_all();
+            if (restructure(h, &entry[0]))
+                return;
+        }
+    } catch (DBException &e) {
+        unfix_all();
+        throw;
+    }
+}
+
+/**
+ * Entfernt alle Tupel-TIDs, auf die der Schluessel zeigt
+ * - const DBAttrType & val: Schluesselwert
+ * - const DBListTID & tid: zu entfernende Tupel-TIDs
+ */
+void DBMyHashIndex::remove(const DBAttrType &val, const DBListTID &tids) {
+    LOG4CXX_INFO(logger, "remove()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+
+    if (unique == true && tids.size() > 1)
+        throw DBIndexUniqueKeyException("try to remove multiple key but is unique index");
+
+    vector<char> key(keySize());
+    encode_key(val, &key[0]);
+    try {
+        fix_bucket(hash(&key[0]), LOCK_EXCLUSIVE);
+        DBBACB &bucket = bacbStack.top();
+        vector<char> buf;
+        read_chain(bucket, buf);
+        uint count = buf.size() / entrySize();
+        for (DBListTID::const_iterator it = tids.begin(); it != tids.end(); ++it) {
+            int pos = find_entry(buf, &key[0], &*it);
+            if (pos == -1)
+                continue;
+            // letzten Eintrag an die freie Stelle
+            memcpy(&buf[pos * entrySize()], &buf[(count - 1) * entrySize()], entrySize());
+            buf.resize(--count * entrySize());
+        }
+        write_chain(bucket, buf.empty() ? NULL : &buf[0], count, NULL);
+        unfix_all();
+    } catch (DBException &e) {
+        unfix_all();
+        throw;
+    }
+}
+
+/**
+ * Fuegt createDBMyHashIndex zur globalen factory method-map hinzu
+ */
+int DBMyHashIndex::registerClass() {
+    setClassForName("DBMyHashIndex", createDBMyHashIndex);
+    return 0;
+}
+
+/**
+ * Gerufen von HubDB::Types::getClassForName von DBTypes, um DBIndex zu erstellen
+ * - DBBufferMgr *: Buffermanager
+ * - DBFile *: Dateiobjekt
+ * - attrType: Attributtp
+ * - ModeType: READ, WRITE
+ * - bool: unique Indexattribut
+ */
+extern "C" void *createDBMyHashIndex(int nArgs, va_list ap) {
+    // Genau 5 Parameter
+    if (nArgs != 5) {
+        throw DBException("Invalid number of arguments");
+    }
+    DBBufferMgr *bufMgr = va_arg(ap, DBBufferMgr *);
+    DBFile *file = va_arg(ap, DBFile *);
+    enum AttrTypeEnum attrType = (enum AttrTypeEnum) va_arg(ap, int);
+    ModType m = (ModType) va_arg(ap, int);
+    bool unique = (bool) va_arg(ap, int);
+    return new DBMyHashIndex(*bufMgr, *file, attrType, m, unique);
+}
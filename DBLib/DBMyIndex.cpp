@@ -6,30 +6,600 @@
  *
  * Nice To Know:
  * bacbStack ist ein STack der die gefixten Blöcke im Buffer speichert
- * bacbStack.top() muss immer die Rood Node sein
+ * bacbStack, Spiegel der inneren Knoten und rechtestes Blatt liegen je Thread im Cursor (cursor()),
+ * so kann eine Instanz von mehreren Threads gleichzeitig benutzt werden.
+ * Zwischen zwei Operationen ist kein Block gefixt. Die Wurzel liegt immer im selben Block,
+ * beim Split wandert ihr Inhalt in einen neuen Knoten.
+ *
+ * Sperrprotokoll (Lock Coupling):
+ * - Lesen: Abstieg mit geteilten Sperren, der Elternknoten wird freigegeben, sobald das Kind gefixt ist
+ * - Aendern: zuerst ebenso optimistisch, nur das Blatt exklusiv. Muesste das Blatt gespalten
+ *   oder ausgeglichen werden, wird mit exklusiven Sperren erneut abgestiegen; sobald ein Knoten
+ *   die Aenderung sicher aufnimmt (is_safe), werden alle Vorgaenger freigegeben.
+ *
+ * Aufbau der Indexdatei:
+ * Block 0 enthaelt nur Metadaten (TID der Wurzel, TID des ersten freien Blocks),
+ * alle weiteren Bloecke sind Knoten oder freie Bloecke.
+ * Knoten: Kopf (Formatversion, Flags isroot/isleaf, fill_level, next; 16 Bytes, Felder ausgerichtet)
+ * gefolgt von fill_level Eintraegen (Schluessel, TID). Dateien mit anderer Formatversion
+ * werden beim Oeffnen abgelehnt und muessen neu aufgebaut werden.
+ * INTEGER- und DOUBLE-Knoten legen die Schluessel zusammenhaengend ab (Platz fuer entriesPerPage()
+ * Schluessel), dahinter die TIDs; so wird in der Seite mit SIMD-Vergleichen gesucht (search_keys).
+ * Innere Knoten: TID des Eintrags i zeigt auf Kind mit Schluesseln < Schluessel i, next auf das rechteste Kind.
+ * Blaetter: TID des Eintrags ist die Tupel-TID, next zeigt auf das rechte Nachbarblatt.
+ * Aufsteigende Schluessel werden ohne Abstieg an das zuletzt gesehene rechteste Blatt
+ * angehaengt (fix_right_leaf()); am rechten Rand wird nicht in der Mitte gespalten.
+ * Freie Bloecke: die ersten Bytes enthalten die TID des naechsten freien Blocks.
+ *
+ * VARCHAR-Knoten sind komprimiert: nach dem Kopf folgen Praefixlaenge und Schluesselbreite,
+ * dann das allen Schluesseln der Seite gemeinsame Praefix. Die Eintraege enthalten nur den
+ * Rest des Schluessels in der fuer diese Seite noetigen Breite. Ist das kleiner, hat die Seite
+ * stattdessen ein Slotverzeichnis (je Eintrag der Offset seines Satzes) und dahinter lueckenlos
+ * in Schluesselreihenfolge Saetze variabler Laenge (Laengenbyte, Schluesselrest, TID); die
+ * Breite ist dann slottedWidth. Jedes Neuschreiben der Seite (Split, Ausgleich) waehlt die
+ * Darstellung neu und verdichtet sie. Separatoren in inneren Knoten werden beim Blattsplit
+ * auf das kuerzeste trennende Praefix gekuerzt.
+ *
+ * Nicht eindeutige Indexe speichern jeden Schluessel nur einmal pro Blatt, die TID des
+ * Eintrags verweist dann auf dessen Posting-Liste (nach page/slot sortierte Tupel-TIDs):
+ * - eine einzelne Tupel-TID steht wie beim eindeutigen Index direkt im Eintrag
+ * - slot = listFlag | Laenge: delta-kodierte Liste hinter den Eintraegen derselben Seite,
+ *   page ist ihr Offset in der Seite
+ * - slot = overflowFlag: die Liste liegt in einer Kette von Ueberlaufbloecken ab Block page
+ *   (je Block: TID des naechsten Blocks, Anzahl belegter Bytes, Daten)
+ * Kodierung: Anzahl, erste TID (page, slot), danach je TID die Differenz der page und
+ * bei gleicher page die Differenz der slot, sonst der absolute slot; alles als Varint.
+ *
+ * Einfuegepuffer (optional, setInsertBuffer()): Einfuegungen werden im Speicher gesammelt und
+ * beim Erreichen der Kapazitaet sortiert mit insertBatch-Logik in die Blaetter geschrieben.
+ * Sperrreihenfolge: erst der Puffer (insert_buffer::lock), dann Seiten. find liest den Puffer
+ * vor dem Baum; Eintraege verlassen den Puffer erst, wenn sie im Baum stehen. Duplikatpruefung
+ * und Leerung lesen bzw. schreiben den Baum ohne den lock, die zu leerenden Eintraege bleiben
+ * dabei in insert_buffer::flushing sichtbar. Ausgeschaltet wird
+ * der lock nicht genommen; remove und insertBatch geben ihn vor dem Abstieg frei und tragen ihre
+ * Schluessel bis zum Ende in insert_buffer::busy ein, Einfuegungen dieser Schluessel in den
+ * Puffer warten so lange.
+ *
+ * Bloom-Filter (optional, setFilter()): Suchen nach nicht vorhandenen Schluesseln enden ohne
+ * Seitenzugriff. Geblockter Filter: jeder Schluessel setzt numHashes Bits in einer 512-Bit-Zeile.
+ * Im Metablock folgt auf die beiden TIDs die Beschreibung (Zustand, numHashes, erwartete
+ * Schluessel, Zeilen, Anzahl Bloecke, Blocknummern), die Bits stehen in eigenen Bloecken.
+ * Vor der ersten Aenderung nach dem Speichern wird der Zustand auf "dirty" gesetzt; ein so
+ * vorgefundener Filter wird beim Oeffnen aus den Blaettern neu aufgebaut. Bits werden vor dem
+ * Einfuegen in den Baum gesetzt. Geloeschte Schluessel behalten ihre Bits, nach
+ * expectedKeys / 2 Loeschungen wird der Filter neu aufgebaut.
+ * Sperrreihenfolge: Puffer, Filter (key_filter::lock), Seiten.
+ *
+ * Aufbau ueber einer bestehenden Tabelle (build()): Worker-Threads sortieren Laeufe aus den
+ * Partitionen der Tabelle (ggf. in temporaere Dateien ausgelagert), die gemischt von unten
+ * nach oben zu vollen Knoten geschrieben werden.
+ *
+ * Snapshots (writeSnapshot()): die Blattkette wird in eine gepackte, unveraenderliche Datei
+ * geschrieben, die DBMyIndexSnapshot nur lesend einblendet (Aufbau siehe dort).
+ *
+ * Gezaehlter Baum (optional, setCounted(), Flag am Ende des Metablocks): der slot der Kind-TIDs
+ * innerer Knoten enthaelt die Anzahl der Tupel-TIDs im Teilbaum. count(), rank(), select() und
+ * quantile() steigen einmal ab und summieren die Anzahlen der Kinder links vom Pfad. Jede
+ * Aenderung passt die Anzahlen aller Vorgaenger an und haelt daher den ganzen Pfad exklusiv.
+ *
+ * Schluesselcache (optional, setKeyCache()): find legt das Ergebnis haeufig gesuchter Schluessel
+ * im Speicher ab und beantwortet sie danach ohne Puffermanager. insert/remove verwerfen die
+ * Eintraege ihrer Schluessel nach der Aenderung; ein find, waehrend dessen invalidiert wurde,
+ * legt sein Ergebnis nicht ab (key_cache::generation).
+ *
+ * findEach() und findSpan() dekodieren die Posting-Liste direkt an einen DBMyIndexSink, ohne
+ * DBListTID; findSpan() setzt ueber FindContinuation hinter der zuletzt gelieferten TID fort.
+ *
+ * Redo-Log (optional, setWriteAheadLog(), Datei logName()): jede geaenderte Seite wird beim
+ * Freigeben (unfix_block()) als volles Bild mit Version in den Cursor kopiert. Am Ende einer
+ * aendernden Operation haengt log_commit() die Bilder als Gruppe (mit Pruefsumme) an und wartet,
+ * bis der Log bis dorthin mit fsync geschrieben ist; wer gerade schreibt, nimmt die Gruppen aller
+ * Wartenden mit (Group Commit, sync_log()); wirft die Operation, ebenso (log_abort()).
+ * DBMyBufferMgr schreibt eine Seite erst, wenn ihr letztes Bild im Log dauerhaft ist
+ * (before_block_write()); den Log schreibt er dazu ausserhalb seiner Sperre. Eine Gruppe enthaelt immer eine ganze Operation: bis zu ihrem Ende werden die
+ * Seiten einer Operation weder angehaengt noch geschrieben, findet der Puffermanager nur noch
+ * solche Seiten, scheitert fixBlock. Nur lange Operationen haengen ihre Bilder schon unterwegs an
+ * (log_progress()), und zwar an Stellen, an denen die Datei in sich stimmig ist. Aendert eine
+ * Operation eine Seite, deren voriges Bild noch im Cursor einer anderen liegt, wird ihre Gruppe
+ * erst nach deren Gruppe angehaengt (warten beide aufeinander, als eine Gruppe). Beim ersten
+ * Oeffnen nach einem Absturz wird je Seite das Bild mit der hoechsten Version eingespielt; eine
+ * abgerissene Gruppe am Ende wird verworfen, Teile einer Operation gibt es so nie. Ein Checkpoint
+ * schreibt die geloggten Seiten und kuerzt den Log, ohne dabei die Sperre des Logs zu halten.
+ * Der Aufbau mit build() loggt seine neuen Knoten nicht, sie werden vor dem Umhaengen der
+ * Wurzel geschrieben.
  */
 
 
 #include <hubDB/DBMyIndex.h>
+#include <hubDB/DBMyIndexSnapshot.h>
+#include <hubDB/DBMyBufferMgr.h>
+#include <hubDB/DBMyLatency.h>
 #include <hubDB/DBException.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <queue>
+#include <thread>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace HubDB::Index;
+using namespace HubDB::Manager;
 using namespace HubDB::Exception;
 
 LoggerPtr DBMyIndex::logger(Logger::getLogger("HubDB.Index.DBMyIndex"));
+// alle geoeffneten Indexe, fuer inspectAll()
+set<DBMyIndex *> DBMyIndex::openIndexes;
+mutex DBMyIndex::openIndexesMutex;
+// Strukturversion je Indexdatei, gemeinsam fuer alle Instanzen im Prozess
+map<string, atomic<unsigned long> > DBMyIndex::structureVersions;
+// Einfuegepuffer je Indexdatei (siehe setInsertBuffer())
+map<string, DBMyIndex::insert_buffer> DBMyIndex::insertBuffers;
+// Bloom-Filter je Indexdatei (siehe setFilter())
+map<string, DBMyIndex::key_filter> DBMyIndex::filters;
+// gezaehlter Baum je Indexdatei (siehe setCounted())
+map<string, atomic<bool> > DBMyIndex::countedIndexes;
+// Cache haeufig gesuchter Schluessel je Indexdatei (siehe setKeyCache())
+map<string, DBMyIndex::key_cache> DBMyIndex::keyCaches;
+// Redo-Log je Indexdatei (siehe setWriteAheadLog()); eigene Sperre, da der Puffermanager
+// before_block_write() aufruft, waehrend Operationen Seiten gefixt halten
+map<string, DBMyIndex::redo_log> DBMyIndex::redoLogs;
+mutex DBMyIndex::redoLogsMutex;
+// Anzahl der bisher angelegten Instanzen, vergibt instanceId
+atomic<unsigned long> DBMyIndex::instanceCount(0);
+// Instanzen mit Cursorn (siehe cursor())
+mutex DBMyIndex::cursorsMutex;
+map<unsigned long, DBMyIndex *> DBMyIndex::liveIndexes;
 
 // registerClass()-Methode am Ende dieser Datei: macht die Klasse der Factory bekannt
 int rMyIdx = DBMyIndex::registerClass();
 // set static const rootBlockNo to 0 in DBMyIndex Class - (BlockNo=uint)
 const BlockNo DBMyIndex::rootBlockNo(0);
-// max this amount of entries with the some value in the index - WHEN NOT UNIQUE
-const uint DBMyIndex::MAX_TID_PER_ENTRY(20);
+// markiert einen nicht vorhandenen Nachfolger (next) eines Knotens
+const BlockNo DBMyIndex::noBlockNo(-1);
 // Funktion bekannt machen
 extern "C" void *createDBMyIndex(int nArgs, va_list ap);
 
-int leaf_size = 4;
-int sizeOfHead = sizeof(bool) * 2 + sizeof(int) + sizeof(TID);
-string tree;
+// Knotenkopf: Format, Flags, 2 Bytes frei, fill_level und next auf ihren natuerlichen Grenzen,
+// so beginnen die Schluessel numerischer Knoten 8-Byte-ausgerichtet
+int sizeOfHead = 16;
+// Version des Knotenformats, steht im ersten Byte jedes Knotens
+const unsigned char nodeFormat = 2;
+const unsigned char rootFlag = 0x01;
+const unsigned char leafFlag = 0x02;
+// VARCHAR-Knoten: Laenge des gemeinsamen Praefixes und Breite der Schluesselreste
+int sizeOfKeyHead = sizeof(unsigned short) * 2;
+// Schluesselbreite einer Seite mit Slotverzeichnis und Saetzen variabler Laenge
+const unsigned short slottedWidth = USHRT_MAX;
+// Posting-Listen nicht eindeutiger Indexe: Markierungen im slot der Eintrags-TID
+const uint listFlag = 0x80000000;
+const uint overflowFlag = 0x40000000;
+const uint listLengthMask = 0x3fffffff;
+// Bloom-Filter: Beschreibung im Metablock hinter TID der Wurzel und TID der Freiliste
+const uint filterOffset = sizeof(TID) * 2;
+const uint filterDescSize = sizeof(uint) * 5;
+enum filter_state {
+    filterNone = 0, filterClean = 1, filterDirty = 2
+};
+const uint filterLineBits = 512;
+const uint filterLineWords = filterLineBits / 64;
+const uint maxFilterHashes = 16;
+// Flags im letzten uint des Metablocks
+const uint countedFlag = 0x01;
+// findBatch(): Anzahl der gleichzeitig ueber den Spiegel absteigenden Suchen
+const uint interleavedProbes = 8;
+// build(): geschaetzter Speicher je Paar im Lauf zusaetzlich zum Eintrag
+const uint buildEntryOverhead = 64;
+// Redo-Log: Kopf einer Gruppe (Kennung, Laenge, Pruefsumme), vor jedem Seitenbild
+// Blocknummer und Version
+const uint32_t logMagic = 0x4c4f4752;
+const uint logGroupHead = sizeof(uint32_t) * 2 + sizeof(uint64_t);
+const uint logPageHead = sizeof(BlockNo) + sizeof(uint64_t);
+// waechst der Log darueber, folgt auf das Commit ein Checkpoint
+const uint64_t logCheckpointBytes = 64 << 20;
+// log_progress(): so viele Bilder haelt ein Cursor hoechstens zurueck
+const uint logGroupPages = 16;
+// so lange wartet before_block_write() auf die Bilder einer anderen Operation
+const uint logWaitMillis = 10;
+
+/**
+ * Position der Flags im Metablock
+ */
+static uint meta_flags_offset() {
+    return DBFileBlock::getBlockSize() - sizeof(uint);
+}
+
+/**
+ * Pruefsumme einer Gruppe im Redo-Log (FNV-1a)
+ */
+static uint64_t log_checksum(const char *data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char) data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Schreibt size Bytes ab offset in fd bzw. liest sie (auch bei Teilergebnissen von pwrite/pread)
+ */
+static bool write_fully(int fd, const char *data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = pwrite(fd, data, size, offset);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool read_fully(int fd, char *data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = pread(fd, data, size, offset);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * fsync der Datei path: flushBlock() schreibt nur mit write() in den Cache des Betriebssystems
+ */
+static bool sync_file(const string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Sortierkriterium fuer insertBatch: aufsteigend nach Schluessel
+ */
+static bool less_entry(const pair<DBAttrType *, TID> &a, const pair<DBAttrType *, TID> &b) {
+    return a.first->operator<(*b.first);
+}
+
+/**
+ * Sortierkriterium fuer findBatch: Positionen der Suchschluessel aufsteigend nach Schluessel
+ */
+struct less_probe {
+    const vector<const DBAttrType *> &keys;
+
+    less_probe(const vector<const DBAttrType *> &keys) : keys(keys) {}
+
+    bool operator()(uint a, uint b) const {
+        return keys[a]->operator<(*keys[b]);
+    }
+};
+
+/**
+ * build(): sortierter Lauf im Speicher (entries ab pos) oder in einer temporaeren Datei (file);
+ * key und tid sind der aktuelle Eintrag
+ */
+struct DBMyIndex::build_run {
+    vector<pair<DBAttrType *, TID> > entries;
+    uint pos;
+    FILE *file;
+    DBAttrType *key;
+    TID tid;
+
+    build_run() : pos(0), file(NULL), key(NULL) {}
+
+    ~build_run() {
+        for (uint i = pos; i < entries.size(); ++i)
+            delete entries[i].first;
+        if (file != NULL) {
+            delete key;
+            fclose(file);
+        }
+    }
+};
+
+/**
+ * Mischen der Laeufe in build(): kleinster aktueller Schluessel oben im Heap
+ */
+struct greater_run {
+    bool operator()(const pair<DBAttrType *, uint> &a, const pair<DBAttrType *, uint> &b) const {
+        return b.first->operator<(*a.first);
+    }
+};
+
+/**
+ * Heap-Reihenfolge der Tupel-TIDs in Posting-Listen
+ */
+static bool less_tid(const TID &a, const TID &b) {
+    return a.page < b.page || (a.page == b.page && a.slot < b.slot);
+}
+
+/**
+ * Gleichheit zweier TIDs
+ */
+static bool equal_tid(const TID &a, const TID &b) {
+    return a.page == b.page && a.slot == b.slot;
+}
+
+/**
+ * Sammelt die TIDs einer Posting-Liste in einem vector (read_postings())
+ */
+struct vector_sink : public DBMyIndexSink {
+    vector<TID> &tids;
+
+    vector_sink(vector<TID> &tids) : tids(tids) {}
+
+    bool put(const TID &tid) {
+        tids.push_back(tid);
+        return true;
+    }
+};
+
+/**
+ * Reicht die TIDs des Baumes hinter after (NULL: alle) an sink weiter und mischt die sortierten
+ * gepufferten TIDs (alle hinter after) ein, gleiche TIDs werden einmal geliefert (stream_find())
+ */
+struct merge_sink : public DBMyIndexSink {
+    DBMyIndexSink &sink;
+    const TID *after;
+    const vector<TID> &buffered;
+    uint next;
+
+    merge_sink(DBMyIndexSink &sink, const TID *after, const vector<TID> &buffered) :
+            sink(sink), after(after), buffered(buffered), next(0) {}
+
+    bool put(const TID &tid) {
+        if (after != NULL && less_tid(*after, tid) == false)
+            return true;
+        while (next < buffered.size() && less_tid(buffered[next], tid)) {
+            if (sink.put(buffered[next++]) == false)
+                return false;
+        }
+        if (next < buffered.size() && equal_tid(buffered[next], tid))
+            ++next;
+        return sink.put(tid);
+    }
+
+    // restliche gepufferte TIDs nach dem Ende der Liste im Baum
+    bool finish() {
+        while (next < buffered.size()) {
+            if (sink.put(buffered[next++]) == false)
+                return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Schreibt TIDs in den Bereich des Aufrufers von findSpan(), false sobald er voll ist
+ */
+struct span_sink : public DBMyIndexSink {
+    TID *tids;
+    uint capacity;
+    uint count;
+
+    span_sink(TID *tids, uint capacity) : tids(tids), capacity(capacity), count(0) {}
+
+    bool put(const TID &tid) {
+        if (count == capacity)
+            return false;
+        tids[count++] = tid;
+        return true;
+    }
+};
+
+/**
+ * Kopie der gepufferten Eintraege fuer Lesezugriffe (siehe buffer_snapshot()),
+ * gibt ihre Schluessel frei
+ */
+struct buffered_entries {
+    vector<pair<DBAttrType *, TID> > entries;
+
+    ~buffered_entries() {
+        clear();
+    }
+
+    void clear() {
+        for (uint i = 0; i < entries.size(); ++i)
+            delete entries[i].first;
+        entries.clear();
+    }
+};
+
+/**
+ * Sortierkriterium der gepufferten Eintraege: nach Schluessel, gleiche Schluessel in Heap-Reihenfolge
+ */
+static bool less_buffered(const pair<DBAttrType *, TID> &a, const pair<DBAttrType *, TID> &b) {
+    if (a.first->operator<(*b.first))
+        return true;
+    if (b.first->operator<(*a.first))
+        return false;
+    return less_tid(a.second, b.second);
+}
+
+/**
+ * Haengt val mit seinen TIDs (aufsteigend, ohne Duplikate) an die Felder eines Snapshots an
+ */
+static void append_snapshot_key(const DBAttrType &val, vector<TID> &postings, uint keySize, bool unique,
+                                vector<char> &keys, vector<uint64_t> &starts, vector<TID> &tids) {
+    sort(postings.begin(), postings.end(), less_tid);
+    postings.erase(std::unique(postings.begin(), postings.end(), equal_tid), postings.end());
+    keys.resize(keys.size() + keySize);
+    val.write(&keys[keys.size() - keySize]);
+    if (unique == false)
+        starts.push_back(tids.size());
+    tids.insert(tids.end(), postings.begin(), postings.end());
+}
+
+/**
+ * Haengt value als Varint (7 Bit pro Byte, hoechstes Bit = weitere Bytes folgen) an blob an
+ */
+static void put_varint(vector<char> &blob, uint value) {
+    while (value >= 0x80) {
+        blob.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    blob.push_back((char) value);
+}
+
+/**
+ * Liest einen Varint ab ptr und setzt ptr hinter ihn
+ */
+static uint get_varint(const char *&ptr) {
+    uint value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = (unsigned char) *ptr++;
+        value |= (uint) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/**
+ * Suchkerne fuer zusammenhaengend abgelegte INTEGER- und DOUBLE-Schluessel:
+ * Anzahl der Schluessel < val (orEqual: <= val). Bei sortierten Schluesseln ist das
+ * die Position aus lower_pos bzw. upper_pos.
+ */
+template<typename T>
+static int count_less_scalar(const char *keys, int count, T val, bool orEqual) {
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        T key;
+        memcpy(&key, keys + i * sizeof(T), sizeof(T));
+        //key <= val wie _CMP_LE_OQ der Vektorkerne (auch fuer NaN gleiches Ergebnis)
+        n += orEqual ? key <= val : key < val;
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+static int count_less_int_sse2(const char *keys, int count, int val, bool orEqual) {
+    __m128i v = _mm_set1_epi32(val);
+    int n = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i k = _mm_loadu_si128((const __m128i *) (keys + i * sizeof(int)));
+        //orEqual: key <= val  <=>  !(key > val)
+        __m128i m = orEqual ? _mm_cmpgt_epi32(k, v) : _mm_cmplt_epi32(k, v);
+        int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        n += orEqual ? 4 - bits : bits;
+    }
+    return n + count_less_scalar<int>(keys + i * sizeof(int), count - i, val, orEqual);
+}
+
+__attribute__((target("avx2")))
+static int count_less_int_avx2(const char *keys, int count, int val, bool orEqual) {
+    __m256i v = _mm256_set1_epi32(val);
+    int n = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i k = _mm256_loadu_si256((const __m256i *) (keys + i * sizeof(int)));
+        __m256i m = orEqual ? _mm256_cmpgt_epi32(k, v) : _mm256_cmpgt_epi32(v, k);
+        int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        n += orEqual ? 8 - bits : bits;
+    }
+    return n + count_less_scalar<int>(keys + i * sizeof(int), count - i, val, orEqual);
+}
+
+__attribute__((target("sse2")))
+static int count_less_double_sse2(const char *keys, int count, double val, bool orEqual) {
+    __m128d v = _mm_set1_pd(val);
+    int n = 0, i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d k = _mm_loadu_pd((const double *) (keys + i * sizeof(double)));
+        __m128d m = orEqual ? _mm_cmple_pd(k, v) : _mm_cmplt_pd(k, v);
+        n += __builtin_popcount(_mm_movemask_pd(m));
+    }
+    return n + count_less_scalar<double>(keys + i * sizeof(double), count - i, val, orEqual);
+}
+
+__attribute__((target("avx2")))
+static int count_less_double_avx2(const char *keys, int count, double val, bool orEqual) {
+    __m256d v = _mm256_set1_pd(val);
+    int n = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d k = _mm256_loadu_pd((const double *) (keys + i * sizeof(double)));
+        __m256d m = orEqual ? _mm256_cmp_pd(k, v, _CMP_LE_OQ) : _mm256_cmp_pd(k, v, _CMP_LT_OQ);
+        n += __builtin_popcount(_mm256_movemask_pd(m));
+    }
+    return n + count_less_scalar<double>(keys + i * sizeof(double), count - i, val, orEqual);
+}
+#endif
+
+// zur Laufzeit gewaehlte Suchkerne: AVX2, SSE2 oder skalar
+typedef int (*count_less_int_fn)(const char *, int, int, bool);
+typedef int (*count_less_double_fn)(const char *, int, double, bool);
+
+static count_less_int_fn select_count_less_int() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return count_less_int_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return count_less_int_sse2;
+#endif
+    return count_less_scalar<int>;
+}
+
+static count_less_double_fn select_count_less_double() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return count_less_double_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return count_less_double_sse2;
+#endif
+    return count_less_scalar<double>;
+}
+
+static const count_less_int_fn count_less_int = select_count_less_int();
+static const count_less_double_fn count_less_double = select_count_less_double();
+
+/**
+ * Setzt die Bits des Schluessels mit Hashwert h, Rueckgabe true, wenn sich ein Bit geaendert hat.
+ * Die oberen 32 Bit waehlen die Zeile, die unteren die Bits darin (doppeltes Hashing).
+ */
+static bool set_filter_bits(vector<uint64_t> &bits, uint numHashes, uint64_t h) {
+    uint64_t *line = &bits[(h >> 32) % (bits.size() / filterLineWords) * filterLineWords];
+    uint a = h & (filterLineBits - 1);
+    uint b = ((h >> 9) & (filterLineBits - 1)) | 1;
+    bool changed = false;
+    for (uint i = 0; i < numHashes; ++i) {
+        uint bit = (a + i * b) & (filterLineBits - 1);
+        uint64_t mask = (uint64_t) 1 << (bit & 63);
+        if ((line[bit >> 6] & mask) == 0) {
+            line[bit >> 6] |= mask;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * false, wenn der Schluessel mit Hashwert h sicher nicht im Filter ist
+ */
+static bool test_filter_bits(const vector<uint64_t> &bits, uint numHashes, uint64_t h) {
+    const uint64_t *line = &bits[(h >> 32) % (bits.size() / filterLineWords) * filterLineWords];
+    uint a = h & (filterLineBits - 1);
+    uint b = ((h >> 9) & (filterLineBits - 1)) | 1;
+    for (uint i = 0; i < numHashes; ++i) {
+        uint bit = (a + i * b) & (filterLineBits - 1);
+        if ((line[bit >> 6] & ((uint64_t) 1 << (bit & 63))) == 0)
+            return false;
+    }
+    return true;
+}
 
 /**
  * Ausgabe des Indexes zum Debuggen
@@ -38,8 +608,11 @@ string DBMyIndex::toString(string linePrefix) const {
     stringstream ss;
     ss << linePrefix << "[DBMyIndex]" << endl;
     ss << DBIndex::toString(linePrefix + "\t") << endl;
-    ss << linePrefix << "tidsPerEntry: " << tidsPerEntry << endl;
+    ss << linePrefix << "unique: " << unique << endl;
+    if (isComposite())
+        ss << linePrefix << "keyTypes: " << keyTypes.size() << ", includeTypes: " << includeTypes.size() << endl;
     ss << linePrefix << "entriesPerPage: " << entriesPerPage() << endl;
+    ss << linePrefix << "rootTID: " << rootTID.toString() << endl;
     ss << linePrefix << "-----------" << endl;
     return ss.str();
 }
@@ -55,41 +628,97 @@ DBMyIndex::DBMyIndex(DBBufferMgr &bufferMgr, DBFile &file,
                      enum AttrTypeEnum attrType, ModType mode, bool unique) :
 // call base constructor
         DBIndex(bufferMgr, file, attrType, mode, unique),
-        // wenn unqiue dann nur ein Tupel pro value, ansonsten den wert vom oben gesetzen MAX_TID_PER_ENTRY
-        tidsPerEntry(unique == true ? 1 : MAX_TID_PER_ENTRY),
-        // DBAttrType first_ und last_ = NULL
-        // diese beiden Werte dienen um den ersten und letzten Wert eines Blockes
-        // temporaer zwischenzuspeichern --> siehe genFirstLast()
-        //ToDo: Brauchen wir den?
-        first_(NULL), last_(NULL) {
+        // DBAttrType last_ = NULL, first_ liegt im Cursor jedes Threads --> siehe fix_right_leaf()
+        instanceId(++instanceCount), last_(NULL) {
+    if (logger != NULL) {
+        LOG4CXX_INFO(logger, "DBMyIndex()");
+    }
+    open();
+}
+
+/** Konstruktor fuer zusammengesetzte Schluessel
+ * - const vector<AttrTypeEnum> & keyTypes (Typen der Schluesselattribute, lexikographisch verglichen)
+ * - const vector<AttrTypeEnum> & includeTypes (in den Blaettern mitgespeicherte Attribute,
+ *   nur bei eindeutigen Indexen, siehe findCovered())
+ * Schluessel werden als DBMyCompositeKey uebergeben.
+ */
+DBMyIndex::DBMyIndex(DBBufferMgr &bufferMgr, DBFile &file, const vector<AttrTypeEnum> &keyTypes,
+                     const vector<AttrTypeEnum> &includeTypes, ModType mode, bool unique) :
+        DBIndex(bufferMgr, file, keyTypes.empty() ? INT : keyTypes[0], mode, unique),
+        keyTypes(keyTypes), includeTypes(includeTypes),
+        instanceId(++instanceCount), last_(NULL) {
     if (logger != NULL) {
         LOG4CXX_INFO(logger, "DBMyIndex()");
     }
+    if (keyTypes.empty())
+        throw DBIndexException("composite key without attributes");
+    //je Schluessel gibt es nur einen Eintrag, mitgespeicherte Attribute gehoeren aber zur TID
+    if (includeTypes.empty() == false && unique == false)
+        throw DBIndexException("included attributes require a unique index");
+    open();
+}
 
+/**
+ * Gemeinsamer Teil der Konstruktoren: legt die Indexdatei ggf. an und meldet den Index an
+ */
+void DBMyIndex::open() {
     assert(entriesPerPage() > 1);
+    //Laengenbyte der Saetze in Seiten mit Slotverzeichnis
+    assert(isCompressed() == false || keySize() <= UCHAR_MAX);
 
     //	if(unique == false && isIndexNonUniqueAble() == false)
     //		throw HubDB::Exception::DBIndexException("set up nonunique but index does not support it");
 
+    latencyFindHit = DBMyLatency::series("DBMyIndex::find", file.getFileName(), "hit");
+    latencyFindMiss = DBMyLatency::series("DBMyIndex::find", file.getFileName(), "miss");
+    latencyInsert = DBMyLatency::series("DBMyIndex::insert", file.getFileName(), "");
+    latencyRemove = DBMyLatency::series("DBMyIndex::remove", file.getFileName(), "");
+    {
+        lock_guard<mutex> guard(redoLogsMutex);
+        redoLog = &redoLogs[file.getFileName()];
+    }
+    redo_scope scope(*this);
     // if this function is called for the first time -> index file has 0 blocks
     // -> call initializeIndex to create file
+    bool created = false;
     if (bufMgr.getBlockCnt(file) == 0) {
         LOG4CXX_DEBUG(logger, "initializeIndex");
         initializeIndex();
+        created = true;
     }
-
-    // fuege ersten Block der Indexdatei in den Stack der geblockten Bloecke hinzu
-    int foo = rootBlockNo;
-    bacbStack.push(bufMgr.fixBlock(file, foo, LOCK_EXCLUSIVE));
-    char *swap_ptr = bacbStack.top().getDataPtr();
-    rootTID.read(swap_ptr);
-    if (rootTID.page != 0) {
-        bacbStack.pop();
-        bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_EXCLUSIVE));
-
+    // vor dem Lesen des Metablocks: nach einem Absturz den Log einspielen
+    open_log(created);
+
+    // TID der Wurzel aus dem Metablock lesen, sie aendert sich danach nicht mehr
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_SHARED);
+    rootTID.read(meta.getDataPtr());
+    uint flags;
+    memcpy(&flags, meta.getDataPtr() + meta_flags_offset(), sizeof(uint));
+    unfix_block(meta);
+
+    DBBACB root = bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED);
+    node_header root_head;
+    read_head(root.getDataPtr(), root_head);
+    unfix_block(root);
+    if (root_head.format != nodeFormat)
+        throw DBIndexException("index file has an unsupported node format, rebuild the index");
+
+    {
+        lock_guard<mutex> guard(openIndexesMutex);
+        structureVersion = &structureVersions[file.getFileName()];
+        insertBuffer = &insertBuffers[file.getFileName()];
+        filter = &filters[file.getFileName()];
+        counted = &countedIndexes[file.getFileName()];
+        counted->store((flags & countedFlag) != 0);
+        keyCache = &keyCaches[file.getFileName()];
     }
+    load_filter(created);
+    if (created)
+        cache_clear();
+    log_commit();
 
-    //ree = printTree();
+    lock_guard<mutex> guard(openIndexesMutex);
+    openIndexes.insert(this);
 
     if (logger != NULL) {
         LOG4CXX_DEBUG(logger, "this:\n" + toString("\t"));
@@ -98,21 +727,131 @@ DBMyIndex::DBMyIndex(DBBufferMgr &bufferMgr, DBFile &file,
 
 /**
  * Destrkctor
- * Soll first_, last_ und alle geblockten Bloecke wieder freigeben
+ * Soll die Cursor aller Threads, last_ und alle geblockten Bloecke wieder freigeben.
+ * Andere Threads duerfen den Index dann nicht mehr benutzen.
  */
 DBMyIndex::~DBMyIndex() {
     LOG4CXX_INFO(logger, "~DBMyIndex()");
+    {
+        lock_guard<mutex> guard(openIndexesMutex);
+        openIndexes.erase(this);
+    }
     unfixBACBs(false);
-    if (first_ != NULL)
-        delete first_;
+    try {
+        flushInsertBuffer();
+    } catch (DBException &e) {
+        LOG4CXX_ERROR(logger, "flush of insert buffer failed");
+    }
+    try {
+        lock_guard<mutex> guard(filter->lock);
+        if (filter->dirty)
+            persist_filter();
+    } catch (DBException &e) {
+        LOG4CXX_ERROR(logger, "persisting the filter failed");
+    }
+    //danach gibt kein endender Thread mehr Cursor dieser Instanz frei
+    map<thread::id, op_cursor *> owned;
+    {
+        lock_guard<mutex> guard(cursorsMutex);
+        liveIndexes.erase(instanceId);
+        owned.swap(cursors);
+    }
+    try {
+        // Bilder abgebrochener Operationen anderer Threads stehen noch in deren Cursor; keiner
+        // dieser Threads haengt sie mehr an, ihre Gruppen gelten als wartend (siehe log_append())
+        {
+            lock_guard<mutex> guard(redoLog->lock);
+            for (map<thread::id, op_cursor *>::iterator it = owned.begin(); it != owned.end(); ++it)
+                if (it->second->redoGroup != 0)
+                    redoLog->open[it->second->redoGroup].waiting = true;
+        }
+        uint64_t end = 0;
+        for (map<thread::id, op_cursor *>::iterator it = owned.begin(); it != owned.end(); ++it) {
+            log_append(*redoLog, *it->second);
+            end = max(end, it->second->redoEnd);
+        }
+        sync_log(*redoLog, end);
+    } catch (DBException &e) {
+        LOG4CXX_ERROR(logger, "commit of the write-ahead log failed");
+    }
+    for (map<thread::id, op_cursor *>::iterator it = owned.begin(); it != owned.end(); ++it)
+        free_cursor(*redoLog, it->second);
     if (last_ != NULL)
         delete last_;
 }
 
+/**
+ * Cursor des aufrufenden Threads: jede Operation haelt ihren Zustand dort, so koennen mehrere
+ * Threads dieselbe Instanz gleichzeitig benutzen. Der Thread findet seine Cursor ohne Sperre
+ * (zuletzt benutzter, sonst owned_cursors()); nur beim ersten Gebrauch einer Instanz wird er
+ * unter cursorsMutex angelegt. instanceIds werden nicht wiederverwendet, Eintraege zerstoerter
+ * Instanzen passen also nie und werden dabei entfernt.
+ */
+DBMyIndex::op_cursor &DBMyIndex::cursor() {
+    static thread_local unsigned long cachedId = 0;
+    static thread_local op_cursor *cached = NULL;
+    if (cachedId == instanceId)
+        return *cached;
+
+    cursor_owner &owner = owned_cursors();
+    map<unsigned long, op_cursor *>::iterator it = owner.cursors.find(instanceId);
+    if (it == owner.cursors.end()) {
+        lock_guard<mutex> guard(cursorsMutex);
+        for (it = owner.cursors.begin(); it != owner.cursors.end();) {
+            if (liveIndexes.count(it->first) == 0)
+                owner.cursors.erase(it++);
+            else
+                ++it;
+        }
+        op_cursor *cur = new op_cursor();
+        liveIndexes[instanceId] = this;
+        cursors[this_thread::get_id()] = cur;
+        it = owner.cursors.insert(make_pair(instanceId, cur)).first;
+    }
+    cachedId = instanceId;
+    cached = it->second;
+    return *it->second;
+}
+
+/**
+ * Cursor des aufrufenden Threads in allen Instanzen
+ */
+DBMyIndex::cursor_owner &DBMyIndex::owned_cursors() {
+    static thread_local cursor_owner owner;
+    return owner;
+}
+
+/**
+ * Ende des Threads: gibt seine Cursor in noch bestehenden Instanzen frei (die uebrigen hat der
+ * Destruktor der Instanz freigegeben)
+ */
+DBMyIndex::cursor_owner::~cursor_owner() {
+    lock_guard<mutex> guard(cursorsMutex);
+    for (map<unsigned long, op_cursor *>::iterator it = cursors.begin(); it != cursors.end(); ++it) {
+        map<unsigned long, DBMyIndex *>::iterator index = liveIndexes.find(it->first);
+        if (index == liveIndexes.end())
+            continue;
+        index->second->cursors.erase(this_thread::get_id());
+        free_cursor(*index->second->redoLog, it->second);
+    }
+}
+
+/**
+ * Gibt cur frei; Bilder einer abgebrochenen Operation kommen vorher in den Log
+ */
+void DBMyIndex::free_cursor(redo_log &log, op_cursor *cur) {
+    log_append(log, *cur);
+    clear_mirror(*cur);
+    if (cur->first_ != NULL)
+        delete cur->first_;
+    delete cur;
+}
+
 /**
  * Freigeben aller vom Index geblockten Bloecke
  */
 void DBMyIndex::unfixBACBs(bool setDirty) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     LOG4CXX_INFO(logger, "unfixBACBs()");
     LOG4CXX_DEBUG(logger, "setDirty: " + TO_STR(setDirty));
     LOG4CXX_DEBUG(logger, "bacbStack.size()= " + TO_STR(bacbStack.size()));
@@ -122,50 +861,106 @@ void DBMyIndex::unfixBACBs(bool setDirty) {
                 if (setDirty == true)
                     bacbStack.top().setDirty();
             }
-            bufMgr.unfixBlock(bacbStack.top());
+            // verworfene Aenderungen kommen nicht in den Log
+            if (setDirty == true)
+                bufMgr.unfixBlock(bacbStack.top());
+            else
+                unfix_block(bacbStack.top());
         } catch (DBException e) {
         }
         bacbStack.pop();
     }
+    log_append(*redoLog, cursor());
 }
 
 void DBMyIndex::emtpyBACBs() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     while (bacbStack.empty() == false) {
         try {
             if (bacbStack.top().getModified()) {
                 bacbStack.top().setModified();
             }
-            bufMgr.unfixBlock(bacbStack.top());
+            unfix_block(bacbStack.top());
         } catch (DBException e) {
         }
         bacbStack.pop();
     }
 }
 
+/**
+ * Gibt alle Knoten des aktuellen Abstiegs wieder frei
+ */
+void DBMyIndex::unfix_path() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    while (bacbStack.empty() == false) {
+        unfix_block(bacbStack.top());
+        bacbStack.pop();
+    }
+}
+
+/**
+ * Gibt alle Vorgaenger des Knotens auf bacbStack.top() frei; path wird geleert.
+ */
+void DBMyIndex::release_ancestors(stack<int> &path) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    if (bacbStack.size() > 1) {
+        DBBACB node = bacbStack.top();
+        bacbStack.pop();
+        unfix_path();
+        bacbStack.push(node);
+    }
+    path = stack<int>();
+}
+
 
 /**
  * Gibt die Anzahl der Eintraege pro Seite zurueck
  *
  * Gesamtblockgroesse: DBFileBlock::getBlockSize()
- * Platz zum Speichern der Position des ersten freien Blockes: sizeof(uint)
+ * Platz fuer den Knotenkopf: sizeOfHead (bei VARCHAR zusaetzlich sizeOfKeyHead)
  * Laenge des Schluesselattributs: DBAttrType::getSize4Type(attrType)
  * Groesse der TID (siehe DBTypes.h): sizeof(TID)
- * Eintraege (TIDs) pro Schluesseleintrag (maximal MAX_TID_PER_ENTRY or 1 when unique): tidsPerEntry
  *
- * Bsp.: VARCHAR: entriesPerPage() = (1024-4) / (30+8*20) = 5, Rest 70
- * Bsp.: INTEGER UNIQUE: entriesPerPage() = (1024-4) / (4+8*1) = 85, Rest 0
+ * Bei VARCHAR ist das die garantierte Mindestanzahl, komprimierte Seiten fassen mehr.
+ *
+ * Bsp.: INTEGER: entriesPerPage() = (1024-16) / (4+8) = 84, Rest 0
  */
 uint DBMyIndex::entriesPerPage() const {
-    //ToDo: Ändern der entries per Page berechnung auf blätter
+    uint head = sizeOfHead + (isCompressed() ? sizeOfKeyHead : 0);
+    return (DBFileBlock::getBlockSize() - head) / entrySize();
+}
+
+/**
+ * Laenge eines gespeicherten Schluessels
+ */
+uint DBMyIndex::keySize() const {
+    if (isComposite())
+        return DBMyCompositeKey::getSize(keyTypes) + DBMyCompositeKey::getSize(includeTypes);
+    return DBAttrType::getSize4Type(attrType);
+}
+
+/**
+ * Liest einen gespeicherten Schluessel (muss vom Aufrufer geloescht werden)
+ */
+DBAttrType *DBMyIndex::read_key(const char *ptr) const {
+    if (isComposite())
+        return DBMyCompositeKey::read(ptr, keyTypes, includeTypes);
+    return DBAttrType::read(ptr, attrType);
+}
 
-    return (DBFileBlock::getBlockSize() - sizeof(uint)) /
-           (DBAttrType::getSize4Type(attrType) + sizeof(TID) * tidsPerEntry);
+/**
+ * Laenge eines Eintrags (Schluessel, TID) im Knoten
+ */
+uint DBMyIndex::entrySize() const {
+    return keySize() + sizeof(TID);
 }
 
 /**
  * Erstelle Indexdatei.
+ * Block 0: Metadaten (TID der Wurzel, leere Freiliste), Block 1: leeres Wurzelblatt
  */
 void DBMyIndex::initializeIndex() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     LOG4CXX_INFO(logger, "initializeIndex()");
     if (bufMgr.getBlockCnt(file) != 0)
         throw DBIndexException("can not initializie exisiting table");
@@ -173,39 +968,33 @@ void DBMyIndex::initializeIndex() {
     try {
         // einen ersten Block der Datei erhalten und gleich fixen
         bacbStack.push(bufMgr.fixNewBlock(file));
-        // modified date setzen
 
         TID roottid;
-        roottid.page = 0;
-        bool isroot = true;
-        bool isleaf = true;
-
-        bool *boolptr = &isroot;
+        roottid.page = rootBlockNo + 1;
+        roottid.slot = 0;
         char *ptr = bacbStack.top().getDataPtr();
-        uint *cnt = (uint *) ptr;
-        if (*cnt == 0) {
-            memcpy(ptr, &roottid, sizeof(TID));
-            ptr += sizeof(TID);
-            // memcpy (*destination, *source, size);
-            memcpy(ptr, boolptr, sizeof(bool));
-            ptr += sizeof(bool);
-            memcpy(ptr, boolptr, sizeof(bool));
-            ptr += sizeof(bool);
-            int fill_level = 0;
-            memcpy(ptr, &fill_level, sizeof(int));
-            ptr += sizeof(int);
-            TID next;
-            next.page = -1;
-            memcpy(ptr, &next, sizeof(TID));
-        }
+        // Beschreibung des Filters bleibt leer (filterNone)
+        memset(ptr, 0, DBFileBlock::getBlockSize());
+        roottid.write(ptr);
+        TID freetid;
+        freetid.page = noBlockNo;
+        freetid.slot = 0;
+        freetid.write(ptr + sizeof(TID));
+        // modified date setzen
         bacbStack.top().setModified();
+        unfix_block(bacbStack.top());
+        bacbStack.pop();
+
+        TID next;
+        next.page = noBlockNo;
+        initNode(true, true, next);
+        unfix_block(bacbStack.top());
+        bacbStack.pop();
     } catch (DBException e) {
         if (bacbStack.empty() == false)
-            bufMgr.unfixBlock(bacbStack.top());
+            unfix_block(bacbStack.top());
         throw e;
     }
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
 
     // nun muss die liste der geblockten Seiten wieder leer sein, sonst Abbruch
     assert(bacbStack.empty() == true);
@@ -219,1072 +1008,4858 @@ void DBMyIndex::initializeIndex() {
  * von TID Objekten (siehe DBTypes.h: typedef list<TID> DBListTID;)
  */
 void DBMyIndex::find(const DBAttrType &val, DBListTID &tids) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     LOG4CXX_INFO(logger, "find()");
     LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
 
-    // ein Block muss geblockt sein
-    if (bacbStack.size() != 1)
+    // zwischen zwei Operationen ist kein Block geblockt
+    if (bacbStack.empty() == false)
         throw DBIndexException("BACB Stack is invalid");
 
     // Löschen der uebergebenen Liste ("Returnliste")
     tids.clear();
-    search_in_node(val, tids);
 
-    //ToDo: Implement Search in Tree and fill List tids
+    // Reihe nach dem Ergebnis: hit, wenn val im Index steht
+    DBMyLatency::Timer timer(latencyFindMiss);
+    unsigned long generation;
+    if (cache_lookup(val, tids, generation)) {
+        timer.setSeries(tids.empty() ? latencyFindMiss : latencyFindHit);
+        return;
+    }
+
+    // zuerst der Einfuegepuffer: was ihn waehrend der Suche verlaesst, steht schon im Baum;
+    // ausgeschaltet ist er leer
+    vector<TID> buffered;
+    if (insertBuffer->capacity > 0) {
+        lock_guard<mutex> guard(insertBuffer->lock);
+        buffer_lookup(val, buffered);
+    }
+
+    find_in_tree(val, tids);
+    if (buffered.empty() == false) {
+        buffered.insert(buffered.end(), tids.begin(), tids.end());
+        sort(buffered.begin(), buffered.end(), less_tid);
+        buffered.erase(std::unique(buffered.begin(), buffered.end(), equal_tid), buffered.end());
+        tids.assign(buffered.begin(), buffered.end());
+    }
+    cache_fill(val, tids, generation);
+    timer.setSeries(tids.empty() ? latencyFindMiss : latencyFindHit);
 }
 
 /**
- * Einfuegen eines Schluesselwertes (moeglicherweise bereits vorhangen)
- * zusammen mit einer Referenz auf eine TID.
+ * Sucht val nur im Baum und haengt die TIDs an tids an
  */
-void DBMyIndex::insert(const DBAttrType &val, const TID &tid) {
-    LOG4CXX_INFO(logger, "insert()");
-    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
-    LOG4CXX_DEBUG(logger, "tid: " + tid.toString());
-
-    // vor Beginn der Operation darf nur genau eine Seite
-    // (wie immer die nullte) gelockt sein
-
-    if (bacbStack.size() != 1)
-        throw DBIndexException("BACB Stack is invalid");
-
-    // wenn diese eine Seite nicht exclusive gelockt ist, dann dies nachholen!
-    if (bacbStack.top().getLockMode() != LOCK_EXCLUSIVE)
-        bufMgr.upgradeToExclusive(bacbStack.top());
-
-
-    TID rootTID;
-    rootTID.read(bacbStack.top().getDataPtr());
-    search_in_node(val, tid, rootTID, nullptr, false);
-    // am Ende der operation muss genau eine Seite gelockt sein
-    if (bacbStack.size() != 1)
-        throw DBIndexException("BACB Stack is invalid");
+void DBMyIndex::find_in_tree(const DBAttrType &val, DBListTID &tids) {
+    if (may_contain(val) == false)
+        return;
+    stack<int> path;
+    try {
+        descend_to_leaf(val, LATCH_READ, path, NULL);
+        search_in_node(val, tids);
+    } catch (DBException &e) {
+        unfix_path();
+        throw;
+    }
+    unfix_path();
 }
 
 /**
- * Entfernt alle Tupel aus der Liste der tids.
- * Um schneller auf der richtigen Seite mit dem Entfernen anfangen zu koennen,
- * wird zum Suchen auch noch der zu loeschende value uebergeben
+ * Wie find(), liefert die TIDs zu val aber ohne Zwischenliste aufsteigend an sink.
+ * sink.put() laeuft unter der geteilten Sperre des Blattes: es darf den Index nicht benutzen
+ * und keine andere Ausnahme als DBException werfen. Der Schluesselcache wird nicht benutzt.
+ * Rueckgabe false, wenn sink abgebrochen hat.
  */
-void DBMyIndex::remove(const DBAttrType &val, const list<TID> &tid) {
-    LOG4CXX_INFO(logger, "remove()");
+bool DBMyIndex::findEach(const DBAttrType &val, DBMyIndexSink &sink) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "findEach()");
     LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
 
-    // vor Beginn der Operation darf nur genau eine Seite (wie immer die nullte) gelockt sein
-    if (bacbStack.size() != 1)
+    if (bacbStack.empty() == false)
         throw DBIndexException("BACB Stack is invalid");
 
-    // wenn diese eine Seite nicht exclusive gelockt ist, dann dies nachholen!
-    if (bacbStack.top().getLockMode() != LOCK_EXCLUSIVE)
-        bufMgr.upgradeToExclusive(bacbStack.top());
-
-    // wenn das Indexattribut unique ist, dann darf in der Liste TID nie mehr als ein Wert stehen
-    if (unique == true && tid.size() > 1)
-        throw DBIndexUniqueKeyException("try to remove multiple key but is unique index");
-
-    // Suchen auf welcher seite Tupel mit val im IndexAttribute liegen (wenn vorhanden)
-    // oder liegen koennten (wenn nicht vorhanden) und die in variable 'page' abspeichern
+    return stream_find(val, NULL, sink);
+}
 
-    //ToDo: Implementierung von suche des leafs und löschen dieser - dabei merge berücksichtigen
+/**
+ * Schreibt bis zu capacity TIDs zu val aufsteigend nach tids und gibt ihre Anzahl zurueck.
+ * Ein weiterer Aufruf mit derselben cont setzt hinter der zuletzt gelieferten TID fort, bis
+ * cont.done gesetzt ist. Zwischen den Aufrufen ist kein Block gefixt; inzwischen eingefuegte
+ * TIDs hinter dieser Position werden noch geliefert.
+ */
+uint DBMyIndex::findSpan(const DBAttrType &val, TID *tids, uint capacity, FindContinuation &cont) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "findSpan()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    LOG4CXX_DEBUG(logger, "capacity: " + TO_STR(capacity));
 
-    // am Ende der Operation muss genau eine Seite gelockt sein
-    if (bacbStack.size() != 1)
+    if (bacbStack.empty() == false)
         throw DBIndexException("BACB Stack is invalid");
+    if (capacity == 0)
+        throw DBIndexException("findSpan needs room for at least one tid");
+    if (cont.done)
+        return 0;
+
+    span_sink span(tids, capacity);
+    cont.done = stream_find(val, cont.started ? &cont.last : NULL, span);
+    if (span.count > 0) {
+        cont.started = true;
+        cont.last = tids[span.count - 1];
+    }
+    return span.count;
 }
 
-
 /**
- * Fuegt createDBMyIndex zur globalen factory method-map hinzu
+ * Liefert die TIDs zu val hinter after (NULL: alle) aufsteigend an sink, gepufferte
+ * Einfuegungen werden eingemischt. Rueckgabe false, wenn sink abgebrochen hat.
  */
-int DBMyIndex::registerClass() {
-    setClassForName("DBMyIndex", createDBMyIndex);
-    return 0;
-}
-
+bool DBMyIndex::stream_find(const DBAttrType &val, const TID *after, DBMyIndexSink &sink) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    // wie in find() zuerst der Einfuegepuffer
+    vector<TID> buffered;
+    if (insertBuffer->capacity > 0) {
+        lock_guard<mutex> guard(insertBuffer->lock);
+        buffer_lookup(val, buffered);
+    }
+    sort(buffered.begin(), buffered.end(), less_tid);
+    if (after != NULL)
+        buffered.erase(buffered.begin(), upper_bound(buffered.begin(), buffered.end(), *after, less_tid));
+
+    merge_sink merge(sink, after, buffered);
+    bool complete = true;
+    if (may_contain(val)) {
+        stack<int> path;
+        try {
+            descend_to_leaf(val, LATCH_READ, path, NULL);
+            char *ptr = bacbStack.top().getDataPtr();
+            node_header head;
+            read_head(ptr, head);
+            int pos = lower_pos(ptr, head, val);
+            if (pos < head.fill_level) {
+                DBAttrType *key = key_at(ptr, pos);
+                bool equal = key->operator==(val);
+                delete key;
+                if (equal)
+                    complete = decode_postings(tid_at(ptr, pos), ptr, merge);
+            }
+        } catch (DBException &e) {
+            unfix_path();
+            throw;
+        }
+        unfix_path();
+    }
+    return complete && merge.finish();
+}
+
+/**
+ * Sucht viele Schluessel in einem Durchgang, z.B. fuer Index-Nested-Loop-Joins.
+ * Die Suchschluessel werden sortiert. Zuerst werden ihre Blaetter ueber den Spiegel der
+ * inneren Knoten bestimmt, dabei laufen interleavedProbes Abstiege verschraenkt (siehe
+ * locate_leaves()); danach wird jedes Blatt einmal gefixt und alle seine Schluessel gesucht.
+ * Ohne Spiegel oder nach zwischenzeitlichen Strukturaenderungen wird wie bisher abgestiegen:
+ * solange der naechste Schluessel kleiner als die obere Schranke des gefixten Blattes ist,
+ * wird im selben Blatt weitergesucht.
+ * results[i] enthaelt die TIDs zu keys[i], also in der Reihenfolge des Aufrufers.
+ */
+void DBMyIndex::findBatch(const vector<const DBAttrType *> &keys, vector<DBListTID> &results) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "findBatch()");
+    LOG4CXX_DEBUG(logger, "keys: " + TO_STR(keys.size()));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+
+    // wie in find() zuerst der Einfuegepuffer, seine TIDs werden am Ende eingemischt
+    vector<vector<TID> > buffered(keys.size());
+    if (insertBuffer->capacity > 0) {
+        lock_guard<mutex> guard(insertBuffer->lock);
+        for (uint i = 0; i < keys.size(); ++i)
+            buffer_lookup(*keys[i], buffered[i]);
+    }
+    results.assign(keys.size(), DBListTID());
+    vector<uint> order(keys.size());
+    for (uint i = 0; i < order.size(); ++i)
+        order[i] = i;
+    sort(order.begin(), order.end(), less_probe(keys));
+    vector<bool> candidate(keys.size(), true);
+    {
+        lock_guard<mutex> guard(filter->lock);
+        if (filter->bits.empty() == false) {
+            for (uint i = 0; i < keys.size(); ++i)
+                candidate[i] = test_filter_bits(filter->bits, filter->numHashes, filter_hash(*keys[i]));
+        }
+    }
+
+    //verschiedene Kandidaten in Schluesselreihenfolge, gleiche Schluessel werden einmal gesucht
+    vector<uint> probes;
+    for (uint i = 0; i < order.size(); ++i) {
+        if (candidate[order[i]] && (i == 0 || keys[order[i - 1]]->operator==(*keys[order[i]]) == false))
+            probes.push_back(order[i]);
+    }
+
+    stack<int> path;
+    DBAttrType *upper = NULL;
+    bool inLeaf = false;
+    try {
+        vector<BlockNo> leaves;
+        uint done = 0;
+        if (locate_leaves(keys, probes, leaves))
+            done = search_leaves(keys, probes, leaves, results);
+        for (uint i = done; i < probes.size(); ++i) {
+            const DBAttrType &val = *keys[probes[i]];
+            if (inLeaf && upper != NULL && val.operator<(*upper) == false) {
+                unfix_path();
+                inLeaf = false;
+            }
+            if (inLeaf == false) {
+                if (upper != NULL)
+                    delete upper;
+                upper = NULL;
+                path = stack<int>();
+                descend_to_leaf(val, LATCH_READ, path, &upper);
+                inLeaf = true;
+            }
+            search_in_node(val, results[probes[i]]);
+        }
+    } catch (DBException &e) {
+        if (upper != NULL)
+            delete upper;
+        unfix_path();
+        throw;
+    }
+    if (upper != NULL)
+        delete upper;
+    unfix_path();
+
+    // gleicher Schluessel wie zuvor: Ergebnis uebernehmen
+    for (uint i = 1; i < order.size(); ++i) {
+        if (keys[order[i - 1]]->operator==(*keys[order[i]]))
+            results[order[i]] = results[order[i - 1]];
+    }
+    for (uint i = 0; i < keys.size(); ++i) {
+        if (buffered[i].empty())
+            continue;
+        buffered[i].insert(buffered[i].end(), results[i].begin(), results[i].end());
+        sort(buffered[i].begin(), buffered[i].end(), less_tid);
+        buffered[i].erase(std::unique(buffered[i].begin(), buffered[i].end(), equal_tid), buffered[i].end());
+        results[i].assign(buffered[i].begin(), buffered[i].end());
+    }
+}
+
+/**
+ * Bestimmt fuer die sortierten Suchschluessel keys[probes[i]] die Blaetter leaves[i] ueber den
+ * Spiegel der inneren Knoten, ohne Seiten zu fixen. Bis zu interleavedProbes Abstiege laufen
+ * verschraenkt: jeder Abstieg ist ein Zustand (probe_state), der nach jedem Knoten den
+ * naechsten Knoten vorab in den Cache laedt und die Ausfuehrung an den naechsten Abstieg
+ * abgibt; so ueberlappen sich die Cache-Fehlzugriffe der Abstiege.
+ * Rueckgabe false, wenn es keinen Spiegel gibt (Wurzel ist Blatt) oder er nicht mehr passt.
+ */
+bool DBMyIndex::locate_leaves(const vector<const DBAttrType *> &keys, const vector<uint> &probes,
+                              vector<BlockNo> &leaves) {
+    op_cursor &cur = cursor();
+    unsigned long version = structureVersion->load();
+    if (version != cur.mirrorVersion) {
+        clear_mirror(cur);
+        cur.mirrorVersion = version;
+    }
+    mirror_node *root = swizzle(rootTID.page);
+    if (root == NULL)
+        return false;
+
+    leaves.assign(probes.size(), noBlockNo);
+    //je Zustand ein zusammenhaengender Abschnitt der sortierten Suchen: die Abstiege liegen
+    //weit auseinander, innerhalb eines Abschnitts teilen sich Nachbarn ihr Blatt
+    vector<probe_state> active;
+    uint chunk = (probes.size() + interleavedProbes - 1) / interleavedProbes;
+    for (uint begin = 0; begin < probes.size(); begin += chunk) {
+        probe_state state = {begin, min(begin + chunk, (uint) probes.size()), root};
+        active.push_back(state);
+    }
+    uint i = 0;
+    while (active.empty() == false) {
+        probe_state &state = active[i];
+        mirror_node *node = state.node;
+        int pos = mirror_child(node, *keys[probes[state.probe]]);
+        if (node->leaf_children) {
+            //Abstieg fertig; folgende Schluessel unter dem Separator rechts des Blattes
+            //liegen im selben Blatt, danach beginnt der naechste Abstieg an der Wurzel
+            leaves[state.probe++] = node->blocks[pos];
+            while (pos < (int) node->keys.size() && state.probe < state.end
+                   && keys[probes[state.probe]]->operator<(*node->keys[pos]))
+                leaves[state.probe++] = node->blocks[pos];
+            state.node = root;
+            if (state.probe == state.end) {
+                active.erase(active.begin() + i);
+                if (active.empty())
+                    break;
+                i %= active.size();
+                continue;
+            }
+        } else {
+            if (node->children[pos] == NULL || node->children[pos]->stale)
+                node->children[pos] = swizzle(node->blocks[pos]);
+            if (node->children[pos] == NULL)
+                return false;
+            state.node = node->children[pos];
+            prefetch_node(state.node);
+        }
+        i = (i + 1) % active.size();
+    }
+    return true;
+}
+
+/**
+ * Sucht die Schluessel keys[probes[i]] in den von locate_leaves() bestimmten Blaettern,
+ * jedes Blatt wird einmal geteilt gefixt. Hat sich die Struktur seitdem geaendert, wird
+ * abgebrochen. Rueckgabe: Anzahl der erledigten Suchen (von vorn).
+ */
+uint DBMyIndex::search_leaves(const vector<const DBAttrType *> &keys, const vector<uint> &probes,
+                              const vector<BlockNo> &leaves, vector<DBListTID> &results) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    uint done = 0;
+    while (done < probes.size()) {
+        BlockNo leaf = leaves[done];
+        bacbStack.push(bufMgr.fixBlock(file, leaf, LOCK_SHARED));
+        node_header head;
+        read_head(bacbStack.top().getDataPtr(), head);
+        if (head.isleaf == false || structureVersion->load() != cursor().mirrorVersion) {
+            unfix_path();
+            break;
+        }
+        for (; done < probes.size() && leaves[done] == leaf; ++done)
+            search_in_node(*keys[probes[done]], results[probes[done]]);
+        unfix_path();
+    }
+    return done;
+}
+
+/**
+ * Beantwortet eine Suche allein aus dem Index, ohne die Tabelle zu lesen: liefert fuer den
+ * zusammengesetzten Schluessel val die TID und haengt die mitgespeicherten Attribute an
+ * included an (muessen vom Aufrufer geloescht werden).
+ * Rueckgabe false, wenn val nicht im Index ist.
+ */
+bool DBMyIndex::findCovered(const DBAttrType &val, TID &tid, vector<DBAttrType *> &included) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "findCovered()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    if (isComposite() == false || unique == false)
+        throw DBIndexException("covered lookup requires a unique composite index");
+    // zuerst der Einfuegepuffer: der gepufferte Schluessel enthaelt auch die mitgespeicherten Attribute
+    vector<char> raw;
+    if (insertBuffer->capacity > 0) {
+        lock_guard<mutex> guard(insertBuffer->lock);
+        const multimap<DBAttrType *, TID, less_key> *maps[2] = {&insertBuffer->entries, &insertBuffer->flushing};
+        for (uint i = 0; i < 2 && raw.empty(); ++i) {
+            multimap<DBAttrType *, TID, less_key>::const_iterator it = maps[i]->find(const_cast<DBAttrType *>(&val));
+            if (it != maps[i]->end()) {
+                raw.assign(keySize(), 0);
+                it->first->write(&raw[0]);
+                tid = it->second;
+            }
+        }
+    }
+    if (raw.empty() == false) {
+        const char *ptr = &raw[0] + DBMyCompositeKey::getSize(keyTypes);
+        for (uint i = 0; i < includeTypes.size(); ++i) {
+            included.push_back(DBAttrType::read(ptr, includeTypes[i]));
+            ptr += DBAttrType::getSize4Type(includeTypes[i]);
+        }
+        return true;
+    }
+    if (may_contain(val) == false)
+        return false;
+
+    bool found = false;
+    stack<int> path;
+    try {
+        descend_to_leaf(val, LATCH_READ, path, NULL);
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        int pos = lower_pos(ptr, head, val);
+        if (pos < head.fill_level) {
+            DBAttrType *key = key_at(ptr, pos);
+            found = key->operator==(val);
+            delete key;
+        }
+        if (found) {
+            tid = tid_at(ptr, pos);
+            //mitgespeicherte Attribute folgen im Eintrag auf die Schluesselattribute
+            const char *raw = key_ptr(ptr, pos) + DBMyCompositeKey::getSize(keyTypes);
+            for (uint i = 0; i < includeTypes.size(); ++i) {
+                included.push_back(DBAttrType::read(raw, includeTypes[i]));
+                raw += DBAttrType::getSize4Type(includeTypes[i]);
+            }
+        }
+    } catch (DBException &e) {
+        unfix_path();
+        throw;
+    }
+    unfix_path();
+    return found;
+}
+
+/**
+ * Einfuegen eines Schluesselwertes (moeglicherweise bereits vorhangen)
+ * zusammen mit einer Referenz auf eine TID.
+ */
+void DBMyIndex::insert(const DBAttrType &val, const TID &tid) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "insert()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    LOG4CXX_DEBUG(logger, "tid: " + tid.toString());
+
+    // vor Beginn der Operation darf keine Seite gelockt sein,
+    // exklusiv gesperrt werden nur die Knoten, die sich aendern
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    DBMyLatency::Timer timer(latencyInsert);
+    vector<const DBAttrType *> keys(1, &val);
+    buffer_access access(*insertBuffer);
+    if (access.buffered) {
+        try {
+            buffer_insert(val, tid, access.guard);
+        } catch (DBException &e) {
+            cache_invalidate(keys);
+            throw;
+        }
+        cache_invalidate(keys);
+        // Commit ohne den Puffer, so teilen sich gleichzeitige Operationen ein fsync
+        access.release();
+        log_commit();
+        return;
+    }
+
+    filter_add(keys, true);
+    stack<int> path;
+    try {
+        if (fix_right_leaf(val) == false) {
+            descend_to_leaf(val, LATCH_INSERT, path, NULL);
+            track_right_leaf();
+        }
+        insert_into_leaf(val, tid, path);
+    } catch (DBException &e) {
+        unfix_path();
+        filter_done();
+        cache_invalidate(keys);
+        throw;
+    }
+    unfix_path();
+    filter_done();
+    access.release();
+    cache_invalidate(keys);
+    log_commit();
+}
+
+/**
+ * Einfuegen vieler (Schluessel, TID)-Paare in einem Durchgang.
+ * Die Eintraege werden nach Schluessel sortiert. Aufeinanderfolgende Schluessel
+ * werden in das weiterhin gefixte Blatt geschrieben, solange sie kleiner als
+ * dessen obere Schranke (Separator im Elternknoten) sind und das Blatt nicht
+ * gespalten werden muss. Erst dann wird erneut von der Wurzel abgestiegen.
+ */
+void DBMyIndex::insertBatch(vector<pair<DBAttrType *, TID> > &entries) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "insertBatch()");
+    LOG4CXX_DEBUG(logger, "entries: " + TO_STR(entries.size()));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    vector<const DBAttrType *> keys;
+    for (uint i = 0; i < entries.size(); ++i)
+        keys.push_back(entries[i].first);
+    //gepufferte Eintraege zuerst, damit Duplikate wie ohne Puffer erkannt werden; der Abstieg
+    //laeuft ohne den Puffer, Einfuegungen der Schluessel in den Puffer warten bis zum Ende
+    buffer_access access(*insertBuffer);
+    if (access.buffered) {
+        flush_buffer(access.guard);
+        access.mark_busy(keys);
+        access.guard.unlock();
+    }
+    filter_add(keys, true);
+    try {
+        insert_sorted(entries);
+    } catch (DBException &e) {
+        filter_done();
+        cache_invalidate(keys);
+        throw;
+    }
+    filter_done();
+    access.release();
+    cache_invalidate(keys);
+    log_commit();
+}
+
+/**
+ * Schreibt entries (nach Schluessel sortiert) in die Blaetter, siehe insertBatch()
+ */
+void DBMyIndex::insert_sorted(vector<pair<DBAttrType *, TID> > &entries) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    sort(entries.begin(), entries.end(), less_entry);
+
+    stack<int> path;
+    DBAttrType *upper = NULL;
+    bool inLeaf = false;
+    try {
+        for (uint i = 0; i < entries.size(); ++i) {
+            const DBAttrType &val = *entries[i].first;
+            // Schluessel gehoert nicht mehr in das gefixte Blatt oder das Blatt muesste
+            // gespalten werden, ohne dass die Elternknoten exklusiv gesperrt sind
+            if (inLeaf && ((upper != NULL && val.operator<(*upper) == false)
+                           || (bacbStack.size() == 1 && is_safe(LATCH_INSERT) == false))) {
+                unfix_path();
+                inLeaf = false;
+            }
+            if (inLeaf == false) {
+                // kein Knoten gefixt: Bilder der bisherigen Blaetter in den Log, der Cursor
+                // haelt so nur die Seiten eines Abstiegs
+                log_append(*redoLog, cursor());
+                if (upper != NULL)
+                    delete upper;
+                upper = NULL;
+                path = stack<int>();
+                if (fix_right_leaf(val) == false) {
+                    descend_to_leaf(val, LATCH_INSERT, path, &upper);
+                    track_right_leaf();
+                }
+            }
+            // nach einem Split ist kein Knoten mehr gefixt
+            inLeaf = insert_into_leaf(val, entries[i].second, path);
+        }
+    } catch (DBException &e) {
+        if (upper != NULL)
+            delete upper;
+        unfix_path();
+        throw;
+    }
+    if (upper != NULL)
+        delete upper;
+    unfix_path();
+}
+
+/**
+ * Entfernt alle Tupel aus der Liste der tids.
+ * Um schneller auf der richtigen Seite mit dem Entfernen anfangen zu koennen,
+ * wird zum Suchen auch noch der zu loeschende value uebergeben
+ */
+void DBMyIndex::remove(const DBAttrType &val, const list<TID> &tid) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "remove()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+
+    // vor Beginn der Operation darf keine Seite gelockt sein
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    // wenn das Indexattribut unique ist, dann darf in der Liste TID nie mehr als ein Wert stehen
+    if (unique == true && tid.size() > 1)
+        throw DBIndexUniqueKeyException("try to remove multiple key but is unique index");
+
+    DBMyLatency::Timer timer(latencyRemove);
+    // gepufferte Eintraege direkt im Puffer loeschen, dann den Puffer freigeben; bis auch der
+    // Baum geaendert ist, wartet eine Einfuegung von val in den Puffer (siehe buffer_insert())
+    vector<const DBAttrType *> keys(1, &val);
+    DBListTID rest;
+    buffer_access access(*insertBuffer);
+    if (access.buffered) {
+        // eine Leerung oder ein Stapel mit val muss erst im Baum stehen
+        while (insertBuffer->busy.count(&val) > 0)
+            insertBuffer->changed.wait(access.guard);
+        pair<multimap<DBAttrType *, TID, less_key>::iterator, multimap<DBAttrType *, TID, less_key>::iterator> range =
+                insertBuffer->entries.equal_range(const_cast<DBAttrType *>(&val));
+        for (DBListTID::const_iterator t = tid.begin(); t != tid.end(); ++t) {
+            multimap<DBAttrType *, TID, less_key>::iterator it = range.first;
+            while (it != range.second && equal_tid(it->second, *t) == false)
+                ++it;
+            if (it == range.second) {
+                rest.push_back(*t);
+                continue;
+            }
+            if (it == range.first)
+                ++range.first;
+            delete it->first;
+            insertBuffer->entries.erase(it);
+        }
+        if (rest.empty()) {
+            access.release();
+            filter_removed(tid.size());
+            cache_invalidate(keys);
+            log_commit();
+            return;
+        }
+        access.mark_busy(keys);
+        access.guard.unlock();
+    } else {
+        rest.assign(tid.begin(), tid.end());
+    }
+
+    // Blatt suchen, in dem Tupel mit val im IndexAttribute liegen (wenn vorhanden),
+    // Eintraege loeschen und unterbelegte Knoten mit Nachbarn ausgleichen oder verschmelzen
+    // wie eine Einfuegung ohne Puffer waehrend eines Neuaufbaus des Filters aufgehalten
+    filter_add(vector<const DBAttrType *>(), true);
+    // im Puffer geloeschte TIDs und die im Baum gefundenen
+    uint removed = tid.size() - rest.size();
+    stack<int> path;
+    try {
+        descend_to_leaf(val, LATCH_REMOVE, path, NULL);
+        uint leaf_removed = remove_from_leaf(val, rest);
+        if (leaf_removed > 0) {
+            add_counts(path, -(int) leaf_removed);
+            rebalance(path);
+        }
+        removed += leaf_removed;
+    } catch (DBException &e) {
+        unfix_path();
+        filter_done();
+        cache_invalidate(keys);
+        throw;
+    }
+    unfix_path();
+    filter_done();
+    access.release();
+    if (removed > 0)
+        filter_removed(removed);
+    cache_invalidate(keys);
+    log_commit();
+}
+
+
+/**
+ * Baut den (leeren) Index aus einer Tabelle auf, z.B. beim Anlegen eines Indexes ueber
+ * einer bestehenden Tabelle:
+ * - threads Worker lesen die Partitionen von source parallel und sortieren die Paare in
+ *   Laeufen; uebersteigt ein Lauf seinen Anteil an memoryBudget (Bytes), wird er in eine
+ *   temporaere Datei ausgelagert
+ * - die Laeufe werden gemischt und die Blaetter von links nach rechts voll geschrieben,
+ *   darueber die inneren Ebenen, der oberste Knoten wandert in den Block der Wurzel
+ * threads == 0: so viele Threads wie Kerne. Waehrend des Aufbaus darf der Index nicht anderweitig
+ * geaendert werden. Schlaegt der Aufbau fehl, bleibt der Index leer.
+ */
+void DBMyIndex::build(DBMyIndexSource &source, uint threads, size_t memoryBudget) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "build()");
+    LOG4CXX_DEBUG(logger, "threads: " + TO_STR(threads));
+    LOG4CXX_DEBUG(logger, "memoryBudget: " + TO_STR(memoryBudget));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+    if (threads == 0)
+        threads = max(thread::hardware_concurrency(), 1u);
+
+    buffer_access access(*insertBuffer);
+    if (access.buffered)
+        flush_buffer(access.guard);
+    DBBACB root = bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED);
+    node_header root_head;
+    read_head(root.getDataPtr(), root_head);
+    unfix_block(root);
+    if (root_head.isleaf == false || root_head.fill_level > 0)
+        throw DBIndexException("index build requires an empty index");
+
+    //Laeufe parallel erzeugen; laesst sich kein Thread starten, arbeitet der Aufrufer allein
+    vector<build_run *> runs;
+    mutex runsMutex;
+    exception_ptr error;
+    atomic<uint> nextPart(0);
+    vector<thread> workers;
+    for (uint i = 0; i < threads; ++i) {
+        try {
+            workers.push_back(thread(&DBMyIndex::build_worker, this, std::ref(source), std::ref(nextPart),
+                                     memoryBudget / threads, std::ref(runs), std::ref(runsMutex), std::ref(error)));
+        } catch (system_error &e) {
+            LOG4CXX_WARN(logger, "could not start build thread");
+            break;
+        }
+    }
+    if (workers.empty())
+        build_worker(source, nextPart, memoryBudget, runs, runsMutex, error);
+    for (uint i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    LOG4CXX_DEBUG(logger, "runs: " + TO_STR(runs.size()));
+    if (error != NULL) {
+        for (uint i = 0; i < runs.size(); ++i)
+            delete runs[i];
+        rethrow_exception(error);
+    }
+
+    vector<BlockNo> children;
+    vector<char> seps;
+    vector<BlockNo> written;
+    try {
+        build_leaves(runs, children, seps, written);
+        while (children.size() > 1)
+            build_inner(children, seps, written);
+
+        if (children.empty() == false) {
+            //die neuen Knoten stehen nicht im Log, sie muessen vor der Wurzel in der Datei stehen
+            if (redoLog->enabled.load()) {
+                for (uint i = 0; i < written.size(); ++i) {
+                    DBBACB bacb = bufMgr.fixBlock(file, written[i], LOCK_SHARED);
+                    try {
+                        bufMgr.flushBlock(bacb);
+                    } catch (DBException &e) {
+                        bufMgr.unfixBlock(bacb);
+                        throw;
+                    }
+                    bufMgr.unfixBlock(bacb);
+                }
+            }
+            //oberster Knoten wird Wurzel (die Wurzel bleibt immer im selben Block)
+            DBBACB top = bufMgr.fixBlock(file, children[0], LOCK_EXCLUSIVE);
+            root = bufMgr.fixBlock(file, rootTID.page, LOCK_EXCLUSIVE);
+            inner_changed(rootTID.page);
+            memcpy(root.getDataPtr(), top.getDataPtr(), DBFileBlock::getBlockSize());
+            read_head(root.getDataPtr(), root_head);
+            root_head.isroot = true;
+            write_head(root.getDataPtr(), root_head);
+            root.setModified();
+            unfix_block(root);
+            free_node(top);
+        }
+        if (counted->load())
+            recount(rootTID.page);
+    } catch (DBException &e) {
+        for (uint i = 0; i < runs.size(); ++i)
+            delete runs[i];
+        discard_build(written);
+        throw;
+    }
+    for (uint i = 0; i < runs.size(); ++i)
+        delete runs[i];
+    clear_mirror(cursor());
+    cache_clear();
+
+    //Bloom-Filter aus den neuen Blaettern aufbauen
+    uint expectedKeys = 0, numHashes = 0, lines = 0;
+    {
+        lock_guard<mutex> filter_guard(filter->lock);
+        if (filter->bits.empty() == false) {
+            expectedKeys = filter->expectedKeys;
+            numHashes = filter->numHashes;
+            lines = filter->bits.size() / filterLineWords;
+        }
+    }
+    if (expectedKeys > 0)
+        rebuild_filter(expectedKeys, numHashes, lines, access.guard);
+    log_commit();
+}
+
+/**
+ * Worker von build(): liest Partitionen, bis keine mehr uebrig ist, und legt sortierte Laeufe
+ * in runs ab. Ein Fehler wird in error vermerkt und beendet auch die anderen Worker.
+ */
+void DBMyIndex::build_worker(DBMyIndexSource &source, atomic<uint> &nextPart, size_t budget,
+                             vector<build_run *> &runs, mutex &runsMutex, exception_ptr &error) {
+    vector<pair<DBAttrType *, TID> > entries;
+    uint parts = 0;
+    try {
+        size_t entry_bytes = entrySize() + buildEntryOverhead;
+        parts = source.partitionCount();
+        for (uint part = nextPart++; part < parts; part = nextPart++) {
+            DBAttrType *key;
+            TID tid;
+            while (source.next(part, key, tid)) {
+                entries.push_back(make_pair(key, tid));
+                if (entries.size() * entry_bytes >= budget)
+                    spill_run(entries, runs, runsMutex);
+            }
+        }
+        //der letzte Lauf bleibt im Speicher
+        sort(entries.begin(), entries.end(), less_entry);
+        build_run *run = new build_run();
+        run->entries.swap(entries);
+        lock_guard<mutex> guard(runsMutex);
+        runs.push_back(run);
+    } catch (...) {
+        //Ausnahmen duerfen den Thread nicht verlassen
+        for (uint i = 0; i < entries.size(); ++i)
+            delete entries[i].first;
+        nextPart = parts;
+        lock_guard<mutex> guard(runsMutex);
+        if (error == NULL)
+            error = current_exception();
+    }
+}
+
+/**
+ * Sortiert entries und lagert sie als Lauf (Datensaetze Schluessel, TID) in eine temporaere Datei aus
+ */
+void DBMyIndex::spill_run(vector<pair<DBAttrType *, TID> > &entries, vector<build_run *> &runs, mutex &runsMutex) {
+    sort(entries.begin(), entries.end(), less_entry);
+    build_run *run = new build_run();
+    run->file = tmpfile();
+    bool ok = run->file != NULL;
+    vector<char> record(entrySize());
+    for (uint i = 0; i < entries.size(); ++i) {
+        memset(&record[0], 0, keySize());
+        entries[i].first->write(&record[0]);
+        entries[i].second.write(&record[0] + keySize());
+        if (ok && fwrite(&record[0], entrySize(), 1, run->file) != 1)
+            ok = false;
+        delete entries[i].first;
+    }
+    entries.clear();
+    if (ok == false || fflush(run->file) != 0 || fseek(run->file, 0, SEEK_SET) != 0) {
+        delete run;
+        throw DBIndexException("could not write temporary file for index build");
+    }
+    lock_guard<mutex> guard(runsMutex);
+    runs.push_back(run);
+}
+
+/**
+ * Setzt run auf seinen naechsten Eintrag (run.key, run.tid), der vorherige wird geloescht.
+ * Rueckgabe false, wenn der Lauf erschoepft ist.
+ */
+bool DBMyIndex::advance_run(build_run &run) {
+    if (run.file == NULL) {
+        if (run.key != NULL) {
+            delete run.key;
+            run.pos += 1;
+        }
+        run.key = NULL;
+        if (run.pos >= run.entries.size())
+            return false;
+        run.key = run.entries[run.pos].first;
+        run.tid = run.entries[run.pos].second;
+        return true;
+    }
+    if (run.key != NULL)
+        delete run.key;
+    run.key = NULL;
+    vector<char> record(entrySize());
+    if (fread(&record[0], entrySize(), 1, run.file) != 1)
+        return false;
+    run.key = read_key(&record[0]);
+    run.tid.read(&record[0] + keySize());
+    return true;
+}
+
+/**
+ * Mischt die Laeufe und schreibt die Blaetter von links nach rechts so voll wie moeglich.
+ * Gleiche Schluessel werden zu einem Eintrag mit Posting-Liste zusammengefasst.
+ * children erhaelt die Blaetter, seps die Separatoren zwischen ihnen, written alle belegten Bloecke.
+ */
+void DBMyIndex::build_leaves(vector<build_run *> &runs, vector<BlockNo> &children, vector<char> &seps,
+                             vector<BlockNo> &written) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    priority_queue<pair<DBAttrType *, uint>, vector<pair<DBAttrType *, uint> >, greater_run> heap;
+    for (uint i = 0; i < runs.size(); ++i) {
+        if (advance_run(*runs[i]))
+            heap.push(make_pair(runs[i]->key, i));
+    }
+    if (heap.empty())
+        return;
+
+    node_header head;
+    head.isroot = false;
+    head.isleaf = true;
+    head.fill_level = 0;
+    head.next.page = noBlockNo;
+    head.next.slot = 0;
+    vector<char> buffer;
+    vector<char> lists;
+    vector<char> entry(entrySize());
+    vector<TID> tids;
+    int count = 0;
+    try {
+        bacbStack.push(fix_free_block());
+        write_entries(bacbStack.top().getDataPtr(), head, NULL, 0);
+        bacbStack.top().setModified();
+        written.push_back(bacbStack.top().getBlockNo());
+        children.push_back(bacbStack.top().getBlockNo());
+
+        while (heap.empty() == false) {
+            //alle TIDs des kleinsten Schluessels aus allen Laeufen einsammeln
+            uint run = heap.top().second;
+            heap.pop();
+            memset(&entry[0], 0, keySize());
+            runs[run]->key->write(&entry[0]);
+            DBAttrType *key = read_key(&entry[0]);
+            tids.assign(1, runs[run]->tid);
+            if (advance_run(*runs[run]))
+                heap.push(make_pair(runs[run]->key, run));
+            while (heap.empty() == false && heap.top().first->operator==(*key)) {
+                run = heap.top().second;
+                heap.pop();
+                tids.push_back(runs[run]->tid);
+                if (advance_run(*runs[run]))
+                    heap.push(make_pair(runs[run]->key, run));
+            }
+            delete key;
+            if (unique == true && tids.size() > 1)
+                throw DBIndexUniqueKeyException("key already exists in unique index");
+            sort(tids.begin(), tids.end(), less_tid);
+            if (adjacent_find(tids.begin(), tids.end(), equal_tid) != tids.end())
+                throw DBIndexException("tid already exists for key");
+
+            uint mark = lists.size();
+            TID ref = write_postings(tids, lists, false);
+            ref.write(&entry[0] + keySize());
+            buffer.insert(buffer.end(), entry.begin(), entry.end());
+            if (count > 0 && fits(&buffer[0], count + 1, true) == false) {
+                //Blatt ist voll: ohne den neuen Eintrag schreiben und an ein neues Blatt haengen
+                buffer.resize(count * entrySize());
+                lists.resize(mark);
+                DBBACB next = fix_free_block();
+                head.next.page = noBlockNo;
+                write_entries(next.getDataPtr(), head, NULL, 0);
+                next.setModified();
+                written.push_back(next.getBlockNo());
+                children.push_back(next.getBlockNo());
+                head.next.page = next.getBlockNo();
+                if (write_entries(bacbStack.top().getDataPtr(), head, &buffer[0], count, &lists) == false)
+                    throw DBIndexException("leaf overflow while building");
+                bacbStack.top().setModified();
+                bufMgr.unfixBlock(bacbStack.top());
+                bacbStack.pop();
+                bacbStack.push(next);
+
+                vector<char> sep(keySize());
+                shortest_separator(&buffer[(count - 1) * entrySize()], &entry[0], &sep[0]);
+                seps.insert(seps.end(), sep.begin(), sep.end());
+                buffer.clear();
+                lists.clear();
+                count = 0;
+                //die Liste im Blatt muss im neuen Blatt neu angelegt werden
+                if (is_list(ref) && (ref.slot & listFlag) != 0) {
+                    ref = write_postings(tids, lists, false);
+                    ref.write(&entry[0] + keySize());
+                }
+                buffer.insert(buffer.end(), entry.begin(), entry.end());
+            }
+            count += 1;
+        }
+
+        head.next.page = noBlockNo;
+        if (write_entries(bacbStack.top().getDataPtr(), head, &buffer[0], count, &lists) == false)
+            throw DBIndexException("leaf overflow while building");
+        bacbStack.top().setModified();
+    } catch (DBException &e) {
+        //Ueberlaufbloecke des noch nicht geschriebenen Blattes freigeben
+        for (uint i = 0; i < buffer.size() / entrySize(); ++i) {
+            TID ref;
+            ref.read(&buffer[i * entrySize()] + keySize());
+            free_postings(ref);
+        }
+        unfix_path();
+        throw;
+    }
+    unfix_path();
+}
+
+/**
+ * Baut ueber children (getrennt durch seps) eine Ebene innerer Knoten, so voll wie moeglich.
+ * children und seps beschreiben danach die neue Ebene.
+ */
+void DBMyIndex::build_inner(vector<BlockNo> &children, vector<char> &seps, vector<BlockNo> &written) {
+    vector<BlockNo> parents;
+    vector<char> parent_seps;
+    vector<char> buffer;
+    uint m = children.size();
+    uint a = 0;
+    while (a < m) {
+        //Knoten mit den Kindern a .. a + count: Eintraege (seps[a + i], children[a + i]), next = children[a + count]
+        int count = 0;
+        buffer.clear();
+        while (a + count + 1 < m) {
+            buffer.resize((count + 1) * entrySize());
+            char *entry = &buffer[count * entrySize()];
+            memcpy(entry, &seps[(a + count) * keySize()], keySize());
+            TID child;
+            child.page = children[a + count];
+            child.slot = 0;
+            child.write(entry + keySize());
+            if (count > 0 && fits(&buffer[0], count + 1, false) == false)
+                break;
+            count += 1;
+        }
+        //das letzte Kind soll nicht allein in einem Knoten landen
+        if (a + count + 2 == m && count > 1)
+            count -= 1;
+
+        node_header head;
+        head.isroot = false;
+        head.isleaf = false;
+        head.fill_level = 0;
+        head.next.page = children[a + count];
+        head.next.slot = 0;
+        DBBACB bacb = fix_free_block();
+        written.push_back(bacb.getBlockNo());
+        bool complete = write_entries(bacb.getDataPtr(), head, buffer.empty() ? NULL : &buffer[0], count);
+        bacb.setModified();
+        bufMgr.unfixBlock(bacb);
+        if (complete == false)
+            throw DBIndexException("node overflow while building");
+        parents.push_back(bacb.getBlockNo());
+        if (a + count + 1 < m)
+            parent_seps.insert(parent_seps.end(), seps.begin() + (a + count) * keySize(),
+                               seps.begin() + (a + count + 1) * keySize());
+        a += count + 1;
+    }
+    children.swap(parents);
+    seps.swap(parent_seps);
+}
+
+/**
+ * Gibt nach einem fehlgeschlagenen Aufbau alle dabei belegten Bloecke wieder frei
+ */
+void DBMyIndex::discard_build(const vector<BlockNo> &written) {
+    try {
+        for (uint i = 0; i < written.size(); ++i) {
+            DBBACB bacb = bufMgr.fixBlock(file, written[i], LOCK_EXCLUSIVE);
+            char *ptr = bacb.getDataPtr();
+            node_header head;
+            read_head(ptr, head);
+            for (int pos = 0; head.isleaf && pos < head.fill_level; ++pos)
+                free_postings(tid_at(ptr, pos));
+            free_node(bacb);
+        }
+    } catch (DBException &e) {
+        LOG4CXX_ERROR(logger, "could not free blocks of failed index build");
+    }
+}
+
+/**
+ * Schaltet den Einfuegepuffer der Indexdatei ein (capacity > 0) oder aus (0).
+ * Bis zu capacity Einfuegungen werden im Speicher gesammelt und dann gemeinsam in die
+ * Blaetter geschrieben; so wird ein Blatt pro Stapel nur einmal geaendert statt pro Zeile.
+ * Die Duplikatpruefung liest weiterhin den Baum. Der Puffer gilt fuer alle Instanzen
+ * dieser Datei und wird beim Zerstoeren jeder Instanz geleert. Gepufferte Einfuegungen stehen in
+ * keinem Redo-Log, mit eingeschaltetem Log (setWriteAheadLog()) wird der Puffer deshalb
+ * abgelehnt.
+ */
+void DBMyIndex::setInsertBuffer(uint capacity) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "setInsertBuffer()");
+    LOG4CXX_DEBUG(logger, "capacity: " + TO_STR(capacity));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+    if (capacity > 0 && redoLog->enabled.load())
+        throw DBIndexException("insert buffer requires the write-ahead log to be off");
+
+    unique_lock<mutex> guard(insertBuffer->lock);
+    // ausgeschaltet muss der Puffer leer sein, auch ohne laufende Leerung
+    while (true) {
+        while (insertBuffer->flushing.empty() == false)
+            insertBuffer->changed.wait(guard);
+        if (insertBuffer->entries.empty() || insertBuffer->entries.size() < capacity)
+            break;
+        flush_buffer(guard);
+    }
+    // erst einschalten, dann die Operationen abwarten, die den Puffer noch umgehen (z.B. build());
+    // die letzte weckt uns in buffer_access::release()
+    insertBuffer->capacity = capacity;
+    while (capacity > 0 && insertBuffer->bypass > 0)
+        insertBuffer->changed.wait(guard);
+    guard.unlock();
+    log_commit();
+}
+
+/**
+ * Schreibt alle gepufferten Einfuegungen in den Baum
+ */
+void DBMyIndex::flushInsertBuffer() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "flushInsertBuffer()");
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    unique_lock<mutex> guard(insertBuffer->lock);
+    flush_buffer(guard);
+    guard.unlock();
+    log_commit();
+}
+
+/**
+ * Legt (val, tid) im Einfuegepuffer ab, nachdem Puffer und Baum auf Duplikate geprueft wurden.
+ * guard haelt insertBuffer->lock. Der Baum wird ohne den lock durchsucht; hat sich dabei der
+ * Inhalt des Puffers im Baum geaendert (changes) oder wird val gerade geaendert (busy), erneut.
+ * Erreicht der Puffer die Kapazitaet, leert ihn dieser Aufruf, wenn nicht schon eine Leerung laeuft.
+ */
+void DBMyIndex::buffer_insert(const DBAttrType &val, const TID &tid, unique_lock<mutex> &guard) {
+    DBListTID existing;
+    while (true) {
+        while (insertBuffer->busy.count(&val) > 0)
+            insertBuffer->changed.wait(guard);
+        unsigned long changes = insertBuffer->changes;
+        guard.unlock();
+        existing.clear();
+        try {
+            find_in_tree(val, existing);
+        } catch (DBException &e) {
+            guard.lock();
+            throw;
+        }
+        guard.lock();
+        if (insertBuffer->changes == changes && insertBuffer->busy.count(&val) == 0)
+            break;
+    }
+    vector<TID> buffered;
+    buffer_lookup(val, buffered);
+    existing.insert(existing.end(), buffered.begin(), buffered.end());
+    if (unique == true && existing.empty() == false)
+        throw DBIndexUniqueKeyException("key already exists in unique index");
+    for (DBListTID::iterator it = existing.begin(); it != existing.end(); ++it) {
+        if (equal_tid(*it, tid))
+            throw DBIndexException("tid already exists for key");
+    }
+
+    filter_add(vector<const DBAttrType *>(1, &val), false);
+    vector<char> raw(keySize(), 0);
+    val.write(&raw[0]);
+    insertBuffer->entries.insert(make_pair(read_key(&raw[0]), tid));
+    while (insertBuffer->entries.size() >= insertBuffer->capacity && insertBuffer->flushing.empty())
+        flush_buffer(guard);
+}
+
+/**
+ * Haengt die gepufferten TIDs zu val an tids an, auch die einer laufenden Leerung.
+ * Der Aufrufer haelt insertBuffer->lock.
+ */
+void DBMyIndex::buffer_lookup(const DBAttrType &val, vector<TID> &tids) const {
+    const multimap<DBAttrType *, TID, less_key> *maps[2] = {&insertBuffer->entries, &insertBuffer->flushing};
+    for (uint i = 0; i < 2; ++i) {
+        pair<multimap<DBAttrType *, TID, less_key>::const_iterator, multimap<DBAttrType *, TID, less_key>::const_iterator> range =
+                maps[i]->equal_range(const_cast<DBAttrType *>(&val));
+        for (multimap<DBAttrType *, TID, less_key>::const_iterator it = range.first; it != range.second; ++it)
+            tids.push_back(it->second);
+    }
+}
+
+/**
+ * Kopiert die gepufferten Eintraege nach Schluessel und TID sortiert nach snapshot (die Schluessel
+ * muss der Aufrufer loeschen), eine laufende Leerung wird vorher abgewartet. Rueckgabe:
+ * insert_buffer::changes dazu; ist es danach unveraendert (buffer_unchanged()), ist keiner der
+ * Eintraege inzwischen in den Baum gewandert.
+ */
+unsigned long DBMyIndex::buffer_snapshot(vector<pair<DBAttrType *, TID> > &snapshot) {
+    unique_lock<mutex> guard(insertBuffer->lock);
+    while (insertBuffer->flushing.empty() == false)
+        insertBuffer->changed.wait(guard);
+    vector<char> raw(keySize());
+    multimap<DBAttrType *, TID, less_key> &entries = insertBuffer->entries;
+    for (multimap<DBAttrType *, TID, less_key>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        memset(&raw[0], 0, keySize());
+        it->first->write(&raw[0]);
+        snapshot.push_back(make_pair(read_key(&raw[0]), it->second));
+    }
+    sort(snapshot.begin(), snapshot.end(), less_buffered);
+    return insertBuffer->changes;
+}
+
+bool DBMyIndex::buffer_unchanged(unsigned long changes) {
+    lock_guard<mutex> guard(insertBuffer->lock);
+    return insertBuffer->changes == changes;
+}
+
+/**
+ * Schreibt den Einfuegepuffer sortiert in die Blaetter und leert ihn. Eine laufende Leerung
+ * wird vorher abgewartet. Die Eintraege wandern nach flushing, ihre Schluessel stehen bis zum
+ * Ende in busy; in den Baum geschrieben wird ohne insertBuffer->lock, so laufen Suchen und
+ * Einfuegungen in den Puffer weiter. Schlaegt das fehl, kehren die Eintraege in den Puffer zurueck.
+ * guard haelt den lock vorher und danach; ist der Puffer ausgeschaltet (leer), wird er nicht benutzt.
+ */
+void DBMyIndex::flush_buffer(unique_lock<mutex> &guard) {
+    multimap<DBAttrType *, TID, less_key> &entries = insertBuffer->entries;
+    multimap<DBAttrType *, TID, less_key> &flushing = insertBuffer->flushing;
+    while (flushing.empty() == false)
+        insertBuffer->changed.wait(guard);
+    if (entries.empty())
+        return;
+    LOG4CXX_DEBUG(logger, "flush insert buffer: " + TO_STR(entries.size()));
+
+    flushing.swap(entries);
+    vector<pair<DBAttrType *, TID> > batch(flushing.begin(), flushing.end());
+    for (uint i = 0; i < batch.size(); ++i)
+        insertBuffer->busy.insert(batch[i].first);
+    insertBuffer->changes += 1;
+    guard.unlock();
+
+    exception_ptr error;
+    filter_add(vector<const DBAttrType *>(), true);
+    try {
+        insert_sorted(batch);
+    } catch (DBException &e) {
+        error = current_exception();
+    }
+    filter_done();
+
+    guard.lock();
+    for (multimap<DBAttrType *, TID, less_key>::iterator it = flushing.begin(); it != flushing.end(); ++it) {
+        insertBuffer->busy.erase(insertBuffer->busy.find(it->first));
+        if (error == NULL)
+            delete it->first;
+        else
+            entries.insert(*it);
+    }
+    flushing.clear();
+    insertBuffer->changes += 1;
+    insertBuffer->changed.notify_all();
+    if (error != NULL)
+        rethrow_exception(error);
+}
+
+/**
+ * Nimmt den lock des eingeschalteten Puffers, sonst wird die Operation in bypass gezaehlt.
+ * bypass wird vor capacity gelesen erhoeht, so wartet setInsertBuffer() jede Operation ab,
+ * die den Puffer noch als ausgeschaltet gesehen hat.
+ */
+DBMyIndex::buffer_access::buffer_access(insert_buffer &buffer)
+        : buffer(buffer), buffered(false), released(false) {
+    while (true) {
+        buffer.bypass += 1;
+        if (buffer.capacity == 0)
+            return;
+        buffer.bypass -= 1;
+        guard = unique_lock<mutex>(buffer.lock);
+        if (buffer.capacity > 0) {
+            buffered = true;
+            return;
+        }
+        guard.unlock();
+    }
+}
+
+/**
+ * Traegt keys in busy ein, bis release(). Der Aufrufer haelt guard.
+ */
+void DBMyIndex::buffer_access::mark_busy(const vector<const DBAttrType *> &keys) {
+    buffer.busy.insert(keys.begin(), keys.end());
+    busy.insert(busy.end(), keys.begin(), keys.end());
+}
+
+void DBMyIndex::buffer_access::release() {
+    if (released)
+        return;
+    released = true;
+    if (buffered == false) {
+        //capacity > 0: setInsertBuffer() wartet ggf. auf die letzte umgehende Operation; unter
+        //dem lock benachrichtigt, damit das Wecken nicht zwischen Pruefen und Warten faellt
+        if (--buffer.bypass == 0 && buffer.capacity > 0) {
+            lock_guard<mutex> wake(buffer.lock);
+            buffer.changed.notify_all();
+        }
+        return;
+    }
+    if (busy.empty() == false) {
+        if (guard.owns_lock() == false)
+            guard.lock();
+        for (uint i = 0; i < busy.size(); ++i)
+            buffer.busy.erase(buffer.busy.find(busy[i]));
+        buffer.changes += 1;
+        buffer.changed.notify_all();
+    }
+    if (guard.owns_lock())
+        guard.unlock();
+}
+
+/**
+ * Legt fuer die Indexdatei einen Bloom-Filter fuer etwa expectedKeys Schluessel mit der
+ * Falsch-Positiv-Rate falsePositiveRate an und baut ihn aus den Blaettern auf.
+ * Suchen nach Schluesseln, die der Filter ausschliesst, lesen keine Seite.
+ * expectedKeys == 0 entfernt den Filter. Der Filter gilt fuer alle Instanzen dieser Datei
+ * und wird in der Indexdatei gespeichert.
+ */
+void DBMyIndex::setFilter(uint expectedKeys, double falsePositiveRate) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "setFilter()");
+    LOG4CXX_DEBUG(logger, "expectedKeys: " + TO_STR(expectedKeys));
+    LOG4CXX_DEBUG(logger, "falsePositiveRate: " + TO_STR(falsePositiveRate));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    uint numHashes = 0;
+    uint lines = 0;
+    if (expectedKeys > 0) {
+        if (falsePositiveRate <= 0 || falsePositiveRate >= 1)
+            throw DBIndexException("false positive rate must be between 0 and 1");
+        // m = -n ln(p) / ln(2)^2, k = m / n ln(2)
+        double bits = -(double) expectedKeys * log(falsePositiveRate) / (log(2.0) * log(2.0));
+        if (bits / 8 > (double) maxFilterBlocks() * DBFileBlock::getBlockSize())
+            throw DBIndexException("filter does not fit into the index file");
+        lines = max((uint) ceil(bits / filterLineBits), 1u);
+        numHashes = min(max((uint) lround(bits / expectedKeys * log(2.0)), 1u), maxFilterHashes);
+    }
+
+    {
+        buffer_access access(*insertBuffer);
+        if (expectedKeys > 0) {
+            rebuild_filter(expectedKeys, numHashes, lines, access.guard);
+        } else {
+            lock_guard<mutex> filter_guard(filter->lock);
+            filter->bits.clear();
+            filter->numHashes = 0;
+            filter->expectedKeys = 0;
+            filter->removed = 0;
+            persist_filter();
+        }
+    }
+    log_commit();
+}
+
+/**
+ * Schreibt val nach raw, -0.0 wird dabei zu 0.0.
+ * Rueckgabe: Laenge der Schluesselattribute am Anfang von raw (ohne mitgespeicherte Attribute)
+ */
+uint DBMyIndex::normalize_key(const DBAttrType &val, vector<char> &raw) const {
+    raw.assign(keySize(), 0);
+    val.write(&raw[0]);
+    vector<AttrTypeEnum> types = isComposite() ? keyTypes : vector<AttrTypeEnum>(1, attrType);
+    uint offset = 0;
+    for (uint i = 0; i < types.size(); ++i) {
+        if (types[i] == DOUBLE) {
+            double d;
+            memcpy(&d, &raw[offset], sizeof(double));
+            if (d == 0) {
+                d = 0;
+                memcpy(&raw[offset], &d, sizeof(double));
+            }
+        }
+        offset += DBAttrType::getSize4Type(types[i]);
+    }
+    return offset;
+}
+
+/**
+ * Hashwert der Schluesselattribute von val (siehe normalize_key()): FNV-1a ueber die Bytes,
+ * danach durchmischt
+ */
+uint64_t DBMyIndex::filter_hash(const DBAttrType &val) const {
+    vector<char> raw;
+    uint size = normalize_key(val, raw);
+    uint64_t h = 14695981039346656037ULL;
+    for (uint j = 0; j < size; ++j) {
+        h ^= (unsigned char) raw[j];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * false, wenn val sicher nicht im Index ist; ohne Filter immer true
+ */
+bool DBMyIndex::may_contain(const DBAttrType &val) {
+    lock_guard<mutex> guard(filter->lock);
+    if (filter->bits.empty())
+        return true;
+    return test_filter_bits(filter->bits, filter->numHashes, filter_hash(val));
+}
+
+/**
+ * Setzt die Bits der Schluessel keys. writer: Aenderung des Baums ohne insertBuffer->lock, die bis
+ * filter_done() laeuft und waehrend eines Neuaufbaus warten muss (sonst haelt der Aufrufer
+ * insertBuffer->lock).
+ */
+void DBMyIndex::filter_add(const vector<const DBAttrType *> &keys, bool writer) {
+    unique_lock<mutex> guard(filter->lock);
+    while (writer && filter->rebuilding)
+        filter->changed.wait(guard);
+    if (filter->bits.empty() == false) {
+        bool changed = false;
+        for (uint i = 0; i < keys.size(); ++i) {
+            if (set_filter_bits(filter->bits, filter->numHashes, filter_hash(*keys[i])))
+                changed = true;
+        }
+        if (changed && filter->dirty == false)
+            mark_filter_dirty();
+    }
+    if (writer)
+        filter->writers += 1;
+}
+
+/**
+ * Beendet eine mit filter_add(keys, true) begonnene Aenderung
+ */
+void DBMyIndex::filter_done() {
+    lock_guard<mutex> guard(filter->lock);
+    filter->writers -= 1;
+    if (filter->writers == 0)
+        filter->changed.notify_all();
+}
+
+/**
+ * Zaehlt count geloeschte Eintraege; ihre Bits bleiben gesetzt, daher wird der Filter nach
+ * expectedKeys / 2 Loeschungen neu aufgebaut. Der Aufrufer haelt insertBuffer->lock nicht.
+ */
+void DBMyIndex::filter_removed(uint count) {
+    uint expectedKeys, numHashes, lines;
+    {
+        lock_guard<mutex> guard(filter->lock);
+        if (filter->bits.empty())
+            return;
+        filter->removed += count;
+        if (filter->removed <= filter->expectedKeys / 2)
+            return;
+        expectedKeys = filter->expectedKeys;
+        numHashes = filter->numHashes;
+        lines = filter->bits.size() / filterLineWords;
+    }
+    try {
+        buffer_access access(*insertBuffer);
+        rebuild_filter(expectedKeys, numHashes, lines, access.guard);
+    } catch (DBException &e) {
+        // der bisherige Filter bleibt gueltig
+        LOG4CXX_ERROR(logger, "rebuild of filter failed");
+    }
+}
+
+/**
+ * Vermerkt im Metablock, dass der gespeicherte Filter nicht mehr aktuell ist.
+ * Der Aufrufer haelt filter->lock.
+ */
+void DBMyIndex::mark_filter_dirty() {
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE);
+    uint state = filterDirty;
+    memcpy(meta.getDataPtr() + filterOffset, &state, sizeof(uint));
+    meta.setModified();
+    unfix_block(meta);
+    filter->dirty = true;
+}
+
+/**
+ * Laedt beim ersten Oeffnen der Datei im Prozess den gespeicherten Filter,
+ * ein nicht aktuell gespeicherter Filter wird aus den Blaettern neu aufgebaut.
+ * created: die Datei wurde eben angelegt, ein Filter einer frueheren Datei gleichen Namens gilt nicht mehr
+ */
+void DBMyIndex::load_filter(bool created) {
+    buffer_access access(*insertBuffer);
+    unique_lock<mutex> guard(filter->lock);
+    if (created) {
+        filter->bits.clear();
+        filter->blocks.clear();
+        filter->dirty = false;
+        filter->removed = 0;
+        filter->loaded = false;
+    }
+    if (filter->loaded)
+        return;
+
+    uint desc[5];
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_SHARED);
+    memcpy(desc, meta.getDataPtr() + filterOffset, filterDescSize);
+    uint state = desc[0], numHashes = desc[1], expectedKeys = desc[2], lines = desc[3], count = desc[4];
+    vector<BlockNo> blocks;
+    if (state != filterNone && count <= maxFilterBlocks()) {
+        blocks.resize(count);
+        memcpy(&blocks[0], meta.getDataPtr() + filterOffset + filterDescSize, count * sizeof(BlockNo));
+    }
+    unfix_block(meta);
+    if (state == filterNone) {
+        filter->loaded = true;
+        return;
+    }
+    if (state > filterDirty || count > maxFilterBlocks() || lines == 0 || numHashes == 0
+        || numHashes > maxFilterHashes || count * DBFileBlock::getBlockSize() < lines * filterLineBits / 8)
+        throw DBIndexException("invalid filter description in index file");
+
+    filter->blocks = blocks;
+    if (state == filterDirty) {
+        LOG4CXX_WARN(logger, "filter was not persisted, rebuilding it");
+        filter->dirty = true;
+        filter->loaded = true;
+        guard.unlock();
+        rebuild_filter(expectedKeys, numHashes, lines, access.guard);
+        return;
+    }
+
+    vector<uint64_t> bits(lines * filterLineWords);
+    uint bytes = bits.size() * sizeof(uint64_t);
+    for (uint i = 0; i < count && i * DBFileBlock::getBlockSize() < bytes; ++i) {
+        DBBACB bacb = bufMgr.fixBlock(file, blocks[i], LOCK_SHARED);
+        uint offset = i * DBFileBlock::getBlockSize();
+        memcpy((char *) &bits[0] + offset, bacb.getDataPtr(), min(bytes - offset, DBFileBlock::getBlockSize()));
+        unfix_block(bacb);
+    }
+    filter->bits.swap(bits);
+    filter->numHashes = numHashes;
+    filter->expectedKeys = expectedKeys;
+    filter->loaded = true;
+}
+
+/**
+ * Baut den Filter mit lines Zeilen aus den Schluesseln aller Blaetter neu auf und speichert ihn.
+ * Der Aufrufer haelt den Puffer mit buffer_access (bufferGuard), der Puffer wird zuerst geleert;
+ * laufende Aenderungen ohne insertBuffer->lock werden abgewartet und neue bis zum Ende aufgehalten.
+ * Suchen verwenden bis dahin den bisherigen Filter.
+ */
+void DBMyIndex::rebuild_filter(uint expectedKeys, uint numHashes, uint lines, unique_lock<mutex> &bufferGuard) {
+    LOG4CXX_DEBUG(logger, "rebuild filter: " + TO_STR(lines) + " lines, " + TO_STR(numHashes) + " hashes");
+    flush_buffer(bufferGuard);
+    {
+        unique_lock<mutex> guard(filter->lock);
+        filter->rebuilding = true;
+        while (filter->writers > 0)
+            filter->changed.wait(guard);
+    }
+
+    vector<uint64_t> bits(lines * filterLineWords, 0);
+    try {
+        // zum linken Blatt absteigen, dann der Blattkette folgen
+        BlockNo block = rootTID.page;
+        bool leaf = false;
+        while (block != noBlockNo) {
+            DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_SHARED);
+            try {
+                char *ptr = bacb.getDataPtr();
+                node_header head;
+                read_head(ptr, head);
+                leaf = head.isleaf;
+                if (leaf) {
+                    for (int pos = 0; pos < head.fill_level; ++pos) {
+                        DBAttrType *key = key_at(ptr, pos);
+                        set_filter_bits(bits, numHashes, filter_hash(*key));
+                        delete key;
+                    }
+                }
+                block = leaf ? head.next.page : child_at(ptr, head, 0).page;
+            } catch (DBException &e) {
+                unfix_block(bacb);
+                throw;
+            }
+            unfix_block(bacb);
+        }
+    } catch (DBException &e) {
+        lock_guard<mutex> guard(filter->lock);
+        filter->rebuilding = false;
+        filter->changed.notify_all();
+        throw;
+    }
+
+    lock_guard<mutex> guard(filter->lock);
+    filter->bits.swap(bits);
+    filter->numHashes = numHashes;
+    filter->expectedKeys = expectedKeys;
+    filter->removed = 0;
+    filter->rebuilding = false;
+    filter->changed.notify_all();
+    persist_filter();
+}
+
+/**
+ * Schreibt die Bits in die Filterbloecke (werden bei Bedarf belegt oder freigegeben) und
+ * danach die Beschreibung mit Zustand clean in den Metablock. Der Aufrufer haelt filter->lock.
+ */
+void DBMyIndex::persist_filter() {
+    LOG4CXX_DEBUG(logger, "persist filter");
+    // bis die Beschreibung geschrieben ist, gilt der gespeicherte Filter als veraltet
+    if (filter->dirty == false)
+        mark_filter_dirty();
+
+    uint blockSize = DBFileBlock::getBlockSize();
+    uint bytes = filter->bits.size() * sizeof(uint64_t);
+    uint count = (bytes + blockSize - 1) / blockSize;
+    vector<BlockNo> &blocks = filter->blocks;
+    for (uint i = 0; i < count; ++i) {
+        DBBACB bacb = i < blocks.size() ? bufMgr.fixBlock(file, blocks[i], LOCK_EXCLUSIVE) : fix_free_block();
+        if (i == blocks.size())
+            blocks.push_back(bacb.getBlockNo());
+        memset(bacb.getDataPtr(), 0, blockSize);
+        memcpy(bacb.getDataPtr(), (char *) &filter->bits[0] + i * blockSize, min(bytes - i * blockSize, blockSize));
+        bacb.setModified();
+        unfix_block(bacb);
+        log_progress();
+    }
+    while (blocks.size() > count) {
+        DBBACB bacb = bufMgr.fixBlock(file, blocks.back(), LOCK_EXCLUSIVE);
+        free_node(bacb);
+        blocks.pop_back();
+        log_progress();
+    }
+
+    uint desc[5] = {filter->bits.empty() ? (uint) filterNone : (uint) filterClean, filter->numHashes,
+                    filter->expectedKeys, (uint) (filter->bits.size() / filterLineWords), count};
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE);
+    memcpy(meta.getDataPtr() + filterOffset, desc, filterDescSize);
+    if (count > 0)
+        memcpy(meta.getDataPtr() + filterOffset + filterDescSize, &blocks[0], count * sizeof(BlockNo));
+    meta.setModified();
+    unfix_block(meta);
+    filter->dirty = false;
+}
+
+/**
+ * Anzahl der Filterbloecke, deren Nummern in den Metablock passen
+ */
+uint DBMyIndex::maxFilterBlocks() const {
+    return (DBFileBlock::getBlockSize() - filterOffset - filterDescSize - sizeof(uint)) / sizeof(BlockNo);
+}
+
+/**
+ * Schaltet den Cache haeufig gesuchter Schluessel ein (capacity > 0) oder aus (0).
+ * Er haelt die Ergebnisse von find fuer bis zu capacity Schluessel, Ergebnisse mit mehr als
+ * maxTids TIDs werden nicht aufgenommen. Verdraengt wird nach dem Uhrzeigerverfahren: neue
+ * Eintraege werden als erste verdraengt, getroffene ueberstehen einen Umlauf des Zeigers, so
+ * bleiben die haeufig gesuchten Schluessel im Cache. Der Cache gilt fuer alle Instanzen dieser
+ * Datei; er wird geleert, Kennzahlen (cacheStatistics()) beginnen neu.
+ */
+void DBMyIndex::setKeyCache(uint capacity, uint maxTids) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "setKeyCache()");
+    LOG4CXX_DEBUG(logger, "capacity: " + TO_STR(capacity));
+    LOG4CXX_DEBUG(logger, "maxTids: " + TO_STR(maxTids));
+
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+
+    cache_clear();
+    lock_guard<mutex> guard(keyCache->lock);
+    keyCache->capacity = capacity;
+    keyCache->maxTids = maxTids;
+    keyCache->slots.reserve(capacity);
+    keyCache->hits = 0;
+    keyCache->misses = 0;
+    keyCache->evictions = 0;
+    keyCache->invalidations = 0;
+}
+
+/**
+ * Kennzahlen des Schluesselcaches dieser Datei
+ */
+DBMyIndex::CacheStatistics DBMyIndex::cacheStatistics() {
+    LOG4CXX_INFO(logger, "cacheStatistics()");
+
+    lock_guard<mutex> guard(keyCache->lock);
+    CacheStatistics stats;
+    stats.capacity = keyCache->capacity;
+    stats.maxTids = keyCache->maxTids;
+    stats.entries = keyCache->index.size();
+    stats.hits = keyCache->hits;
+    stats.misses = keyCache->misses;
+    stats.evictions = keyCache->evictions;
+    stats.invalidations = keyCache->invalidations;
+    return stats;
+}
+
+/**
+ * Sucht val im Schluesselcache, bei einem Treffer stehen dessen TIDs in tids.
+ * generation: Stand der Invalidierungen fuer ein folgendes cache_fill()
+ */
+bool DBMyIndex::cache_lookup(const DBAttrType &val, DBListTID &tids, unsigned long &generation) {
+    lock_guard<mutex> guard(keyCache->lock);
+    generation = keyCache->generation;
+    if (keyCache->capacity == 0)
+        return false;
+    vector<char> raw;
+    uint size = normalize_key(val, raw);
+    unordered_map<string, uint>::iterator it = keyCache->index.find(string(&raw[0], size));
+    if (it == keyCache->index.end()) {
+        keyCache->misses += 1;
+        return false;
+    }
+    key_cache::slot &entry = keyCache->slots[it->second];
+    entry.referenced = true;
+    tids.assign(entry.tids.begin(), entry.tids.end());
+    keyCache->hits += 1;
+    return true;
+}
+
+/**
+ * Nimmt das Ergebnis tids von find(val) in den Cache auf, sofern seit cache_lookup() nichts
+ * invalidiert wurde (sonst koennte es veraltet sein). Ist der Cache voll, wird der erste
+ * freie oder seit dem letzten Umlauf nicht getroffene Eintrag hinter hand ersetzt.
+ */
+void DBMyIndex::cache_fill(const DBAttrType &val, const DBListTID &tids, unsigned long generation) {
+    lock_guard<mutex> guard(keyCache->lock);
+    if (keyCache->capacity == 0 || keyCache->generation != generation || tids.size() > keyCache->maxTids)
+        return;
+    vector<char> raw;
+    uint size = normalize_key(val, raw);
+    string key(&raw[0], size);
+    if (keyCache->index.count(key) > 0)
+        return;
+
+    vector<key_cache::slot> &slots = keyCache->slots;
+    uint pos;
+    if (slots.size() < keyCache->capacity) {
+        pos = slots.size();
+        slots.push_back(key_cache::slot());
+    } else {
+        while (true) {
+            pos = keyCache->hand;
+            keyCache->hand = (keyCache->hand + 1) % slots.size();
+            if (slots[pos].key.empty() || slots[pos].referenced == false)
+                break;
+            slots[pos].referenced = false;
+        }
+        if (slots[pos].key.empty() == false) {
+            keyCache->index.erase(slots[pos].key);
+            keyCache->evictions += 1;
+        }
+    }
+    slots[pos].key = key;
+    slots[pos].tids.assign(tids.begin(), tids.end());
+    slots[pos].referenced = false;
+    keyCache->index[key] = pos;
+}
 
-TID DBMyIndex::initNode(bool isroot, bool isleaf, TID next) {
-    //Neuen Block für Leaf
-    bacbStack.push(bufMgr.fixNewBlock(file));
-    char *ptr = bacbStack.top().getDataPtr();
-    char *leafptr = ptr;
-    uint *cnt = (uint *) ptr;
-    if (*cnt == 0) {
-        // memcpy (*destination, *source, size);
-        memcpy(ptr, &isroot, sizeof(bool));
-        ptr += sizeof(bool);
-        memcpy(ptr, &isleaf, sizeof(bool));
-        ptr += sizeof(bool);
-        int fill_level = 0;
-        memcpy(ptr, &fill_level, sizeof(int));
-        ptr += sizeof(int);
-        memcpy(ptr, &next, sizeof(TID));
+/**
+ * Verwirft die Cacheeintraege der Schluessel keys, nachdem sie geaendert wurden
+ */
+void DBMyIndex::cache_invalidate(const vector<const DBAttrType *> &keys) {
+    lock_guard<mutex> guard(keyCache->lock);
+    keyCache->generation += 1;
+    if (keyCache->index.empty())
+        return;
+    vector<char> raw;
+    for (uint i = 0; i < keys.size(); ++i) {
+        uint size = normalize_key(*keys[i], raw);
+        unordered_map<string, uint>::iterator it = keyCache->index.find(string(&raw[0], size));
+        if (it == keyCache->index.end())
+            continue;
+        key_cache::slot &entry = keyCache->slots[it->second];
+        entry.key.clear();
+        entry.tids.clear();
+        keyCache->index.erase(it);
+        keyCache->invalidations += 1;
     }
+}
 
-    TID tid;
-    tid.page = bacbStack.top().getBlockNo();
-    tid.slot = 0;
-    return tid;
+/**
+ * Leert den Schluesselcache, z.B. nachdem der ganze Baum neu geschrieben wurde
+ */
+void DBMyIndex::cache_clear() {
+    lock_guard<mutex> guard(keyCache->lock);
+    keyCache->generation += 1;
+    keyCache->slots.clear();
+    keyCache->index.clear();
+    keyCache->hand = 0;
 }
 
+/**
+ * Schaltet den Redo-Log (Datei logName(file)) der Indexdatei ein oder aus. Mit Log kehrt jede
+ * aendernde Operation erst zurueck, wenn die Bilder ihrer geaenderten Seiten im Log dauerhaft
+ * sind; gleichzeitige Operationen teilen sich dabei ein fsync. Die Seiten selbst schreibt der
+ * Puffermanager spaeter, DBMyBufferMgr erst nach ihren Bildern im Log. Nach einem Absturz spielt
+ * das naechste Oeffnen den Log ein. Gepufferte Einfuegungen (setInsertBuffer()) stuenden bis zum
+ * Leeren des Puffers in keinem Log, der Log laesst sich deshalb nur ohne Einfuegepuffer
+ * einschalten. Beim Einschalten werden einmalig alle Bloecke der Datei geschrieben; waehrend des
+ * Umschaltens darf der Index nicht anderweitig geaendert werden.
+ */
+void DBMyIndex::setWriteAheadLog(bool enable) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "setWriteAheadLog()");
+    LOG4CXX_DEBUG(logger, "enable: " + TO_STR(enable));
 
-/** Split node of tree
- * A Node is a Middle-Node... so no leaf or root
- * @param val
- * @param tid
- * @param node
- * @param parent_ptr
- * @param islast
- * @return
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+    if (enable == redoLog->enabled.load())
+        return;
+    if (enable) {
+        lock_guard<mutex> guard(insertBuffer->lock);
+        if (insertBuffer->capacity > 0)
+            throw DBIndexException("write-ahead log requires the insert buffer to be off");
+    }
+
+    string path = logName(file);
+    if (enable) {
+        //alle bisherigen Aenderungen stehen in der Datei, der Log beginnt leer
+        flush_file();
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || fsync(fd) != 0 || DBMyIndexSnapshot::syncDirectory(path) == false) {
+            if (fd >= 0)
+                close(fd);
+            throw DBIndexException("can not create write-ahead log " + path);
+        }
+        lock_guard<mutex> guard(redoLog->lock);
+        redoLog->fd = fd;
+        redoLog->opened = true;
+        redoLog->failed = false;
+        redoLog->base = redoLog->durable = redoLog->appended;
+        redoLog->pending.clear();
+        redoLog->pages.clear();
+        redoLog->enabled.store(true);
+        return;
+    }
+
+    log_commit();
+    checkpoint_log();
+    lock_guard<mutex> guard(redoLog->lock);
+    redoLog->enabled.store(false);
+    //auf andere Gruppen wartende Threads haengen nun nichts mehr an (siehe log_append())
+    redoLog->changed.notify_all();
+    close(redoLog->fd);
+    redoLog->fd = -1;
+    redoLog->pending.clear();
+    redoLog->pages.clear();
+    unlink(path.c_str());
+}
+
+/**
+ * Schreibt die Seiten mit Bildern im Log und kuerzt ihn (geschieht sonst automatisch, sobald er
+ * logCheckpointBytes uebersteigt)
  */
-DBMyIndex::value_container
-DBMyIndex::split_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr) {
+void DBMyIndex::checkpointLog() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "checkpointLog()");
 
-    value_container vc;
-    vc.tid.page = -1;
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
 
-    //Read Values of Page
-    char *ptr = bacbStack.top().getDataPtr();
-    char *leafptr = ptr;
+    log_commit();
+    checkpoint_log();
+}
+
+/**
+ * Name des Redo-Logs einer Indexdatei
+ */
+string DBMyIndex::logName(const DBFile &file) {
+    return file.getFileName() + ".wal";
+}
+
+/**
+ * Kennzahlen des Redo-Logs dieser Datei
+ */
+DBMyIndex::LogStatistics DBMyIndex::logStatistics() {
+    LOG4CXX_INFO(logger, "logStatistics()");
+
+    lock_guard<mutex> guard(redoLog->lock);
+    LogStatistics stats;
+    stats.enabled = redoLog->enabled.load();
+    stats.bytes = redoLog->appended - redoLog->base;
+    stats.commits = redoLog->commits;
+    stats.syncs = redoLog->syncs;
+    stats.checkpoints = redoLog->checkpoints;
+    return stats;
+}
+
+/**
+ * Gibt bacb frei; eine geaenderte Seite wird vorher fuer den Redo-Log erfasst
+ */
+void DBMyIndex::unfix_block(DBBACB &bacb) {
+    if (bacb.getModified() && redoLog->enabled.load())
+        log_page(bacb);
+    bufMgr.unfixBlock(bacb);
+}
 
-    int block_nr = bacbStack.top().getBlockNo();
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+/**
+ * Kopiert das Bild der (noch exklusiv gefixten) Seite mit neuer Version in den Cursor. Bis es
+ * angehaengt ist, darf die Seite nicht geschrieben werden (page_state::pending).
+ */
+void DBMyIndex::log_page(DBBACB &bacb) {
+    op_cursor &cur = cursor();
+    BlockNo block = bacb.getBlockNo();
+    uint64_t version;
+    {
+        lock_guard<mutex> guard(redoLog->lock);
+        version = ++redoLog->version;
+        if (cur.redoGroup == 0) {
+            cur.redoGroup = ++redoLog->groups;
+            redoLog->open[cur.redoGroup].cursor = &cur;
+        }
+        redo_log::page_state &state = redoLog->pages[block];
+        //das neue Bild enthaelt die noch nicht angehaengten Aenderungen der anderen Gruppe
+        if (state.pending && state.group != cur.redoGroup)
+            redoLog->open[cur.redoGroup].after.push_back(state.group);
+        state.version = version;
+        state.pending = true;
+        state.owner = this_thread::get_id();
+        state.group = cur.redoGroup;
     }
+    size_t at = cur.redo.size();
+    cur.redo.resize(at + logPageHead + DBFileBlock::getBlockSize());
+    memcpy(&cur.redo[at], &block, sizeof(BlockNo));
+    memcpy(&cur.redo[at + sizeof(BlockNo)], &version, sizeof(uint64_t));
+    memcpy(&cur.redo[at + logPageHead], bacb.getDataPtr(), DBFileBlock::getBlockSize());
+    cur.redoPages.push_back(make_pair(block, version));
+}
 
-    bool isroot;
-    char *isrootptr = ptr;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
+/**
+ * Haengt die Seitenbilder von cur als Gruppe an log an (noch nicht dauerhaft, siehe
+ * sync_log()); cur.redoEnd ist danach das Ende der Gruppe. Seiten, von denen inzwischen ein
+ * neueres Bild erfasst wurde, bleiben pending. Hat cur Seiten geaendert, deren vorige Bilder noch
+ * im Cursor einer anderen Operation liegen (open_group::after), wartet cur, bis diese Gruppen
+ * angehaengt sind; sonst stuende nach einem Absturz z.B. ein Blatt mit einem halben Split eines
+ * anderen Threads im Log. Warten diese ihrerseits nur noch (auch auf cur), kommen alle zusammen
+ * als eine Gruppe in den Log. Ohne wait haengt log_append() nur an, wenn es nicht warten muss
+ * (Rueckgabe false sonst). Mit wait darf der Thread keine Seite gefixt halten. Weckt Threads,
+ * die auf pending-Seiten oder Gruppen warten.
+ */
+bool DBMyIndex::log_append(redo_log &log, op_cursor &cur, bool wait) {
+    //die Bilder wartender Cursor haengt ggf. ein anderer Thread an, gelesen werden sie nur unter lock
+    unique_lock<mutex> guard(log.lock);
+    if (cur.redoPages.empty())
+        return true;
+    set<uint64_t> together;
+    while (log.enabled.load() && log_ready(log, cur.redoGroup, together) == false) {
+        if (wait == false)
+            return false;
+        log.open[cur.redoGroup].waiting = true;
+        log.changed.wait(guard);
+        //von einem anderen Thread mit seiner Gruppe angehaengt
+        if (cur.redoGroup == 0)
+            return true;
+        log.open[cur.redoGroup].waiting = false;
+        together.clear();
+    }
+    vector<op_cursor *> members(1, &cur);
+    for (set<uint64_t>::iterator it = together.begin(); it != together.end(); ++it)
+        members.push_back(log.open[*it].cursor);
+    if (log.enabled.load()) {
+        vector<char> merged;
+        for (uint i = 1; i < members.size(); ++i) {
+            if (i == 1)
+                merged = cur.redo;
+            merged.insert(merged.end(), members[i]->redo.begin(), members[i]->redo.end());
+        }
+        const vector<char> &body = members.size() > 1 ? merged : cur.redo;
+        uint32_t length = body.size();
+        uint64_t checksum = log_checksum(&body[0], length);
+        char head[logGroupHead];
+        memcpy(head, &logMagic, sizeof(uint32_t));
+        memcpy(head + sizeof(uint32_t), &length, sizeof(uint32_t));
+        memcpy(head + sizeof(uint32_t) * 2, &checksum, sizeof(uint64_t));
+        uint64_t start = log.appended + logGroupHead;
+        log.pending.insert(log.pending.end(), head, head + logGroupHead);
+        log.pending.insert(log.pending.end(), body.begin(), body.end());
+        log.appended += logGroupHead + length;
+        uint64_t record = logPageHead + DBFileBlock::getBlockSize();
+        uint at = 0;
+        for (uint m = 0; m < members.size(); ++m) {
+            vector<pair<BlockNo, uint64_t> > &pages = members[m]->redoPages;
+            for (uint i = 0; i < pages.size(); ++i, ++at) {
+                redo_log::page_state &state = log.pages[pages[i].first];
+                if (state.version != pages[i].second)
+                    continue;
+                state.offset = start + at * record;
+                state.lsn = log.appended;
+                state.pending = false;
+            }
+        }
+    }
+    for (uint m = 0; m < members.size(); ++m) {
+        log.open.erase(members[m]->redoGroup);
+        if (log.enabled.load())
+            members[m]->redoEnd = log.appended;
+        members[m]->redo.clear();
+        members[m]->redoPages.clear();
+        members[m]->redoGroup = 0;
+    }
+    log.pressure.store(false);
+    log.changed.notify_all();
+    return true;
+}
 
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
+/**
+ * Darf group jetzt angehaengt werden? together: die noch offenen Gruppen, die (auch mittelbar)
+ * vor ihr in den Log muessen. Wartet deren Thread bei allen, kommen sie mit group zusammen in
+ * den Log, sonst (Rueckgabe false) muss group warten. Nur unter log.lock.
+ */
+bool DBMyIndex::log_ready(redo_log &log, uint64_t group, set<uint64_t> &together) {
+    bool ready = true;
+    vector<uint64_t> todo(1, group);
+    while (todo.empty() == false) {
+        redo_log::open_group &open = log.open[todo.back()];
+        todo.pop_back();
+        for (uint i = 0; i < open.after.size(); ++i) {
+            uint64_t before = open.after[i];
+            if (before == group || log.open.count(before) == 0 || together.insert(before).second == false)
+                continue;
+            ready = ready && log.open[before].waiting;
+            todo.push_back(before);
+        }
+    }
+    return ready;
+}
 
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    char *old_level_ptr = ptr;
-    ptr += sizeof(int);
+/**
+ * Unterwegs in langen Operationen (zwischen zwei Seiten): haengt die bisherigen Bilder an, wenn
+ * es logGroupPages sind oder ein anderer Thread auf eine pending-Seite wartet. So bleiben die
+ * Seiten fuer den Puffermanager verdraengbar und der Cursor klein. Nur an Stellen, an denen die
+ * Datei auch ohne den Rest der Operation stimmt (persist_filter(): Filter als veraltet markiert,
+ * recount(): Flag des gezaehlten Baums noch aus), die Gruppe wird nach einem Absturz eingespielt.
+ * Muesste die Gruppe auf eine andere warten, bleiben die Bilder bis zur naechsten Gelegenheit im
+ * Cursor: der Thread haelt hier Seiten gefixt.
+ */
+void DBMyIndex::log_progress() {
+    op_cursor &cur = cursor();
+    if (cur.redoPages.size() >= logGroupPages || (cur.redoPages.empty() == false && redoLog->pressure.load()))
+        log_append(*redoLog, cur, false);
+}
 
-    TID next;
-    next.read(ptr);
-    char *next_ptr = ptr;
-    ptr += sizeof(TID);
-    char *old_values_ptr = ptr;
+/**
+ * Ende einer aendernden Operation: haengt ihre Seitenbilder an und wartet, bis der Log bis
+ * dorthin dauerhaft ist. Danach ggf. ein Checkpoint, wenn der Log zu gross geworden ist.
+ * Bei Aufruf ist keine Seite gefixt.
+ */
+void DBMyIndex::log_commit() {
+    if (redoLog->enabled.load() == false)
+        return;
+    op_cursor &cur = cursor();
+    bool wrote = cur.redoPages.empty() == false;
+    log_append(*redoLog, cur);
+    sync_log(*redoLog, cur.redoEnd);
+    bool full;
+    {
+        lock_guard<mutex> guard(redoLog->lock);
+        if (wrote)
+            redoLog->commits += 1;
+        full = redoLog->appended - redoLog->base > logCheckpointBytes;
+    }
+    if (full)
+        checkpoint_log();
+}
 
+/**
+ * Ende einer aendernden Operation, die geworfen hat (redo_scope): ihre schon geaenderten Seiten
+ * stehen so im Puffer und koennen geschrieben werden, ihre Bilder kommen deshalb wie bei
+ * log_commit() in den Log (ohne als Commit gezaehlt zu werden), statt pending im Cursor zu
+ * bleiben. Nach log_commit() ist der Cursor leer. Ein Fehler des Logs wird nur protokolliert, der urspruengliche Fehler fliegt weiter.
+ * Bei Aufruf ist keine Seite gefixt.
+ */
+void DBMyIndex::log_abort() {
+    op_cursor &cur = cursor();
+    if (cur.redoPages.empty())
+        return;
+    try {
+        //auch bei ausgeschaltetem Log, die Bilder werden dann verworfen
+        log_append(*redoLog, cur);
+        log_commit();
+    } catch (DBException &e) {
+        LOG4CXX_ERROR(logger, "commit of the write-ahead log failed");
+    }
+}
 
-    TID new_node_next;
-    //Initialize new node (for the smaller values of the acutal node)
-    vc.tid = initNode(false, isleaf, new_node_next);
-    char *newnode_ptr = bacbStack.top().getDataPtr();
-    char *new_values_ptr = newnode_ptr + sizeof(bool) * 2 + sizeof(int) + sizeof(TID);
-    char *new_next_ptr = newnode_ptr + sizeof(bool) * 2 + sizeof(int);
-    DBAttrType *searchval;
-    bool inserted = false;
-    //Copy small Values in New Node
-    for (int i = 0; i < fill_level / 2; i++) {
-        searchval = DBAttrType::read(ptr, attrType);
-        if (val.operator>(*searchval) || inserted) {
-            searchval->write(new_values_ptr);
-            ptr += sizeof(val);
-            new_values_ptr += sizeof(val);
-            TID tid_swap;
-            tid_swap.read(ptr);
-            tid_swap.write(new_values_ptr);
-            ptr += sizeof(TID);
-            new_values_ptr += sizeof(TID);
-        } else {
-            val.write(new_values_ptr);
-            ptr += sizeof(val);
-            new_values_ptr += sizeof(val);
-            tid.write(new_values_ptr);
-            ptr += sizeof(TID);
-            new_values_ptr += sizeof(TID);
-            inserted = true;
-        }
-    }
-
-    //Take the value of the middle and safe it for the parentnode
-    searchval = DBAttrType::read(ptr, attrType);
-    if (val.operator>(*searchval) || inserted) {
-        vc.val = DBAttrType::read(ptr, attrType);
-        ptr += sizeof(val);
-        TID swap_tid;
-        swap_tid.read(ptr);
-        swap_tid.write(new_next_ptr);
-        ptr += sizeof(TID);
-    } else {
-        *vc.val = val;
-        tid.write(new_next_ptr);
-    }
-
-    //Copy the bigger values to the beginning of the old node
-    for (int i = 0; i < fill_level / 2; i++) {
-        searchval = DBAttrType::read(ptr, attrType);
-        if (val.operator>(*searchval) || inserted) {
-            searchval->write(old_values_ptr);
-            ptr += sizeof(val);
-            old_values_ptr += sizeof(val);
-            TID tid_swap;
-            tid_swap.read(ptr);
-            tid_swap.write(old_values_ptr);
-            ptr += sizeof(TID);
-            old_values_ptr += sizeof(TID);
+/**
+ * Wartet, bis der Log bis lsn dauerhaft ist (Group Commit): schreibt gerade kein anderer
+ * Thread, schreibt dieser alle bisher angehaengten Gruppen mit einem fsync, sonst wartet er auf
+ * das Ende dieses Schreibens und prueft erneut.
+ */
+void DBMyIndex::sync_log(redo_log &log, uint64_t lsn) {
+    unique_lock<mutex> guard(log.lock);
+    while (log.durable < lsn) {
+        if (log.failed)
+            throw DBIndexException("write-ahead log failed");
+        if (log.syncing) {
+            log.changed.wait(guard);
+            continue;
+        }
+        log.syncing = true;
+        vector<char> batch;
+        batch.swap(log.pending);
+        uint64_t end = log.appended;
+        uint64_t offset = log.durable - log.base;
+        int fd = log.fd;
+        guard.unlock();
+        bool ok = write_fully(fd, batch.empty() ? NULL : &batch[0], batch.size(), offset) && fdatasync(fd) == 0;
+        guard.lock();
+        log.syncing = false;
+        if (ok) {
+            log.durable = end;
+            log.syncs += 1;
         } else {
-            val.write(old_values_ptr);
-            old_values_ptr += sizeof(val);
-            tid.write(old_values_ptr);
-            old_values_ptr += sizeof(TID);
-            inserted = true;
+            LOG4CXX_ERROR(logger, "write of write-ahead log failed");
+            log.failed = true;
+        }
+        log.changed.notify_all();
+    }
+}
+
+/**
+ * Darf block jetzt geschrieben werden (siehe DBMyBufferMgr::WriteAheadHook)? Ohne wait nur
+ * Auskunft. Mit wait wird der Log bis zum letzten Bild der Seite dauerhaft geschrieben; liegt ein
+ * neueres Bild noch im Cursor einer anderen Operation, wartet der Thread hoechstens logWaitMillis
+ * auf sie. Seiten der eigenen laufenden Operation bleiben bis zu ihrem Ende ungeschrieben: ihre
+ * Bilder mitten in der Operation anzuhaengen liesse nach einem Absturz nur einen Teil von ihr
+ * (z.B. eines Splits) im Log.
+ */
+DBMyBufferMgr::WriteAheadState DBMyIndex::may_write(redo_log &log, BlockNo blockNo, bool wait) {
+    unique_lock<mutex> guard(log.lock);
+    if (log.enabled.load() == false)
+        return DBMyBufferMgr::WRITE_NOW;
+    map<BlockNo, redo_log::page_state>::iterator it = log.pages.find(blockNo);
+    if (it == log.pages.end())
+        return DBMyBufferMgr::WRITE_NOW;
+    if (it->second.pending) {
+        if (it->second.owner == this_thread::get_id())
+            return DBMyBufferMgr::WRITE_BLOCKED_HERE;
+        if (wait == false)
+            return DBMyBufferMgr::WRITE_BLOCKED;
+        log.pressure.store(true);
+        log.changed.wait_for(guard, chrono::milliseconds(logWaitMillis));
+        it = log.pages.find(blockNo);
+        if (it == log.pages.end())
+            return DBMyBufferMgr::WRITE_NOW;
+        if (it->second.pending)
+            return it->second.owner == this_thread::get_id() ? DBMyBufferMgr::WRITE_BLOCKED_HERE
+                                                             : DBMyBufferMgr::WRITE_BLOCKED;
+    }
+    if (it->second.lsn <= log.durable)
+        return DBMyBufferMgr::WRITE_NOW;
+    //nach einem gescheiterten Schreiben wird das Bild nie dauerhaft
+    if (log.failed)
+        return DBMyBufferMgr::WRITE_FAILED;
+    if (wait == false)
+        return DBMyBufferMgr::WRITE_AFTER_SYNC;
+    uint64_t lsn = it->second.lsn;
+    guard.unlock();
+    sync_log(log, lsn);
+    return DBMyBufferMgr::WRITE_NOW;
+}
+
+/**
+ * Wird von DBMyBufferMgr vor dem Schreiben eines Blocks aufgerufen (siehe registerClass()).
+ * Bloecke anderer Dateien als geoeffneter Indexe duerfen immer geschrieben werden. Scheitert
+ * mit wait das Schreiben des Logs, fliegt dessen DBException durch fixBlock zum Aufrufer.
+ */
+DBMyBufferMgr::WriteAheadState DBMyIndex::before_block_write(const string &fileName, BlockNo blockNo, bool wait) {
+    redo_log *log;
+    {
+        lock_guard<mutex> guard(redoLogsMutex);
+        map<string, redo_log>::iterator it = redoLogs.find(fileName);
+        if (it == redoLogs.end())
+            return DBMyBufferMgr::WRITE_NOW;
+        log = &it->second;
+    }
+    return may_write(*log, blockNo, wait);
+}
+
+/**
+ * Beim ersten Oeffnen der Datei im Prozess: gibt es einen Redo-Log, wird er eingespielt
+ * (recover_log()) und bleibt eingeschaltet. Ein Log zu einer neu angelegten Datei stammt von
+ * einer frueheren Datei gleichen Namens und wird geloescht.
+ */
+void DBMyIndex::open_log(bool created) {
+    string path = logName(file);
+    {
+        unique_lock<mutex> guard(redoLog->lock);
+        while (redoLog->recovering)
+            redoLog->changed.wait(guard);
+        if (redoLog->opened)
+            return;
+        redoLog->opened = true;
+        if (created) {
+            unlink(path.c_str());
+            return;
+        }
+        int fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0)
+            return;
+        redoLog->fd = fd;
+        redoLog->recovering = true;
+    }
+    //ohne redoLog->lock: das Einspielen schreibt ueber den Puffermanager (before_block_write())
+    try {
+        recover_log();
+    } catch (DBException &e) {
+        lock_guard<mutex> guard(redoLog->lock);
+        close(redoLog->fd);
+        redoLog->fd = -1;
+        redoLog->opened = false;
+        redoLog->recovering = false;
+        redoLog->changed.notify_all();
+        throw;
+    }
+    lock_guard<mutex> guard(redoLog->lock);
+    redoLog->recovering = false;
+    redoLog->enabled.store(true);
+    redoLog->changed.notify_all();
+}
+
+/**
+ * Spielt den Redo-Log ein: je Seite wird das Bild mit der hoechsten Version geschrieben. Die
+ * Gruppen werden bis zur ersten unvollstaendigen oder beschaedigten gelesen (Absturz waehrend
+ * des Schreibens), deren Operationen nie abgeschlossen wurden. Die Indexdatei wird mit fsync
+ * gesichert, danach ist der Log leer.
+ */
+void DBMyIndex::recover_log() {
+    int fd = redoLog->fd;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        throw DBIndexException("can not read write-ahead log");
+    vector<char> data(st.st_size);
+    if (data.empty() == false && read_fully(fd, &data[0], data.size(), 0) == false)
+        throw DBIndexException("can not read write-ahead log");
+
+    uint blockSize = DBFileBlock::getBlockSize();
+    uint64_t record = logPageHead + blockSize;
+    // je Seite Version und Position des neuesten Bildes
+    map<BlockNo, pair<uint64_t, size_t> > latest;
+    uint64_t maxVersion = 0;
+    size_t pos = 0;
+    uint groups = 0;
+    while (pos + logGroupHead <= data.size()) {
+        uint32_t magic, length;
+        uint64_t checksum;
+        memcpy(&magic, &data[pos], sizeof(uint32_t));
+        memcpy(&length, &data[pos + sizeof(uint32_t)], sizeof(uint32_t));
+        memcpy(&checksum, &data[pos + sizeof(uint32_t) * 2], sizeof(uint64_t));
+        size_t body = pos + logGroupHead;
+        if (magic != logMagic || length == 0 || length % record != 0 || length > data.size() - body
+            || log_checksum(&data[body], length) != checksum)
+            break;
+        for (size_t at = body; at < body + length; at += record) {
+            BlockNo block;
+            uint64_t version;
+            memcpy(&block, &data[at], sizeof(BlockNo));
+            memcpy(&version, &data[at + sizeof(BlockNo)], sizeof(uint64_t));
+            pair<uint64_t, size_t> &best = latest[block];
+            if (version > best.first)
+                best = make_pair(version, at + logPageHead);
+            maxVersion = max(maxVersion, version);
+        }
+        pos = body + length;
+        groups += 1;
+    }
+    LOG4CXX_INFO(logger, "recover write-ahead log: " + TO_STR(groups) + " groups, " + TO_STR(latest.size())
+                         + " pages, " + TO_STR(data.size() - pos) + " bytes discarded");
+
+    for (map<BlockNo, pair<uint64_t, size_t> >::iterator it = latest.begin(); it != latest.end(); ++it) {
+        while (bufMgr.getBlockCnt(file) <= it->first) {
+            DBBACB fresh = bufMgr.fixNewBlock(file);
+            bufMgr.unfixBlock(fresh);
+        }
+        DBBACB bacb = bufMgr.fixBlock(file, it->first, LOCK_EXCLUSIVE);
+        memcpy(bacb.getDataPtr(), &data[it->second.second], blockSize);
+        bacb.setModified();
+        try {
+            bufMgr.flushBlock(bacb);
+        } catch (DBException &e) {
+            bufMgr.unfixBlock(bacb);
+            throw;
+        }
+        bufMgr.unfixBlock(bacb);
+    }
+    //erst wenn die eingespielten Seiten dauerhaft sind, darf der Log leer werden
+    if (sync_file(file.getFileName()) == false)
+        throw DBIndexException("can not sync index file " + file.getFileName());
+    if (ftruncate(fd, 0) != 0 || fsync(fd) != 0)
+        throw DBIndexException("can not truncate write-ahead log");
+
+    lock_guard<mutex> guard(redoLog->lock);
+    redoLog->version = max(redoLog->version, maxVersion);
+    redoLog->base = redoLog->durable = redoLog->appended;
+}
+
+/**
+ * Schreibt alle Bloecke der Indexdatei (vor dem Einschalten des Logs)
+ */
+void DBMyIndex::flush_file() {
+    uint count = bufMgr.getBlockCnt(file);
+    for (BlockNo block = 0; block < count; ++block) {
+        DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_SHARED);
+        try {
+            bufMgr.flushBlock(bacb);
+        } catch (DBException &e) {
+            bufMgr.unfixBlock(bacb);
+            throw;
+        }
+        bufMgr.unfixBlock(bacb);
+    }
+}
+
+/**
+ * Checkpoint: schreibt alle Seiten mit Bildern bis zur aktuellen LSN mark, sichert die Indexdatei
+ * mit fsync und kuerzt den Log auf die Gruppen danach. Eine Seite, deren neuestes Bild noch in einem Cursor liegt, wird nicht
+ * geschrieben; ihr letztes Bild aus dem Log wird in den gekuerzten Log uebernommen.
+ * Rueckgabe false, wenn der Log aus ist oder ein anderer Thread gerade einen Checkpoint macht.
+ */
+bool DBMyIndex::checkpoint_log() {
+    uint64_t mark;
+    vector<BlockNo> blocks;
+    {
+        lock_guard<mutex> guard(redoLog->lock);
+        if (redoLog->enabled.load() == false || redoLog->checkpointing)
+            return false;
+        redoLog->checkpointing = true;
+        mark = redoLog->appended;
+        for (map<BlockNo, redo_log::page_state>::iterator it = redoLog->pages.begin();
+             it != redoLog->pages.end(); ++it)
+            blocks.push_back(it->first);
+    }
+    LOG4CXX_DEBUG(logger, "checkpoint: " + TO_STR(blocks.size()) + " pages");
+
+    vector<BlockNo> carry;
+    try {
+        sync_log(*redoLog, mark);
+        for (uint i = 0; i < blocks.size(); ++i) {
+            DBBACB bacb = bufMgr.fixBlock(file, blocks[i], LOCK_SHARED);
+            bool writable;
+            try {
+                //Seiten laufender Operationen bleiben im Log, ohne auf sie zu warten
+                DBMyBufferMgr::WriteAheadState state = may_write(*redoLog, blocks[i], false);
+                if (state == DBMyBufferMgr::WRITE_AFTER_SYNC)
+                    state = may_write(*redoLog, blocks[i], true);
+                writable = state == DBMyBufferMgr::WRITE_NOW;
+                if (writable)
+                    bufMgr.flushBlock(bacb);
+            } catch (DBException &e) {
+                bufMgr.unfixBlock(bacb);
+                throw;
+            }
+            bufMgr.unfixBlock(bacb);
+            if (writable == false)
+                carry.push_back(blocks[i]);
+        }
+        //die geschriebenen Seiten muessen dauerhaft sein, bevor ihre Bilder aus dem Log fallen
+        if (sync_file(file.getFileName()) == false)
+            throw DBIndexException("can not sync index file " + file.getFileName());
+        truncate_log(mark, carry);
+    } catch (DBException &e) {
+        lock_guard<mutex> guard(redoLog->lock);
+        redoLog->checkpointing = false;
+        throw;
+    }
+    lock_guard<mutex> guard(redoLog->lock);
+    redoLog->checkpointing = false;
+    redoLog->checkpoints += 1;
+    return true;
+}
+
+/**
+ * Ersetzt die Logdatei durch eine Gruppe mit den letzten Bildern der nicht geschriebenen Seiten
+ * carry, gefolgt vom dauerhaften Teil des Logs ab mark; alle uebrigen Seiten bis mark stehen
+ * in der Indexdatei und werden aus redo_log::pages entfernt. Unter redoLog->lock werden nur die
+ * Offsets bestimmt; Lesen, Schreiben, fsync und rename laufen ohne ihn (wie in sync_log()),
+ * so fragt der Puffermanager den Log waehrenddessen weiter ab. Bis zum Tausch der Dateien
+ * haelt truncate_log() syncing, neue Gruppen bleiben so lange in redo_log::pending.
+ */
+void DBMyIndex::truncate_log(uint64_t mark, const vector<BlockNo> &carry) {
+    string path = logName(file);
+    uint64_t record = logPageHead + DBFileBlock::getBlockSize();
+    int oldFd;
+    uint64_t base, durable;
+    vector<BlockNo> carried;
+    vector<uint64_t> offsets;
+    {
+        unique_lock<mutex> guard(redoLog->lock);
+        while (redoLog->syncing)
+            redoLog->changed.wait(guard);
+        if (redoLog->failed)
+            throw DBIndexException("write-ahead log failed");
+        for (uint i = 0; i < carry.size(); ++i) {
+            map<BlockNo, redo_log::page_state>::iterator it = redoLog->pages.find(carry[i]);
+            if (it == redoLog->pages.end() || it->second.lsn == 0 || it->second.lsn > mark)
+                continue;
+            carried.push_back(carry[i]);
+            offsets.push_back(it->second.offset);
+        }
+        redoLog->syncing = true;
+        oldFd = redoLog->fd;
+        base = redoLog->base;
+        durable = redoLog->durable;
+    }
+
+    vector<char> data(carried.empty() ? 0 : logGroupHead + carried.size() * record);
+    bool ok = true;
+    for (uint i = 0; ok && i < carried.size(); ++i)
+        ok = read_fully(oldFd, &data[logGroupHead + i * record], record, offsets[i] - base);
+    if (ok && carried.empty() == false) {
+        uint32_t length = data.size() - logGroupHead;
+        uint64_t checksum = log_checksum(&data[logGroupHead], length);
+        memcpy(&data[0], &logMagic, sizeof(uint32_t));
+        memcpy(&data[sizeof(uint32_t)], &length, sizeof(uint32_t));
+        memcpy(&data[sizeof(uint32_t) * 2], &checksum, sizeof(uint64_t));
+    }
+    uint64_t carrySize = data.size();
+    data.resize(carrySize + (durable - mark));
+    if (ok && durable > mark)
+        ok = read_fully(oldFd, &data[carrySize], durable - mark, mark - base);
+
+    string tmp = path + ".tmp";
+    string error = ok ? "" : "can not read write-ahead log";
+    int fd = -1;
+    if (ok) {
+        fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || write_fully(fd, data.empty() ? NULL : &data[0], data.size(), 0) == false
+            || fdatasync(fd) != 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+            if (fd >= 0)
+                close(fd);
+            unlink(tmp.c_str());
+            fd = -1;
+            error = "can not write write-ahead log " + path;
+        }
+    }
+    //ohne den Eintrag im Verzeichnis fehlten nach einem Absturz die Gruppen ab jetzt
+    bool named = fd < 0 || DBMyIndexSnapshot::syncDirectory(path);
+
+    lock_guard<mutex> guard(redoLog->lock);
+    redoLog->syncing = false;
+    redoLog->changed.notify_all();
+    if (fd < 0)
+        throw DBIndexException(error);
+    close(oldFd);
+    redoLog->fd = fd;
+    redoLog->base = mark - carrySize;
+
+    //inzwischen neu angehaengte Bilder (lsn > mark) stehen hinter mark und bleiben
+    for (uint i = 0; i < carried.size(); ++i) {
+        redo_log::page_state &state = redoLog->pages[carried[i]];
+        if (state.lsn > mark)
+            continue;
+        state.offset = redoLog->base + logGroupHead + i * record;
+        state.lsn = mark;
+    }
+    set<BlockNo> kept(carried.begin(), carried.end());
+    for (map<BlockNo, redo_log::page_state>::iterator it = redoLog->pages.begin(); it != redoLog->pages.end();) {
+        redo_log::page_state &state = it->second;
+        if (kept.count(it->first) == 0 && state.lsn <= mark) {
+            //geschrieben; ein neueres Bild im Cursor ist noch nicht im Log
+            if (state.pending) {
+                state.lsn = 0;
+            } else {
+                map<BlockNo, redo_log::page_state>::iterator done = it++;
+                redoLog->pages.erase(done);
+                continue;
+            }
         }
+        ++it;
     }
+    if (named == false) {
+        LOG4CXX_ERROR(logger, "sync of write-ahead log directory failed");
+        redoLog->failed = true;
+        throw DBIndexException("can not sync directory of write-ahead log " + path);
+    }
+}
 
-    fill_level = fill_level / 2;
+/**
+ * Fuegt createDBMyIndex zur globalen factory method-map hinzu
+ */
+int DBMyIndex::registerClass() {
+    setClassForName("DBMyIndex", createDBMyIndex);
+    DBMyBufferMgr::setWriteAheadHook(before_block_write);
+    return 0;
+}
 
-    //Set new values of old root
-    memcpy(old_level_ptr, &fill_level, sizeof(int));
 
-    //Set Values of new node
-    fill_level = leaf_size - fill_level;
-    char *new_node_fill_level = newnode_ptr + sizeof(bool) * 2;
+/**
+ * Liest den Kopf eines Knotens
+ */
+void DBMyIndex::read_head(char *ptr, node_header &head) const {
     // memcpy (*destination, *source, size);
-    memcpy(new_node_fill_level, &fill_level, sizeof(int));
+    head.format = ptr[0];
+    head.isroot = (ptr[1] & rootFlag) != 0;
+    head.isleaf = (ptr[1] & leafFlag) != 0;
+    memcpy(&head.fill_level, ptr + 4, sizeof(int));
+    memcpy(&head.next, ptr + 8, sizeof(TID));
+}
 
-    //Save Pages and Empty Buffer
-    bacbStack.top().setModified();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
+/**
+ * Schreibt den Kopf eines Knotens
+ */
+void DBMyIndex::write_head(char *ptr, const node_header &head) const {
+    // memcpy (*destination, *source, size);
+    ptr[0] = nodeFormat;
+    ptr[1] = (head.isroot ? rootFlag : 0) | (head.isleaf ? leafFlag : 0);
+    ptr[2] = 0;
+    ptr[3] = 0;
+    memcpy(ptr + 4, &head.fill_level, sizeof(int));
+    memcpy(ptr + 8, &head.next, sizeof(TID));
+}
 
-    bacbStack.top().setModified();
-    tree = printTree();
-    //return value container to insert in parent node
-    vc.isnew = true;
-    return vc;
+/**
+ * Liest Praefixlaenge und Schluesselbreite eines komprimierten Knotens
+ * (slottedWidth bei Saetzen variabler Laenge)
+ */
+void DBMyIndex::read_keyhead(char *ptr, uint &prefix, uint &width) const {
+    unsigned short value;
+    ptr += sizeOfHead;
+    memcpy(&value, ptr, sizeof(unsigned short));
+    prefix = value;
+    ptr += sizeof(unsigned short);
+    memcpy(&value, ptr, sizeof(unsigned short));
+    width = value;
+}
+
+/**
+ * Zeiger auf den Schluesselrest des Eintrags pos eines komprimierten Knotens,
+ * dessen TID direkt dahinter liegt; length ist die Laenge des Rests
+ */
+char *DBMyIndex::entry_ptr(char *ptr, int pos, uint &length) const {
+    uint prefix, width;
+    read_keyhead(ptr, prefix, width);
+    char *entries = ptr + sizeOfHead + sizeOfKeyHead + prefix;
+    if (width != slottedWidth) {
+        length = width;
+        return entries + pos * (width + sizeof(TID));
+    }
+    //Slotverzeichnis: Offset des Satzes (Laengenbyte, Schluesselrest, TID) in der Seite
+    unsigned short offset;
+    memcpy(&offset, entries + pos * sizeof(unsigned short), sizeof(unsigned short));
+    length = (unsigned char) ptr[offset];
+    return ptr + offset + 1;
+}
+
+/**
+ * Zeiger auf den Schluessel an Position pos (bei komprimierten Knoten nur dessen Rest)
+ */
+char *DBMyIndex::key_ptr(char *ptr, int pos) const {
+    if (isCompressed() == false)
+        return ptr + sizeOfHead + pos * keySize();
+    uint length;
+    return entry_ptr(ptr, pos, length);
+}
+
+/**
+ * Zeiger auf die TID an Position pos
+ */
+char *DBMyIndex::tid_ptr(char *ptr, int pos) const {
+    if (isCompressed() == false)
+        return ptr + sizeOfHead + entriesPerPage() * keySize() + pos * sizeof(TID);
+    uint length;
+    return entry_ptr(ptr, pos, length) + length;
+}
+
+/**
+ * Erstes Byte hinter count Eintraegen, dort beginnen die Posting-Listen
+ */
+char *DBMyIndex::entries_end(char *ptr, int count) const {
+    if (isCompressed() == false)
+        return tid_ptr(ptr, count);
+    if (count > 0)
+        return tid_ptr(ptr, count - 1) + sizeof(TID);
+    uint prefix, width;
+    read_keyhead(ptr, prefix, width);
+    return ptr + sizeOfHead + sizeOfKeyHead + prefix;
+}
+
+/**
+ * Platzbedarf von count Eintraegen samt Kopf ohne Posting-Listen; bei komprimierten Knoten
+ * fuer unkomprimierte Schluessel (obere Schranke)
+ */
+uint DBMyIndex::node_bytes(int count) const {
+    if (isCompressed())
+        return sizeOfHead + sizeOfKeyHead + count * entrySize();
+    //mehr als entriesPerPage() Schluessel passen nicht in den Schluesselbereich
+    uint keys = max((uint) count, entriesPerPage());
+    return sizeOfHead + keys * keySize() + count * sizeof(TID);
+}
+
+/**
+ * Belegte Bytes eines Knotens: Kopf, Eintraege und Posting-Listen; bei unkomprimierten
+ * Knoten nur die belegten Schluessel, nicht der ganze Schluesselbereich
+ */
+uint DBMyIndex::used_bytes(char *ptr, const node_header &head) const {
+    uint bytes;
+    if (isCompressed())
+        bytes = entries_end(ptr, head.fill_level) - ptr;
+    else
+        bytes = sizeOfHead + head.fill_level * entrySize();
+    for (int i = 0; i < head.fill_level && head.isleaf && unique == false; ++i) {
+        TID ref = tid_at(ptr, i);
+        if (is_list(ref) && (ref.slot & listFlag) != 0)
+            bytes += ref.slot & listLengthMask;
+    }
+    return bytes;
+}
+
+/**
+ * Ist der Knoten unterbelegt (weniger als die Haelfte der Seite belegt)?
+ */
+bool DBMyIndex::underfull(char *ptr, const node_header &head) const {
+    return used_bytes(ptr, head) < DBFileBlock::getBlockSize() / 2;
+}
+
+/**
+ * Schafft in einem unkomprimierten Knoten Platz fuer einen Eintrag an Position pos
+ */
+void DBMyIndex::open_slot(char *ptr, const node_header &head, int pos) const {
+    memmove(key_ptr(ptr, pos + 1), key_ptr(ptr, pos), (head.fill_level - pos) * keySize());
+    memmove(tid_ptr(ptr, pos + 1), tid_ptr(ptr, pos), (head.fill_level - pos) * sizeof(TID));
+}
+
+/**
+ * Anzahl der zusammenhaengend ab keys liegenden INTEGER- bzw. DOUBLE-Schluessel,
+ * die kleiner (orEqual: kleiner oder gleich) als val sind
+ */
+int DBMyIndex::search_keys(const char *keys, int count, const DBAttrType &val, bool orEqual) const {
+    char raw[sizeof(double)];
+    val.write(raw);
+    if (attrType == INT) {
+        int v;
+        memcpy(&v, raw, sizeof(int));
+        return count_less_int(keys, count, v, orEqual);
+    }
+    double v;
+    memcpy(&v, raw, sizeof(double));
+    return count_less_double(keys, count, v, orEqual);
+}
+
+/**
+ * Schreibt den vollstaendigen Schluessel an Position pos (keySize() Bytes) nach dst
+ */
+void DBMyIndex::decode_key(char *ptr, int pos, char *dst) const {
+    if (isCompressed() == false) {
+        memcpy(dst, key_ptr(ptr, pos), keySize());
+        return;
+    }
+    uint prefix, width, length;
+    read_keyhead(ptr, prefix, width);
+    char *entry = entry_ptr(ptr, pos, length);
+    memset(dst, 0, keySize());
+    memcpy(dst, ptr + sizeOfHead + sizeOfKeyHead, prefix);
+    memcpy(dst + prefix, entry, length);
+}
+
+/**
+ * Liest den Schluessel an Position pos (muss vom Aufrufer geloescht werden)
+ */
+DBAttrType *DBMyIndex::key_at(char *ptr, int pos) const {
+    if (isCompressed() == false)
+        return read_key(key_ptr(ptr, pos));
+    vector<char> key(keySize());
+    decode_key(ptr, pos, &key[0]);
+    return read_key(&key[0]);
+}
+
+/**
+ * Liest die TID an Position pos
+ */
+TID DBMyIndex::tid_at(char *ptr, int pos) const {
+    TID tid;
+    memcpy(&tid, tid_ptr(ptr, pos), sizeof(TID));
+    return tid;
+}
+
+/**
+ * Kind pos eines inneren Knotens, pos == fill_level liefert das rechteste Kind (next)
+ */
+TID DBMyIndex::child_at(char *ptr, const node_header &head, int pos) const {
+    if (pos == head.fill_level)
+        return head.next;
+    return tid_at(ptr, pos);
+}
+
+/**
+ * Setzt Kind pos eines inneren Knotens. Fuer pos == fill_level wird nur head.next
+ * geaendert, der Kopf muss danach vom Aufrufer geschrieben werden.
+ */
+void DBMyIndex::set_child(char *ptr, node_header &head, int pos, const TID &child) {
+    if (pos == head.fill_level)
+        head.next = child;
+    else
+        child.write(tid_ptr(ptr, pos));
+}
+
+/**
+ * Kopiert alle Eintraege eines Knotens mit vollstaendigen Schluesseln
+ * (je entrySize() Bytes) nach buf.
+ * Posting-Listen in der Seite werden an lists angehaengt, ihre Offsets in buf
+ * beziehen sich danach auf lists.
+ */
+void DBMyIndex::read_entries(char *ptr, const node_header &head, char *buf, vector<char> *lists) const {
+    for (int i = 0; i < head.fill_level; ++i) {
+        decode_key(ptr, i, buf + i * entrySize());
+        TID tid = tid_at(ptr, i);
+        tid.write(buf + i * entrySize() + keySize());
+    }
+    if (head.isleaf == false)
+        return;
+
+    for (int i = 0; i < head.fill_level; ++i) {
+        char *tid_ptr = buf + i * entrySize() + keySize();
+        TID ref;
+        ref.read(tid_ptr);
+        if (is_list(ref) == false || (ref.slot & listFlag) == 0)
+            continue;
+        assert(lists != NULL);
+        uint length = ref.slot & listLengthMask;
+        uint offset = lists->size();
+        lists->insert(lists->end(), ptr + ref.page, ptr + ref.page + length);
+        ref.page = offset;
+        ref.write(tid_ptr);
+    }
+}
+
+/**
+ * Berechnet Praefixlaenge und Schluesselbreite fuer count Eintraege aus buf und
+ * gibt den Platzbedarf des Knotens in Bytes zurueck.
+ * Sind Saetze variabler Laenge kleiner als Reste fester Breite, ist width = slottedWidth.
+ */
+uint DBMyIndex::encode_layout(const char *buf, int count, bool isleaf, uint &prefix, uint &width) const {
+    //Posting-Listen liegen hinter den Eintraegen eines Blattes; in inneren Knoten steht in
+    //TID::slot die Anzahl des Teilbaums (gezaehlter Baum), nicht listFlag
+    uint list_bytes = 0;
+    for (int i = 0; i < count && isleaf && unique == false; ++i) {
+        TID ref;
+        ref.read(buf + i * entrySize() + keySize());
+        if (is_list(ref) && (ref.slot & listFlag) != 0)
+            list_bytes += ref.slot & listLengthMask;
+    }
+
+    if (isCompressed() == false) {
+        prefix = 0;
+        width = keySize();
+        return node_bytes(count) + list_bytes;
+    }
+
+    prefix = count > 0 ? strnlen(buf, keySize()) : 0;
+    for (int i = 1; i < count && prefix > 0; ++i) {
+        const char *key = buf + i * entrySize();
+        uint same = 0;
+        while (same < prefix && key[same] == buf[same] && key[same] != '\0')
+            ++same;
+        prefix = same;
+    }
+    width = 0;
+    uint slotted = count * (sizeof(unsigned short) + 1);
+    for (int i = 0; i < count; ++i) {
+        uint length = strnlen(buf + i * entrySize(), keySize());
+        if (length - prefix > width)
+            width = length - prefix;
+        slotted += length - prefix;
+    }
+    uint fixed = count * width;
+    if (slotted < fixed)
+        width = slottedWidth;
+    return sizeOfHead + sizeOfKeyHead + prefix + min(fixed, slotted) + count * sizeof(TID) + list_bytes;
+}
+
+/**
+ * Passen count Eintraege aus buf auf eine Seite?
+ */
+bool DBMyIndex::fits(const char *buf, int count, bool isleaf) const {
+    uint prefix, width;
+    return encode_layout(buf, count, isleaf, prefix, width) <= DBFileBlock::getBlockSize();
+}
+
+/**
+ * Schreibt count Eintraege aus buf (vollstaendige Schluessel) samt Kopf in den Knoten,
+ * Posting-Listen werden aus lists hinter die Eintraege kopiert.
+ * Rueckgabe false, wenn sie nicht auf die Seite passen; der Knoten bleibt dann unveraendert.
+ */
+bool DBMyIndex::write_entries(char *ptr, node_header &head, const char *buf, int count,
+                              const vector<char> *lists) {
+    uint prefix, width;
+    if (encode_layout(buf, count, head.isleaf, prefix, width) > DBFileBlock::getBlockSize())
+        return false;
+
+    head.fill_level = count;
+    write_head(ptr, head);
+    if (isCompressed() == false) {
+        for (int i = 0; i < count; ++i) {
+            memcpy(key_ptr(ptr, i), buf + i * entrySize(), keySize());
+            memcpy(tid_ptr(ptr, i), buf + i * entrySize() + keySize(), sizeof(TID));
+        }
+    } else {
+        write_compressed(ptr, buf, count, prefix, width);
+    }
+    if (head.isleaf == false || unique == true)
+        return true;
+
+    //Posting-Listen hinter den letzten Eintrag legen und Offsets auf die Seite umrechnen
+    char *list_ptr = entries_end(ptr, count);
+    for (int i = 0; i < count; ++i) {
+        char *ref_ptr = tid_ptr(ptr, i);
+        TID ref;
+        ref.read(ref_ptr);
+        if (is_list(ref) == false || (ref.slot & listFlag) == 0)
+            continue;
+        assert(lists != NULL);
+        uint length = ref.slot & listLengthMask;
+        memcpy(list_ptr, &(*lists)[ref.page], length);
+        ref.page = list_ptr - ptr;
+        ref.write(ref_ptr);
+        list_ptr += length;
+    }
+    return true;
 }
 
-
 /**
- * Split Root Node if the root node is not a leaf
+ * Schreibt count Eintraege aus buf komprimiert (Praefix, Schluesselreste der Breite width).
+ * Bei width = slottedWidth folgt auf das Praefix ein Slotverzeichnis und dahinter lueckenlos
+ * die Saetze (Laengenbyte, Schluesselrest, TID) in Schluesselreihenfolge.
  */
+void DBMyIndex::write_compressed(char *ptr, const char *buf, int count, uint prefix, uint width) const {
+    char *key_ptr = ptr + sizeOfHead;
+    unsigned short value = prefix;
+    memcpy(key_ptr, &value, sizeof(unsigned short));
+    key_ptr += sizeof(unsigned short);
+    value = width;
+    memcpy(key_ptr, &value, sizeof(unsigned short));
+    key_ptr += sizeof(unsigned short);
+    if (prefix > 0)
+        memcpy(key_ptr, buf, prefix);
+    key_ptr += prefix;
+
+    if (width != slottedWidth) {
+        for (int i = 0; i < count; ++i) {
+            const char *entry = buf + i * entrySize();
+            memcpy(key_ptr, entry + prefix, width);
+            key_ptr += width;
+            memcpy(key_ptr, entry + keySize(), sizeof(TID));
+            key_ptr += sizeof(TID);
+        }
+        return;
+    }
 
-DBMyIndex::value_container DBMyIndex::split_root(const DBAttrType &val, const TID &tid, TID node) {
-
-    //Read Values of Page
-    char *ptr = bacbStack.top().getDataPtr();
-    char *leafptr = ptr;
+    char *record = key_ptr + count * sizeof(unsigned short);
+    for (int i = 0; i < count; ++i) {
+        const char *entry = buf + i * entrySize();
+        uint length = strnlen(entry, keySize()) - prefix;
+        value = record - ptr;
+        memcpy(key_ptr + i * sizeof(unsigned short), &value, sizeof(unsigned short));
+        *record = (unsigned char) length;
+        memcpy(record + 1, entry + prefix, length);
+        memcpy(record + 1 + length, entry + keySize(), sizeof(TID));
+        record += 1 + length + sizeof(TID);
+    }
+}
 
-    int block_nr = bacbStack.top().getBlockNo();
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+/**
+ * Ersetzt den Schluessel an Position pos durch key (vollstaendiger Schluessel).
+ * Rueckgabe false, wenn der komprimierte Knoten danach nicht mehr auf die Seite passt.
+ */
+bool DBMyIndex::replace_key(char *ptr, node_header &head, int pos, const char *key) {
+    if (isCompressed() == false) {
+        memcpy(key_ptr(ptr, pos), key, keySize());
+        return true;
     }
+    vector<char> buffer(head.fill_level * entrySize());
+    read_entries(ptr, head, &buffer[0]);
+    memcpy(&buffer[pos * entrySize()], key, keySize());
+    return write_entries(ptr, head, &buffer[0], head.fill_level);
+}
 
-    bool isroot;
-    char *isrootptr = ptr;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
+/**
+ * Kuerzester Separator s mit left < s <= right (Suffix Truncation).
+ * Nur VARCHAR-Schluessel werden gekuerzt: s ist right bis einschliesslich des
+ * ersten Zeichens, in dem sich left und right unterscheiden.
+ */
+void DBMyIndex::shortest_separator(const char *left, const char *right, char *dst) const {
+    memcpy(dst, right, keySize());
+    if (isCompressed() == false)
+        return;
+
+    uint length = strnlen(right, keySize());
+    uint same = 0;
+    while (same < length && left[same] == right[same])
+        ++same;
+    if (same < length)
+        memset(dst + same + 1, 0, keySize() - same - 1);
+}
+
+/**
+ * Waehlt die Teilungsposition moeglichst nahe der Mitte, so dass beide Haelften
+ * auf eine Seite passen (-1, wenn es keine solche gibt). Ohne Komprimierung ist das immer die Mitte.
+ * Bei inneren Knoten wandert der Eintrag an der Teilungsposition in den Elternknoten.
+ * append: Anhaengen am rechten Rand (aufsteigende Schluessel), das Blatt behaelt alle alten
+ * Eintraege (100/0), ein innerer Knoten gibt nur ein Zehntel ab (90/10).
+ */
+int DBMyIndex::split_point(const char *buf, int count, bool isleaf, bool append) const {
+    if (append) {
+        int split = isleaf ? count - 1 : count - 1 - max(count / 10, 1);
+        int right = isleaf ? split : split + 1;
+        if (split >= 1 && fits(buf, split, isleaf) && fits(buf + right * entrySize(), count - right, isleaf))
+            return split;
+    }
+    int middle = count / 2;
+    int last = isleaf ? count - 1 : count - 2;
+    for (int d = 0; d <= count; ++d) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            int split = middle + sign * d;
+            if (split < 1 || split > last)
+                continue;
+            int right = isleaf ? split : split + 1;
+            if (fits(buf, split, isleaf) && fits(buf + right * entrySize(), count - right, isleaf))
+                return split;
+        }
+    }
+    return -1;
+}
 
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
+/**
+ * Verweist die TID eines Blatteintrags auf eine Posting-Liste statt auf ein Tupel?
+ */
+bool DBMyIndex::is_list(const TID &ref) const {
+    return unique == false && (ref.slot & (listFlag | overflowFlag)) != 0;
+}
 
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    char *old_level_ptr = ptr;
-    ptr += sizeof(int);
+/**
+ * Maximale Laenge einer Posting-Liste im Blatt, laengere Listen kommen in Ueberlaufbloecke.
+ * Damit passen auch nach dem Einfuegen immer beide Haelften eines gespaltenen Blattes.
+ */
+uint DBMyIndex::maxInlineList() const {
+    return DBFileBlock::getBlockSize() / 4;
+}
 
-    TID next;
-    next.read(ptr);
-    char *next_ptr = ptr;
-    ptr += sizeof(TID);
-    char *old_values_ptr = ptr;
+/**
+ * Haengt die Tupel-TIDs der Posting-Liste ref sortiert an tids an.
+ * base: Anfang der Seite bzw. des Puffers, auf den sich der Offset einer Liste im Blatt bezieht
+ */
+void DBMyIndex::read_postings(const TID &ref, const char *base, vector<TID> &tids) {
+    vector_sink sink(tids);
+    decode_postings(ref, base, sink);
+}
 
+/**
+ * Dekodiert die Posting-Liste ref und liefert ihre Tupel-TIDs sortiert an sink, ohne sie
+ * zwischenzuspeichern (nur eine Liste in Ueberlaufbloecken wird zuvor zusammengesetzt).
+ * Rueckgabe false, wenn sink abgebrochen hat.
+ */
+bool DBMyIndex::decode_postings(const TID &ref, const char *base, DBMyIndexSink &sink) {
+    if (is_list(ref) == false)
+        return sink.put(ref);
+
+    vector<char> overflow;
+    const char *ptr = base + ref.page;
+    if ((ref.slot & overflowFlag) != 0) {
+        read_overflow(ref.page, overflow);
+        ptr = &overflow[0];
+    }
 
-    TID new_node_next;
-    //Initialize new node (for the smaller values of the acutal root)
-    TID new_node_tid = initNode(false, isleaf, new_node_next);
-    char *newnode_ptr = bacbStack.top().getDataPtr();
-    char *new_values_ptr = newnode_ptr + sizeof(bool) * 2 + sizeof(int) + sizeof(TID);
-    char *new_next_ptr = newnode_ptr + sizeof(bool) * 2 + sizeof(int);
-    DBAttrType *searchval;
-    bool inserted = false;
-    //Copy small Values in New Node
-    for (int i = 0; i < fill_level / 2; i++) {
-        searchval = DBAttrType::read(ptr, attrType);
-        if (val.operator>(*searchval) || inserted) {
-            searchval->write(new_values_ptr);
-            ptr += sizeof(val);
-            new_values_ptr += sizeof(val);
-            TID tid_swap;
-            tid_swap.read(ptr);
-            tid_swap.write(new_values_ptr);
-            ptr += sizeof(TID);
-            new_values_ptr += sizeof(TID);
-        } else {
-            val.write(new_values_ptr);
-            ptr += sizeof(val);
-            new_values_ptr += sizeof(val);
-            tid.write(new_values_ptr);
-            ptr += sizeof(TID);
-            new_values_ptr += sizeof(TID);
-            inserted = true;
-        }
-    }
-
-    //Take the value of the middle and safe it for the new root
-    DBAttrType *root_val;
-    searchval = DBAttrType::read(ptr, attrType);
-    int loop_size = fill_level / 2;
-    bool add_value = false;
-    if (val.operator>(*searchval) || inserted) {
-        root_val = DBAttrType::read(ptr, attrType);
-        ptr += sizeof(val);
-        TID swap_tid;
-        swap_tid.read(ptr);
-        swap_tid.write(new_next_ptr);
-        ptr += sizeof(TID);
-        loop_size -= 1;
-        add_value = true;
-    } else {
-        *root_val = val;
-        tid.write(new_next_ptr);
-    }
-
-    //Copy the bigger values to the beginning of the old node
-    for (int i = 0; i < loop_size; i++) {
-        searchval = DBAttrType::read(ptr, attrType);
-        if (val.operator>(*searchval) || inserted) {
-            searchval->write(old_values_ptr);
-            ptr += sizeof(val);
-            old_values_ptr += sizeof(val);
-            TID tid_swap;
-            tid_swap.read(ptr);
-            tid_swap.write(old_values_ptr);
-            ptr += sizeof(TID);
-            old_values_ptr += sizeof(TID);
+    uint count = get_varint(ptr);
+    TID tid;
+    tid.page = get_varint(ptr);
+    tid.slot = get_varint(ptr);
+    if (sink.put(tid) == false)
+        return false;
+    for (uint i = 1; i < count; ++i) {
+        uint delta = get_varint(ptr);
+        if (delta == 0) {
+            tid.slot += get_varint(ptr);
         } else {
-            val.write(old_values_ptr);
-            old_values_ptr += sizeof(val);
-            tid.write(old_values_ptr);
-            old_values_ptr += sizeof(TID);
-            inserted = true;
+            tid.page += delta;
+            tid.slot = get_varint(ptr);
         }
+        if (sink.put(tid) == false)
+            return false;
     }
+    return true;
+}
 
-    if(add_value){
-        val.write(old_values_ptr);
-        old_values_ptr += sizeof(val);
-        tid.write(old_values_ptr);
-        old_values_ptr += sizeof(TID);
-        inserted = true;
+/**
+ * Kodiert die sortierten Tupel-TIDs tids und gibt die TID fuer den Blatteintrag zurueck:
+ * bei einer TID diese selbst, sonst einen Verweis auf die an lists angehaengte Liste oder,
+ * wenn sie laenger als maxInlineList() ist oder spill gesetzt ist, auf neue Ueberlaufbloecke.
+ */
+TID DBMyIndex::write_postings(const vector<TID> &tids, vector<char> &lists, bool spill) {
+    if (tids.size() == 1)
+        return tids[0];
+
+    vector<char> blob;
+    put_varint(blob, tids.size());
+    put_varint(blob, tids[0].page);
+    put_varint(blob, tids[0].slot);
+    for (uint i = 1; i < tids.size(); ++i) {
+        uint delta = tids[i].page - tids[i - 1].page;
+        put_varint(blob, delta);
+        put_varint(blob, delta == 0 ? tids[i].slot - tids[i - 1].slot : tids[i].slot);
     }
 
-    isroot = false;
-    fill_level = fill_level / 2;
-
-    //Set new values of old root
-    memcpy(isrootptr, &isroot, sizeof(bool));
-    memcpy(old_level_ptr, &fill_level, sizeof(int));
-
-    //Set Values of new node
-    fill_level = leaf_size - fill_level;
-    char *new_node_fill_level = newnode_ptr + sizeof(bool) * 2;
-    // memcpy (*destination, *source, size);
-    memcpy(new_node_fill_level, &fill_level, sizeof(int));
+    TID ref;
+    if (spill || blob.size() > maxInlineList()) {
+        ref.page = write_overflow(blob);
+        ref.slot = overflowFlag;
+        return ref;
+    }
+    ref.page = lists.size();
+    ref.slot = listFlag | blob.size();
+    lists.insert(lists.end(), blob.begin(), blob.end());
+    return ref;
+}
 
-    //Save Pages and Empty Buffer
-    bacbStack.top().setModified();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
+/**
+ * Gibt die Ueberlaufbloecke einer Posting-Liste an die Freiliste zurueck
+ */
+void DBMyIndex::free_postings(const TID &ref) {
+    if (is_list(ref) == false || (ref.slot & overflowFlag) == 0)
+        return;
+    BlockNo block = ref.page;
+    while (block != noBlockNo) {
+        DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_EXCLUSIVE);
+        TID next;
+        next.read(bacb.getDataPtr());
+        free_node(bacb);
+        block = next.page;
+    }
+}
 
-    bacbStack.top().setModified();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
+/**
+ * Liest die Kette von Ueberlaufbloecken ab block nach blob
+ */
+void DBMyIndex::read_overflow(BlockNo block, vector<char> &blob) {
+    while (block != noBlockNo) {
+        DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_SHARED);
+        char *ptr = bacb.getDataPtr();
+        TID next;
+        next.read(ptr);
+        uint used;
+        memcpy(&used, ptr + sizeof(TID), sizeof(uint));
+        ptr += sizeof(TID) + sizeof(uint);
+        blob.insert(blob.end(), ptr, ptr + used);
+        unfix_block(bacb);
+        block = next.page;
+    }
+}
 
-    //Initialize new Root
-    TID rootnext;
-    rootnext.page = block_nr;
-    TID new_root_tid = initNode(true, false, rootnext);
-    char *newroot_ptr = bacbStack.top().getDataPtr();
-    char *root_values_ptr = newroot_ptr + sizeof(bool) * 2 + sizeof(int) + sizeof(TID);
+/**
+ * Schreibt blob in eine neue Kette von Ueberlaufbloecken und gibt deren ersten Block zurueck.
+ * Die Kette wird von hinten aufgebaut, damit jeder Block beim Schreiben seinen Nachfolger kennt.
+ */
+BlockNo DBMyIndex::write_overflow(const vector<char> &blob) {
+    uint capacity = DBFileBlock::getBlockSize() - sizeof(TID) - sizeof(uint);
+    uint blocks = (blob.size() + capacity - 1) / capacity;
+    TID next;
+    next.page = noBlockNo;
+    next.slot = 0;
+    for (uint i = blocks; i > 0; --i) {
+        uint begin = (i - 1) * capacity;
+        uint used = min(capacity, (uint) blob.size() - begin);
+        DBBACB bacb = fix_free_block();
+        char *ptr = bacb.getDataPtr();
+        next.write(ptr);
+        memcpy(ptr + sizeof(TID), &used, sizeof(uint));
+        memcpy(ptr + sizeof(TID) + sizeof(uint), &blob[begin], used);
+        bacb.setModified();
+        next.page = bacb.getBlockNo();
+        unfix_block(bacb);
+    }
+    return next.page;
+}
 
-    //Save Middle-Value in Root
-    root_val->write(root_values_ptr);
-    root_values_ptr += sizeof(val);
-    new_node_tid.write(root_values_ptr);
+/**
+ * Erste Position, deren Schluessel groesser als val ist (binaere Suche).
+ * In inneren Knoten ist das die Position des Kindes, das val enthaelt.
+ */
+int DBMyIndex::upper_pos(char *ptr, const node_header &head, const DBAttrType &val) const {
+    if (isNumeric())
+        return search_keys(key_ptr(ptr, 0), head.fill_level, val, true);
+    int lo = 0;
+    int hi = head.fill_level;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        DBAttrType *key = key_at(ptr, mid);
+        if (val.operator<(*key))
+            hi = mid;
+        else
+            lo = mid + 1;
+        delete key;
+    }
+    return lo;
+}
 
-    int root_fill = 1;
-    char *new_root_fill_level = newroot_ptr + sizeof(bool) * 2;
-    // memcpy (*destination, *source, size);
-    memcpy(new_root_fill_level, &root_fill, sizeof(int));
+/**
+ * Erste Position, deren Schluessel groesser oder gleich val ist (binaere Suche)
+ */
+int DBMyIndex::lower_pos(char *ptr, const node_header &head, const DBAttrType &val) const {
+    if (isNumeric())
+        return search_keys(key_ptr(ptr, 0), head.fill_level, val, false);
+    int lo = 0;
+    int hi = head.fill_level;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        DBAttrType *key = key_at(ptr, mid);
+        if (key->operator<(val))
+            lo = mid + 1;
+        else
+            hi = mid;
+        delete key;
+    }
+    return lo;
+}
 
-    //Reload new Root
-    bacbStack.top().setModified();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
 
-    //Write new Root Block in Config Values
-    bacbStack.push(bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE));
-    char *swap_ptr = bacbStack.top().getDataPtr();
-    new_root_tid.write(swap_ptr);
+/**
+ * Fixt einen neuen Block, schreibt den Knotenkopf und legt ihn auf bacbStack.
+ * Der Aufrufer muss den Block wieder freigeben.
+ */
+TID DBMyIndex::initNode(bool isroot, bool isleaf, TID next) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    //Neuen Block für Knoten, bevorzugt aus der Freiliste
+    bacbStack.push(fix_free_block());
+    node_header head;
+    head.isroot = isroot;
+    head.isleaf = isleaf;
+    head.fill_level = 0;
+    head.next = next;
+    write_entries(bacbStack.top().getDataPtr(), head, NULL, 0);
     bacbStack.top().setModified();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
-    rootTID = new_root_tid;
 
-    bacbStack.push(bufMgr.fixBlock(file, new_root_tid.page, LOCK_EXCLUSIVE));
+    TID tid;
+    tid.page = bacbStack.top().getBlockNo();
+    tid.slot = 0;
+    return tid;
+}
 
+/**
+ * Fixt einen Block fuer einen neuen Knoten. Ist die Freiliste im Metablock nicht leer,
+ * wird deren erster Block wiederverwendet, sonst wird die Datei um einen Block verlaengert.
+ */
+DBBACB DBMyIndex::fix_free_block() {
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE);
+    char *meta_ptr = meta.getDataPtr() + sizeof(TID);
+    TID free_tid;
+    memcpy(&free_tid, meta_ptr, sizeof(TID));
+    if (free_tid.page == noBlockNo) {
+        unfix_block(meta);
+        return bufMgr.fixNewBlock(file);
+    }
 
-    //Return empty value container
-    return DBMyIndex::value_container();
+    DBBACB bacb = bufMgr.fixBlock(file, free_tid.page, LOCK_EXCLUSIVE);
+    // Nachfolger in der Freiliste wird neuer Listenkopf
+    memcpy(meta_ptr, bacb.getDataPtr(), sizeof(TID));
+    meta.setModified();
+    unfix_block(meta);
 
+    memset(bacb.getDataPtr(), 0, DBFileBlock::getBlockSize());
+    LOG4CXX_DEBUG(logger, "reuse block: " + TO_STR(free_tid.page));
+    return bacb;
 }
 
+/**
+ * Haengt den (gefixten) Block eines geloeschten Knotens vorne in die Freiliste ein
+ * und gibt ihn frei.
+ */
+void DBMyIndex::free_node(DBBACB &bacb) {
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE);
+    char *meta_ptr = meta.getDataPtr() + sizeof(TID);
+    memcpy(bacb.getDataPtr(), meta_ptr, sizeof(TID));
+    TID free_tid;
+    free_tid.page = bacb.getBlockNo();
+    free_tid.slot = 0;
+    free_tid.write(meta_ptr);
+    meta.setModified();
+    unfix_block(meta);
+
+    bacb.setModified();
+    unfix_block(bacb);
+    LOG4CXX_DEBUG(logger, "free block: " + TO_STR(free_tid.page));
+}
 
-DBMyIndex::value_container
-DBMyIndex::split_leaf(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr) {
-    value_container vc;
-    vc.tid.page = -1;
-
-    char *ptr = bacbStack.top().getDataPtr();
-    int current_block = bacbStack.top().getBlockNo();
-
-    char *leafptr = ptr;
 
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+/**
+ * Steigt von der Wurzel bis zu dem Blatt ab, in dem val liegt bzw. liegen muesste.
+ * LATCH_READ sperrt alle Knoten geteilt, LATCH_INSERT/LATCH_REMOVE versuchen es zuerst
+ * optimistisch (nur das Blatt exklusiv) und steigen exklusiv ab, wenn das Blatt nicht sicher ist.
+ * Danach liegt das Blatt oben auf bacbStack, darunter die exklusiv gefixten Vorgaenger bis
+ * zum ersten sicheren Knoten; path enthaelt fuer diese die Position des gewaehlten Kindes.
+ * Ist upper != NULL, erhaelt es eine Kopie der oberen Schranke des Blattes
+ * (kleinster Separator > val) oder NULL fuer das rechteste Blatt.
+ */
+void DBMyIndex::descend_to_leaf(const DBAttrType &val, latch_intent intent, stack<int> &path, DBAttrType **upper) {
+    //gezaehlter Baum: jede Aenderung passt alle Vorgaenger an
+    if (intent != LATCH_READ && counted->load()) {
+        crab_exclusive(val, intent, path, upper);
+        return;
     }
+    crab_shared(val, intent == LATCH_READ ? LOCK_SHARED : LOCK_EXCLUSIVE, path, upper);
+    if (intent == LATCH_READ || is_safe(intent))
+        return;
+
+    unfix_path();
+    path = stack<int>();
+    if (upper != NULL && *upper != NULL) {
+        delete *upper;
+        *upper = NULL;
+    }
+    crab_exclusive(val, intent, path, upper);
+}
 
-    bool isroot;
-    char *isrootptr = ptr;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    char *old_level_ptr = ptr;
-    ptr += sizeof(int);
+/**
+ * Merkt fuer descend_to_leaf den Separator an Position pos als obere Schranke.
+ * Separatoren tieferer Ebenen sind immer enger als die der Eltern.
+ */
+void DBMyIndex::track_upper(char *ptr, const node_header &head, int pos, DBAttrType **upper) const {
+    if (upper == NULL || pos == head.fill_level)
+        return;
+    if (*upper != NULL)
+        delete *upper;
+    *upper = key_at(ptr, pos);
+}
 
-    TID next;
-    next.read(ptr);
-    char *next_ptr = ptr;
-    ptr += sizeof(TID);
+/**
+ * Abstieg mit geteilten Sperren, jeder Elternknoten wird freigegeben, sobald das Kind
+ * gefixt ist. Bevorzugt wird der Abstieg ueber den Spiegel der inneren Knoten.
+ * Das Blatt wird in leafMode gefixt; dafuer wird es bei LOCK_EXCLUSIVE neu gefixt,
+ * waehrend der Elternknoten Splits und Merges des Blattes verhindert.
+ */
+void DBMyIndex::crab_shared(const DBAttrType &val, DBBCBLockMode leafMode, stack<int> &path, DBAttrType **upper) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    if (descend_mirror(val, leafMode, upper))
+        return;
 
+    bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED));
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
 
-    char *swap_ptr = ptr;
+    if (head.isleaf && leafMode == LOCK_EXCLUSIVE) {
+        //Wurzelblatt: ist es zwischen den beiden Fixes gespalten worden, wird es wie ein innerer Knoten behandelt
+        unfix_path();
+        bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_EXCLUSIVE));
+        ptr = bacbStack.top().getDataPtr();
+        read_head(ptr, head);
+    }
 
-    //new tid to add in parent
-    vc.tid.page = current_block;
+    while (head.isleaf == false) {
+        int pos = upper_pos(ptr, head, val);
+        track_upper(ptr, head, pos, upper);
+        TID child = child_at(ptr, head, pos);
+        path.push(pos);
+        bacbStack.push(bufMgr.fixBlock(file, child.page, LOCK_SHARED));
+        ptr = bacbStack.top().getDataPtr();
+        read_head(ptr, head);
+        if (head.isleaf && leafMode == LOCK_EXCLUSIVE) {
+            unfix_block(bacbStack.top());
+            bacbStack.pop();
+            bacbStack.push(bufMgr.fixBlock(file, child.page, LOCK_EXCLUSIVE));
+            ptr = bacbStack.top().getDataPtr();
+            read_head(ptr, head);
+        }
+        release_ancestors(path);
+    }
+}
 
-    //init new node with pointer
-    TID new_node_tid = initNode(false, isleaf, next);
-    char *newnode_ptr = bacbStack.top().getDataPtr();
-    char *new_values_ptr = newnode_ptr + sizeof(bool) * 2 + sizeof(int) + sizeof(TID);
+/**
+ * Anhaengen aufsteigender Schluessel: ist val nicht kleiner als der erste Schluessel des
+ * zuletzt gesehenen rechtesten Blattes (first_), gehoert val in dieses Blatt, das dann ohne
+ * Abstieg exklusiv gefixt wird. Gilt nur, solange sich die Struktur nicht geaendert hat und das
+ * Blatt den Eintrag ohne Split aufnimmt. Rueckgabe false: der Aufrufer muss absteigen.
+ */
+bool DBMyIndex::fix_right_leaf(const DBAttrType &val) {
+    op_cursor &cur = cursor();
+    if (counted->load() || cur.first_ == NULL || structureVersion->load() != cur.rightVersion
+        || val.operator<(*cur.first_))
+        return false;
+    cur.bacbStack.push(bufMgr.fixBlock(file, cur.rightLeaf, LOCK_EXCLUSIVE));
+    node_header head;
+    read_head(cur.bacbStack.top().getDataPtr(), head);
+    //ein Split gibt das Blatt vor dem Hochzaehlen der Strukturversion frei
+    if (head.isleaf && head.next.page == noBlockNo && structureVersion->load() == cur.rightVersion
+        && is_safe(LATCH_INSERT))
+        return true;
+    unfix_path();
+    return false;
+}
 
+/**
+ * Merkt sich das exklusiv gefixte Blatt auf bacbStack.top(), wenn es das rechteste ist
+ */
+void DBMyIndex::track_right_leaf() {
+    op_cursor &cur = cursor();
+    char *ptr = cur.bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+    unsigned long version = structureVersion->load();
+    if (head.next.page != noBlockNo || head.fill_level == 0)
+        return;
+    if (cur.first_ != NULL && cur.rightLeaf == cur.bacbStack.top().getBlockNo() && cur.rightVersion == version)
+        return;
+    if (cur.first_ != NULL)
+        delete cur.first_;
+    cur.first_ = key_at(ptr, 0);
+    cur.rightLeaf = cur.bacbStack.top().getBlockNo();
+    cur.rightVersion = version;
+}
 
-    //Keep small values in node
-    swap_ptr += (sizeof(val) + sizeof(TID)) * fill_level / 2;
+/**
+ * Position des Kindes im Spiegelknoten node, unter dem val liegt (wie upper_pos)
+ */
+int DBMyIndex::mirror_child(const mirror_node *node, const DBAttrType &val) const {
+    int lo = 0;
+    int hi = node->keys.size();
+    if (isNumeric() && hi > 0)
+        lo = hi = search_keys(&node->raw[0], hi, val, true);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (val.operator<(*node->keys[mid]))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
 
-    //read smallest value of new node to add in parent
-    vc.val = DBAttrType::read(swap_ptr, attrType);
+/**
+ * Laedt, was die Suche im Spiegelknoten node zuerst liest, vorab in den Cache:
+ * die Schluessel (numerisch: das ganze Feld, sonst die Zeiger und den mittleren Schluessel)
+ * und die Kinder
+ */
+void DBMyIndex::prefetch_node(const mirror_node *node) const {
+    if (isNumeric()) {
+        for (uint offset = 0; offset < node->raw.size(); offset += 64)
+            __builtin_prefetch(&node->raw[offset]);
+    } else if (node->keys.empty() == false) {
+        __builtin_prefetch(&node->keys[0]);
+        __builtin_prefetch(node->keys[node->keys.size() / 2]);
+    }
+    __builtin_prefetch(&node->blocks[0]);
+    if (node->leaf_children == false)
+        __builtin_prefetch(&node->children[0]);
+}
 
-    //copy bigger half in new node
-    for (int i = 0; i < (fill_level - fill_level / 2); i++) {
-        DBAttrType::read(swap_ptr, attrType)->write(new_values_ptr);
-        swap_ptr += sizeof(val);
-        new_values_ptr += sizeof(val);
-        TID tid;
-        tid.read(swap_ptr);
-        tid.write(new_values_ptr);
-        swap_ptr += sizeof(TID);
-        new_values_ptr += sizeof(TID);
+/**
+ * Abstieg ueber den Spiegel der inneren Ebenen: nur das Blatt wird (in leafMode) gefixt.
+ * Hat sich die Struktur des Baumes zwischenzeitlich geaendert (structureVersion), wird das
+ * Blatt wieder freigegeben. Rueckgabe false: der Aufrufer muss ueber die Seiten absteigen.
+ */
+bool DBMyIndex::descend_mirror(const DBAttrType &val, DBBCBLockMode leafMode, DBAttrType **upper) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    //Aenderungen anderer Instanzen oder Threads: Spiegel verwerfen, er wird beim Abstieg neu aufgebaut
+    op_cursor &cur = cursor();
+    unsigned long version = structureVersion->load();
+    if (version != cur.mirrorVersion) {
+        clear_mirror(cur);
+        cur.mirrorVersion = version;
     }
 
-    //Fill Levels
-    newnode_ptr += sizeof(bool) * 2;
-    int level = fill_level / 2;
-    memcpy(newnode_ptr, &level, sizeof(int));
-    level = fill_level - fill_level / 2;
-    memcpy(old_level_ptr, &level, sizeof(int));
+    mirror_node *node = swizzle(rootTID.page);
+    if (node == NULL)
+        return false;
+
+    BlockNo leaf = noBlockNo;
+    while (leaf == noBlockNo) {
+        int lo = mirror_child(node, val);
+        if (upper != NULL && lo < (int) node->keys.size()) {
+            if (*upper != NULL)
+                delete *upper;
+            *upper = read_key(&node->raw[lo * keySize()]);
+        }
 
-    //Write Next Pointer of smaller node
-    new_node_tid.write(next_ptr);
+        if (node->leaf_children) {
+            leaf = node->blocks[lo];
+        } else {
+            if (node->children[lo] == NULL || node->children[lo]->stale)
+                node->children[lo] = swizzle(node->blocks[lo]);
+            node = node->children[lo];
+            if (node == NULL)
+                break;
+        }
+    }
 
-    //Define Retun value, bigger leaf first value with smaller leaf TID (cause the tree uses smaller than for childs)
-    vc.isnew = true;
+    if (leaf != noBlockNo) {
+        bacbStack.push(bufMgr.fixBlock(file, leaf, leafMode));
+        node_header head;
+        read_head(bacbStack.top().getDataPtr(), head);
+        if (head.isleaf && structureVersion->load() == version)
+            return true;
+        unfix_path();
+    }
+    if (upper != NULL && *upper != NULL) {
+        delete *upper;
+        *upper = NULL;
+    }
+    return false;
+}
 
+/**
+ * Liefert den Spiegel des inneren Knotens block und laedt ihn dazu bei Bedarf (neu) aus
+ * seiner Seite. Die Zeiger auf bereits gespiegelte innere Kinder werden dabei eingesetzt
+ * (swizzling), noch nicht geladene Kinder bleiben NULL. Rueckgabe NULL, wenn block ein Blatt ist.
+ */
+DBMyIndex::mirror_node *DBMyIndex::swizzle(BlockNo block) {
+    map<BlockNo, mirror_node *> &mirror = cursor().mirror;
+    map<BlockNo, mirror_node *>::iterator it = mirror.find(block);
+    if (it != mirror.end() && it->second->stale == false)
+        return it->second;
+
+    DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_SHARED);
+    char *ptr = bacb.getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+    if (head.isleaf) {
+        unfix_block(bacb);
+        return NULL;
+    }
 
-    //write new value in leaf
-    if (vc.val->operator<(val)) {
-        insert_into_node(val, tid, new_node_tid, nullptr);
-        bacbStack.top().setModified();
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
+    mirror_node *node;
+    if (it != mirror.end()) {
+        node = it->second;
+        for (uint i = 0; i < node->keys.size(); ++i)
+            delete node->keys[i];
     } else {
-        bacbStack.top().setModified();
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
-        insert_into_node(val, tid, node, nullptr);
+        node = new mirror_node();
+        mirror[block] = node;
     }
-
-    new_node_tid.write(tid_ptr);
-    bacbStack.top().setModified();
-
-
-    return vc;
+    node->stale = false;
+    node->raw.assign(head.fill_level * keySize(), 0);
+    node->keys.clear();
+    node->blocks.clear();
+    node->children.clear();
+    for (int i = 0; i <= head.fill_level; ++i) {
+        if (i < head.fill_level) {
+            decode_key(ptr, i, &node->raw[i * keySize()]);
+            node->keys.push_back(read_key(&node->raw[i * keySize()]));
+        }
+        BlockNo child = child_at(ptr, head, i).page;
+        node->blocks.push_back(child);
+        map<BlockNo, mirror_node *>::iterator found = mirror.find(child);
+        node->children.push_back(found != mirror.end() ? found->second : NULL);
+    }
+    unfix_block(bacb);
+
+    //alle Kinder liegen auf derselben Ebene, eines genuegt
+    DBBACB child = bufMgr.fixBlock(file, node->blocks[0], LOCK_SHARED);
+    read_head(child.getDataPtr(), head);
+    unfix_block(child);
+    node->leaf_children = head.isleaf;
+    return node;
 }
 
-
 /**
- * Split the root for the first time
- * @param val
- * @param tid
- * @param node
- * @param parent_ptr
- * @param islast
- * @return
+ * Verwirft den ganzen Spiegel
  */
-DBMyIndex::value_container DBMyIndex::split_root_leaf(const DBAttrType &val, const TID &tid, TID node) {
-    /*
-     * new_node
-     * größere hälfte in node kopieren
-     * if root
-     *      new_root
-     *      alte_root is root false
-     *      new_root insert smalles value of new_node
-     *      in mgmt_varibalen root_tid = new_root_tid
-     *
-     * return node_tid, smallest_val_of_new_node
-     */
-
-    //ToDo: Evt in Split root überführen
+void DBMyIndex::clear_mirror(op_cursor &cur) {
+    for (map<BlockNo, mirror_node *>::iterator it = cur.mirror.begin(); it != cur.mirror.end(); ++it) {
+        for (uint i = 0; i < it->second->keys.size(); ++i)
+            delete it->second->keys[i];
+        delete it->second;
+    }
+    cur.mirror.clear();
+}
 
-    value_container vc;
-    vc.tid.page = -1;
+/**
+ * Muss gerufen werden, bevor ein geaenderter innerer Knoten (oder ein Elternknoten, dessen
+ * Kindbereiche sich verschieben) freigegeben wird: der Spiegel von block wird beim naechsten
+ * Besuch neu geladen, und die Strukturversion wird erhoeht, damit andere Instanzen ihren
+ * Spiegel verwerfen und laufende Abstiege ueber den Spiegel wiederholt werden.
+ */
+void DBMyIndex::inner_changed(BlockNo block) {
+    op_cursor &cur = cursor();
+    map<BlockNo, mirror_node *>::iterator it = cur.mirror.find(block);
+    if (it != cur.mirror.end())
+        it->second->stale = true;
+    if (structureVersion->fetch_add(1) == cur.mirrorVersion)
+        cur.mirrorVersion += 1;
+}
 
+/**
+ * Abstieg mit exklusiven Sperren (Latch Crabbing): nimmt ein Knoten die Aenderung sicher
+ * auf, werden alle seine Vorgaenger freigegeben.
+ */
+void DBMyIndex::crab_exclusive(const DBAttrType &val, latch_intent intent, stack<int> &path, DBAttrType **upper) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_EXCLUSIVE));
     char *ptr = bacbStack.top().getDataPtr();
-    char *leafptr = ptr;
-
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+    node_header head;
+    read_head(ptr, head);
+
+    while (true) {
+        if (is_safe(intent))
+            release_ancestors(path);
+        if (head.isleaf)
+            return;
+        int pos = upper_pos(ptr, head, val);
+        track_upper(ptr, head, pos, upper);
+        TID child = child_at(ptr, head, pos);
+        path.push(pos);
+        bacbStack.push(bufMgr.fixBlock(file, child.page, LOCK_EXCLUSIVE));
+        ptr = bacbStack.top().getDataPtr();
+        read_head(ptr, head);
     }
+}
 
-    bool isroot;
-    char *isrootptr = ptr;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    fill_level = leaf_size / 2;
-    memcpy(ptr, &fill_level, sizeof(int));
-    ptr += sizeof(int);
-
-    TID next;
-    next.read(ptr);
-    char *next_ptr = ptr;
-    ptr += sizeof(TID);
-
+/**
+ * Nimmt der Knoten auf bacbStack.top() die Aenderung auf, ohne dass sein Elternknoten
+ * angepasst werden muss? Einfuegen: ein weiterer Eintrag passt sicher auf die Seite
+ * (bei VARCHAR das Layout der Eintraege mit einem weiteren Schluessel voller Laenge,
+ * dazu das Wachstum einer Posting-Liste),
+ * Loeschen: der Knoten bleibt danach mindestens halb belegt (underfull()) bzw. die Wurzel behaelt
+ * einen Separator. Verkleinert das Loeschen bei VARCHAR zusaetzlich das Praefix, kann der Knoten
+ * doch unterbelegt werden; ohne gehaltenen Elternknoten bleibt er dann so (siehe rebalance()).
+ * Im gezaehlten Baum ist nur die Wurzel sicher, alle Vorgaenger aendern ihre Anzahlen.
+ */
+bool DBMyIndex::is_safe(latch_intent intent) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+
+    if (intent == LATCH_READ)
+        return true;
+    if (counted->load() && head.isroot == false)
+        return false;
+    if (intent == LATCH_REMOVE) {
+        if (head.isroot)
+            return head.isleaf || head.fill_level > 1;
+        //groesster Eintrag (Satz mit Slot) samt der laengsten Posting-Liste der Seite
+        uint removed = entrySize() + (isCompressed() ? sizeof(unsigned short) + 1 : 0);
+        uint longest = 0;
+        for (int i = 0; i < head.fill_level && head.isleaf && unique == false; ++i) {
+            TID ref = tid_at(ptr, i);
+            if (is_list(ref) && (ref.slot & listFlag) != 0)
+                longest = max(longest, ref.slot & listLengthMask);
+        }
+        uint used = used_bytes(ptr, head);
+        return used >= removed + longest + DBFileBlock::getBlockSize() / 2;
+    }
 
-    //Pointer auf die zu kopierenden werte
-    if (!isleaf) {
-        ptr += (sizeof(val) + sizeof(tid)) * leaf_size / 2 - 1 + sizeof(val);
-        memcpy(next_ptr, ptr, sizeof(TID));
-        ptr += sizeof(TID);
+    uint bytes;
+    if (isCompressed()) {
+        //die tatsaechlichen Eintraege und einer maximaler Laenge, der kein Praefix mit ihnen teilt
+        vector<char> buffer((head.fill_level + 1) * entrySize());
+        vector<char> lists;
+        read_entries(ptr, head, &buffer[0], &lists);
+        char *entry = &buffer[head.fill_level * entrySize()];
+        memset(entry, head.fill_level > 0 && buffer[0] == 1 ? 2 : 1, keySize());
+        TID tid;
+        tid.page = 0;
+        tid.slot = 0;
+        tid.write(entry + keySize());
+        uint prefix, width;
+        bytes = encode_layout(&buffer[0], head.fill_level + 1, head.isleaf, prefix, width);
     } else {
-        ptr += (sizeof(val) + sizeof(tid)) * leaf_size / 2;
+        bytes = node_bytes(head.fill_level + 1);
+        for (int i = 0; i < head.fill_level && head.isleaf && unique == false; ++i) {
+            TID ref = tid_at(ptr, i);
+            if (is_list(ref) && (ref.slot & listFlag) != 0)
+                bytes += ref.slot & listLengthMask;
+        }
     }
+    //aus einer einzelnen TID wird hoechstens eine Liste aus zwei TIDs (Anzahl + 4 Varints)
+    if (head.isleaf && unique == false)
+        bytes += 1 + 4 * 5;
+    return bytes <= DBFileBlock::getBlockSize();
+}
 
-
-    TID node_tid = initNode(false, isleaf, next);
-    char *newnode_ptr = bacbStack.top().getDataPtr();
-    if (isleaf) {
-        node_tid.write(next_ptr);
-
+/**
+ * Sucht val im Blatt auf bacbStack.top() und haengt die gefundenen TIDs
+ * (bei nicht eindeutigem Index die ganze Posting-Liste in Heap-Reihenfolge) an tids an
+ */
+void DBMyIndex::search_in_node(const DBAttrType &val, DBListTID &tids) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+
+    int pos = lower_pos(ptr, head, val);
+    if (pos < head.fill_level) {
+        DBAttrType *key = key_at(ptr, pos);
+        bool equal = key->operator==(val);
+        delete key;
+        if (equal) {
+            vector<TID> postings;
+            read_postings(tid_at(ptr, pos), ptr, postings);
+            tids.insert(tids.end(), postings.begin(), postings.end());
+        }
     }
-    newnode_ptr += sizeof(bool) * 2;
-    memcpy(newnode_ptr, &fill_level, sizeof(int));
-    newnode_ptr += sizeof(int) + sizeof(TID);
-
-    memmove(newnode_ptr, ptr, (sizeof(val) + sizeof(tid)) * (leaf_size - leaf_size / 2));
-    // if (!islast) {
-    vc.val = DBAttrType::read(newnode_ptr, attrType);
-    vc.tid = node_tid;
-    //} else {
-    //parent_ptr += sizeof(bool) * +sizeof(int) + sizeof(TID);
-    //node_tid.write(parent_ptr);
-    //}
-
-
-    vc.isnew = true;
-
-    if (vc.val->operator<(val)) {
-        insert_into_node(val, tid, node_tid, nullptr);
+}
 
-    } else {
+/**
+ * Fuegt (val, tid) in das Blatt auf bacbStack.top() ein.
+ * Rueckgabe true: das Blatt hatte Platz und ist weiterhin gefixt.
+ * Rueckgabe false: das Blatt wurde gespalten, der Split wurde nach oben
+ * weitergereicht und es ist kein Knoten mehr gefixt.
+ */
+bool DBMyIndex::insert_into_leaf(const DBAttrType &val, const TID &tid, stack<int> &path) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+
+    int pos = upper_pos(ptr, head, val);
+    bool exists = false;
+    if (pos > 0) {
+        DBAttrType *key = key_at(ptr, pos - 1);
+        exists = key->operator==(val);
+        delete key;
+    }
+    if (unique == true && exists)
+        throw DBIndexUniqueKeyException("key already exists in unique index");
+
+    //hinter den Eintraegen liegende Posting-Listen erlauben kein Verschieben in der Seite
+    if (unique == true && isCompressed() == false && head.fill_level < (int) entriesPerPage()) {
+        open_slot(ptr, head, pos);
+        val.write(key_ptr(ptr, pos));
+        tid.write(tid_ptr(ptr, pos));
+        head.fill_level += 1;
+        write_head(ptr, head);
         bacbStack.top().setModified();
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
-        insert_into_node(val, tid, node, nullptr);
-
+        add_counts(path, 1);
+        return true;
     }
 
+    //Knoten mit dem neuen Eintrag neu aufbauen, passt er nicht mehr auf die Seite wird gespalten
+    int count = exists ? head.fill_level : head.fill_level + 1;
+    vector<char> buffer(count * entrySize());
+    vector<char> lists;
+    char *buf = &buffer[0];
+    read_entries(ptr, head, buf, &lists);
+    if (exists) {
+        //tid in die Posting-Liste des vorhandenen Schluessels einsortieren
+        char *ref_ptr = buf + (pos - 1) * entrySize() + keySize();
+        TID ref;
+        ref.read(ref_ptr);
+        vector<TID> postings;
+        read_postings(ref, lists.empty() ? NULL : &lists[0], postings);
+        vector<TID>::iterator it = lower_bound(postings.begin(), postings.end(), tid, less_tid);
+        if (it != postings.end() && it->page == tid.page && it->slot == tid.slot)
+            throw DBIndexException("tid already exists for key");
+        postings.insert(it, tid);
+        free_postings(ref);
+        ref = write_postings(postings, lists, (ref.slot & overflowFlag) != 0);
+        ref.write(ref_ptr);
+    } else {
+        char *entry = buf + pos * entrySize();
+        memmove(entry + entrySize(), entry, (head.fill_level - pos) * entrySize());
+        memset(entry, 0, keySize());
+        val.write(entry);
+        tid.write(entry + keySize());
+    }
 
-    if (isroot) {
-        TID newroot = initNode(true, false, node_tid);
-        bool f = false;
-        memcpy(isrootptr, &f, sizeof(bool));
-        bacbStack.top().setModified();
-        bufMgr.unfixBlock(bacbStack.top());
-        unfixBACBs(false);
-        bacbStack.push(bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE));
-        char *swap_ptr = bacbStack.top().getDataPtr();
-        newroot.write(swap_ptr);
+    if (write_entries(ptr, head, buf, count, &lists)) {
         bacbStack.top().setModified();
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
-        rootTID = newroot;
-        bacbStack.push(bufMgr.fixBlock(file, newroot.page, LOCK_EXCLUSIVE));
-        vc.isnew = false;
-
+        add_counts(path, 1);
+        return true;
     }
 
-    return vc;
+    //neuer groesster Schluessel im rechtesten Blatt: weitere Anhaenge folgen vermutlich
+    bool append = exists == false && pos == head.fill_level && head.next.page == noBlockNo;
+    insert_into_parent(split_leaf(buf, count, lists, append), path);
+    return false;
 }
 
-DBMyIndex::value_container
-DBMyIndex::insert_into_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr) {
-    struct value_container vc;
-    vc.tid.page - 1;
+/**
+ * Reicht einen Split nach oben weiter: der gespaltene Knoten liegt auf bacbStack.top(),
+ * vc enthaelt den Separator und die TID des neuen rechten Knotens.
+ * Der Abstieg hat alle Vorgaenger bis zum ersten sicheren Knoten exklusiv gefixt,
+ * spaetestens dort endet der Split. Am Ende ist kein Knoten mehr gefixt.
+ */
+void DBMyIndex::insert_into_parent(value_container vc, stack<int> &path) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    while (vc.isnew) {
+        node_header split_head;
+        read_head(bacbStack.top().getDataPtr(), split_head);
+        if (split_head.isroot) {
+            split_root(vc);
+            break;
+        }
+        //Version erhoehen, solange der gespaltene Knoten noch gefixt ist: sonst nimmt
+        //descend_mirror das linke Blatt mit der alten Version an und verpasst die neue rechte Haelfte
+        DBBACB split = bacbStack.top();
+        bacbStack.pop();
+        assert(bacbStack.empty() == false);
+        inner_changed(bacbStack.top().getBlockNo());
+        unfix_block(split);
 
-    if (bacbStack.top().getLockMode() != LOCK_EXCLUSIVE)
-        bufMgr.upgradeToExclusive(bacbStack.top());
+        int pos = path.top();
+        path.pop();
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        if (counted->load()) {
+            TID left = child_at(ptr, head, pos);
+            left.slot = vc.leftCount;
+            set_child(ptr, head, pos, left);
+        }
 
+        if (isCompressed() == false && head.fill_level < (int) entriesPerPage()) {
+            insert_into_node(ptr, head, pos, *vc.val, vc.tid);
+            bacbStack.top().setModified();
+            delete vc.val;
+            vc.isnew = false;
+            continue;
+        }
 
-    char *ptr = bacbStack.top().getDataPtr();
+        int count = head.fill_level + 1;
+        vector<char> buffer(count * entrySize());
+        TID last;
+        add_separator(ptr, head, pos, *vc.val, vc.tid, &buffer[0], last);
+        delete vc.val;
 
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+        head.next = last;
+        if (write_entries(ptr, head, &buffer[0], count)) {
+            bacbStack.top().setModified();
+            vc.isnew = false;
+        } else {
+            vc = split_node(&buffer[0], count, last, vc.append && pos == head.fill_level);
+        }
     }
+    //der Knoten, der den Split aufgenommen hat, hat einen Eintrag mehr
+    add_counts(path, 1);
+    unfix_path();
+}
 
-    int page = bacbStack.top().getBlockNo();
-
-    bool isroot;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    int fill_level;
-    char *fill_level_ptr = ptr;
-    memcpy(&fill_level, ptr, sizeof(int));
-
-    ptr += sizeof(int);
-
-    TID nextNode;
-    char * next_ptr = ptr;
-    memcpy(&nextNode, ptr, sizeof(TID));
-    ptr += sizeof(TID);
-
-    // memcpy (*destination, *source, size);
-
-
-
+/**
+ * Fuegt in einen inneren Knoten mit freiem Platz den Separator sep ein.
+ * Das bisherige Kind pos behaelt die Schluessel < sep, das neue Kind right
+ * wird rechts daneben eingehaengt.
+ */
+void DBMyIndex::insert_into_node(char *ptr, node_header &head, int pos, const DBAttrType &sep, const TID &right) {
+    TID left = child_at(ptr, head, pos);
+    open_slot(ptr, head, pos);
+    sep.write(key_ptr(ptr, pos));
+    left.write(tid_ptr(ptr, pos));
+    head.fill_level += 1;
+    set_child(ptr, head, pos + 1, right);
+    write_head(ptr, head);
+}
 
-    uint *cnt = (uint *) ptr;
 
-    DBAttrType *searchval;
-    char *insert_position, *end_position;
+/**
+ * Kopiert die Eintraege eines inneren Knotens nach buf und fuegt dabei an Position pos
+ * den Separator sep ein (wie insert_into_node). last erhaelt das rechteste Kind.
+ */
+void DBMyIndex::add_separator(char *ptr, const node_header &head, int pos, const DBAttrType &sep,
+                              const TID &right, char *buf, TID &last) const {
+    TID left = child_at(ptr, head, pos);
+    read_entries(ptr, head, buf);
+    char *entry = buf + pos * entrySize();
+    memmove(entry + entrySize(), entry, (head.fill_level - pos) * entrySize());
+    memset(entry, 0, keySize());
+    sep.write(entry);
+    left.write(entry + keySize());
+
+    last = head.next;
+    if (pos + 1 < head.fill_level + 1)
+        right.write(buf + (pos + 1) * entrySize() + keySize());
+    else
+        last = right;
+}
 
+/**
+ * Entfernt den Eintrag pos aus einem Knoten. Der Kopf muss danach vom Aufrufer
+ * geschrieben werden.
+ */
+void DBMyIndex::remove_from_node(char *ptr, node_header &head, int pos) {
+    if (isCompressed() == false) {
+        memmove(key_ptr(ptr, pos), key_ptr(ptr, pos + 1), (head.fill_level - pos - 1) * keySize());
+        memmove(tid_ptr(ptr, pos), tid_ptr(ptr, pos + 1), (head.fill_level - pos - 1) * sizeof(TID));
+        head.fill_level -= 1;
+        return;
+    }
+    uint prefix, width, length;
+    read_keyhead(ptr, prefix, width);
+    char *entry = entry_ptr(ptr, pos, length);
+    if (width != slottedWidth) {
+        uint size = width + sizeof(TID);
+        memmove(entry, entry + size, (head.fill_level - pos - 1) * size);
+        head.fill_level -= 1;
+        return;
+    }
 
-    bool found = false;
-    bool reached_end = false;
+    //Satz entfernen und die Offsets der folgenden Saetze im Slotverzeichnis nachziehen
+    char *slots = ptr + sizeOfHead + sizeOfKeyHead + prefix;
+    char *record = entry - 1;
+    uint size = 1 + length + sizeof(TID);
+    memmove(record, record + size, entries_end(ptr, head.fill_level) - record - size);
+    for (int i = pos + 1; i < head.fill_level; ++i) {
+        unsigned short offset;
+        memcpy(&offset, slots + i * sizeof(unsigned short), sizeof(unsigned short));
+        offset -= size;
+        memcpy(slots + (i - 1) * sizeof(unsigned short), &offset, sizeof(unsigned short));
+    }
+    head.fill_level -= 1;
+}
 
-    if (fill_level < leaf_size) {
-        for (int i = 0; i < leaf_size; ++i) {
-            if (*cnt == 0 || i == fill_level) {
-                reached_end = true;
-                end_position = ptr;
-                break;
-            } else {
-                searchval = DBAttrType::read(ptr, attrType);
-                if (val.operator<(*searchval) && !found) {
-                    found = true;
-                    insert_position = ptr;
-                }
-            }
-            ptr += (sizeof(val) + sizeof(tid));
-            cnt = (uint *) ptr;
+/**
+ * Loescht im Blatt auf bacbStack.top() alle Eintraege mit Schluessel val,
+ * deren TID in tids enthalten ist.
+ * Rueckgabe: Anzahl der geloeschten TIDs.
+ */
+uint DBMyIndex::remove_from_leaf(const DBAttrType &val, const DBListTID &tids) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+    if (unique == false)
+        return remove_postings(ptr, head, val, tids);
+
+    uint removed = 0;
+    int pos = lower_pos(ptr, head, val);
+    while (pos < head.fill_level) {
+        DBAttrType *key = key_at(ptr, pos);
+        bool equal = key->operator==(val);
+        delete key;
+        if (equal == false)
+            break;
 
+        TID tid = tid_at(ptr, pos);
+        bool match = false;
+        for (DBListTID::const_iterator it = tids.begin(); it != tids.end() && match == false; ++it) {
+            match = it->page == tid.page && it->slot == tid.slot;
+        }
+        if (match) {
+            remove_from_node(ptr, head, pos);
+            removed += 1;
+        } else {
+            ++pos;
         }
     }
-    if (found) {
-        do {
-            char *swap_pointer = end_position;
-            end_position -= sizeof(tid);
-            TID tid;
-            tid.read(end_position);
-            tid.write(swap_pointer + sizeof(val));
-            end_position -= sizeof(val);
-            DBAttrType::read(end_position, attrType)->write(swap_pointer);
-
-        } while (end_position != insert_position);
 
-    }
-    if (reached_end) {
-        val.write(end_position);
-        end_position += sizeof(val);
-        tid.write(end_position);
-        fill_level += 1;
-        memcpy(fill_level_ptr, &fill_level, sizeof(int));
+    if (removed > 0) {
+        write_head(ptr, head);
         bacbStack.top().setModified();
     } else {
-        if (!isroot) {
-            vc = split_leaf(val, tid, node, tid_ptr);
-        } else if (isroot && !isleaf) {
-            vc = split_root(val, tid, node);
-        } else {
-            vc = split_root_leaf(val, tid, node);
-            if (isroot) {
-                char *ptr = bacbStack.top().getDataPtr();
-                int root_level = 1;
-                ptr += sizeof(bool) * 2;
-                memcpy(ptr, &root_level, sizeof(int));
-                ptr += sizeof(int) + sizeof(TID);
-
-                vc.val->write(ptr);
-                ptr += sizeof(val);
-                vc.tid.page = page;
-                vc.tid.write(ptr);
-                bacbStack.top().setModified();
-                vc.isnew = false;
-
+        LOG4CXX_DEBUG(logger, "no matching entry for val:\n" + val.toString("\t"));
+    }
+    return removed;
+}
 
-            }
+/**
+ * Entfernt im Blatt ptr die TIDs aus tids aus der Posting-Liste von val.
+ * Wird die Liste leer, wird der Eintrag geloescht. Eine Liste in Ueberlaufbloecken
+ * bleibt dort, bis sie nur noch eine TID enthaelt; so wird das Blatt nie voller.
+ * Rueckgabe: Anzahl der entfernten TIDs.
+ */
+uint DBMyIndex::remove_postings(char *ptr, node_header &head, const DBAttrType &val, const DBListTID &tids) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    int pos = lower_pos(ptr, head, val);
+    bool found = false;
+    if (pos < head.fill_level) {
+        DBAttrType *key = key_at(ptr, pos);
+        found = key->operator==(val);
+        delete key;
+    }
+    if (found == false) {
+        LOG4CXX_DEBUG(logger, "no matching entry for val:\n" + val.toString("\t"));
+        return 0;
+    }
 
+    TID ref = tid_at(ptr, pos);
+    vector<TID> postings;
+    read_postings(ref, ptr, postings);
+    vector<TID> remaining;
+    for (uint i = 0; i < postings.size(); ++i) {
+        bool match = false;
+        for (DBListTID::const_iterator it = tids.begin(); it != tids.end() && match == false; ++it) {
+            match = it->page == postings[i].page && it->slot == postings[i].slot;
         }
+        if (match == false)
+            remaining.push_back(postings[i]);
     }
-    // memcpy (*destination, *source, size);
-
-    int page_swap = bacbStack.top().getBlockNo();
-    bufMgr.unfixBlock(bacbStack.top());
-    bacbStack.pop();
-    if (isroot) {
-        bacbStack.push(bufMgr.fixBlock(file, page_swap, LOCK_EXCLUSIVE));
+    if (remaining.size() == postings.size()) {
+        LOG4CXX_DEBUG(logger, "no matching tid for val:\n" + val.toString("\t"));
+        return 0;
     }
-    return vc;
-
 
+    vector<char> buffer(head.fill_level * entrySize());
+    vector<char> lists;
+    char *buf = &buffer[0];
+    read_entries(ptr, head, buf, &lists);
+    int count = head.fill_level;
+    char *entry = buf + pos * entrySize();
+    free_postings(ref);
+    if (remaining.empty()) {
+        memmove(entry, entry + entrySize(), (count - pos - 1) * entrySize());
+        count -= 1;
+    } else {
+        ref = write_postings(remaining, lists, (ref.slot & overflowFlag) != 0);
+        ref.write(entry + keySize());
+    }
 
-    /*     * einfügen von wert in leaf
-     * if overflow
-     *      new_leaf_address = splitnode
-     *      entscheidung in welches leaf eingefügt werden soll
-     *              insert_in_node
-     * return new_leaf_address;
-     *
-     */
-
+    if (write_entries(ptr, head, buf, count, &lists) == false)
+        throw DBIndexException("leaf overflow while removing from posting list");
+    bacbStack.top().setModified();
+    return postings.size() - remaining.size();
 }
 
-DBMyIndex::value_container
-DBMyIndex::search_in_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr, bool islast) {
-    /* in node nach wert suchen
-     *      if leaf
-     *          new_leaf_address  = einfügen_in_node
-     *      if node
-     *          search_in_node
-     * if new_leaf_address
-     *      insert_in_node
-     */
+/**
+ * Gleicht nach dem Loeschen unterbelegte Knoten entlang path aus.
+ * Der zuletzt geaenderte Knoten liegt auf bacbStack.top(). Ist weniger als die Haelfte
+ * seiner Seite belegt (underfull()), leiht er sich einen Eintrag vom mehr als halb vollen Nachbarn
+ * (redistribute) oder wird mit ihm verschmolzen (merge); ein Merge entfernt einen
+ * Separator im Elternknoten, der dann seinerseits geprueft wird.
+ * Eine innere Wurzel ohne Separator wird durch ihr einziges Kind ersetzt.
+ */
+void DBMyIndex::rebalance(stack<int> &path) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    while (true) {
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
 
+        if (head.isroot) {
+            if (head.isleaf == false && head.fill_level == 0)
+                collapse_root(head.next);
+            return;
+        }
+        //path leer: is_safe() hat die Vorgaenger freigegeben
+        if (underfull(ptr, head) == false || path.empty())
+            return;
 
+        DBBACB node = bacbStack.top();
+        bacbStack.pop();
+        int pos = path.top();
+        path.pop();
+
+        char *parent_ptr = bacbStack.top().getDataPtr();
+        node_header parent_head;
+        read_head(parent_ptr, parent_head);
+
+        //bevorzugt der linke Nachbar, fuer das linkeste Kind der rechte
+        bool from_left = pos > 0;
+        int sep = from_left ? pos - 1 : pos;
+        TID sibling_tid = child_at(parent_ptr, parent_head, from_left ? pos - 1 : pos + 1);
+        DBBACB sibling = bufMgr.fixBlock(file, sibling_tid.page, LOCK_EXCLUSIVE);
+        DBBACB &left = from_left ? sibling : node;
+        DBBACB &right = from_left ? node : sibling;
+
+        node_header sibling_head;
+        read_head(sibling.getDataPtr(), sibling_head);
+        inner_changed(bacbStack.top().getBlockNo());
+        inner_changed(node.getBlockNo());
+        inner_changed(sibling.getBlockNo());
+
+        if (used_bytes(sibling.getDataPtr(), sibling_head) > DBFileBlock::getBlockSize() / 2) {
+            //passt der neue Separator nicht in den komprimierten Elternknoten
+            //oder eine Haelfte nicht auf ihre Seite, bleibt der Knoten unterbelegt
+            if (redistribute(left, right, parent_ptr, parent_head, sep, from_left))
+                bacbStack.top().setModified();
+            unfix_block(sibling);
+            unfix_block(node);
+            return;
+        }
 
-    if (bacbStack.top().getLockMode() != LOCK_EXCLUSIVE)
-        bufMgr.upgradeToExclusive(bacbStack.top());
+        //passen die Posting-Listen beider Blaetter nicht auf eine Seite, bleibt der Knoten unterbelegt
+        if (merge(left, right, parent_ptr, sep) == false) {
+            unfix_block(sibling);
+            unfix_block(node);
+            return;
+        }
 
-    char *ptr = bacbStack.top().getDataPtr();
+        TID left_tid;
+        left_tid.page = left.getBlockNo();
+        left_tid.slot = counted->load() ? node_count(left.getDataPtr()) : 0;
+        remove_from_node(parent_ptr, parent_head, sep);
+        set_child(parent_ptr, parent_head, sep, left_tid);
+        write_head(parent_ptr, parent_head);
+        bacbStack.top().setModified();
 
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+        unfix_block(left);
+        free_node(right);
     }
+}
 
+/**
+ * Kopiert die Eintraege von left, bei inneren Knoten den Separator sep aus dem
+ * Elternknoten mit dem rechtesten Kind von left, und die Eintraege von right
+ * hintereinander nach buf, Posting-Listen beider Blaetter nach lists.
+ * Rueckgabe: Anzahl der Eintraege vor denen von right.
+ */
+int DBMyIndex::concat_entries(char *left_ptr, char *right_ptr, char *parent_ptr, int sep, char *buf,
+                              vector<char> &lists) const {
+    node_header left_head, right_head;
+    read_head(left_ptr, left_head);
+    read_head(right_ptr, right_head);
+
+    read_entries(left_ptr, left_head, buf, &lists);
+    int count = left_head.fill_level;
+    if (left_head.isleaf == false) {
+        decode_key(parent_ptr, sep, buf + count * entrySize());
+        left_head.next.write(buf + count * entrySize() + keySize());
+        count += 1;
+    }
+    read_entries(right_ptr, right_head, buf + count * entrySize(), &lists);
+    return count;
+}
 
-    char *leafptr = ptr;
-    bool isroot;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    ptr += sizeof(int);
+/**
+ * Verschiebt einen Eintrag zwischen zwei benachbarten Knoten und passt den
+ * Separator sep im Elternknoten an. from_left: left gibt an right ab, sonst umgekehrt.
+ * Bei inneren Knoten wird dabei ueber den Elternknoten rotiert.
+ * Rueckgabe false, wenn der neue Separator nicht in den Elternknoten oder eine
+ * Haelfte nicht auf ihre Seite passt.
+ */
+bool DBMyIndex::redistribute(DBBACB &left, DBBACB &right, char *parent_ptr, node_header &parent_head,
+                             int sep, bool from_left) {
+    char *left_ptr = left.getDataPtr();
+    char *right_ptr = right.getDataPtr();
+    node_header left_head, right_head;
+    read_head(left_ptr, left_head);
+    read_head(right_ptr, right_head);
+
+    vector<char> buffer((left_head.fill_level + right_head.fill_level + 1) * entrySize());
+    vector<char> lists;
+    char *buf = &buffer[0];
+    int count = concat_entries(left_ptr, right_ptr, parent_ptr, sep, buf, lists) + right_head.fill_level;
+
+    //neue Anzahl Eintraege links
+    int split = from_left ? left_head.fill_level - 1 : left_head.fill_level + 1;
+    vector<char> sep_key(keySize());
+    int right_begin = split;
+    if (left_head.isleaf) {
+        shortest_separator(buf + (split - 1) * entrySize(), buf + split * entrySize(), &sep_key[0]);
+    } else {
+        //der Eintrag an der Teilungsposition wandert nach oben, sein Kind wird rechtestes Kind links
+        memcpy(&sep_key[0], buf + split * entrySize(), keySize());
+        memcpy(&left_head.next, buf + split * entrySize() + keySize(), sizeof(TID));
+        right_begin = split + 1;
+    }
 
-    TID nextNode;
-    char *next_ptr = ptr;
-    nextNode.read(ptr);
-    ptr += sizeof(TID);
+    if (fits(buf, split, left_head.isleaf) == false
+        || fits(buf + right_begin * entrySize(), count - right_begin, left_head.isleaf) == false)
+        return false;
+    if (replace_key(parent_ptr, parent_head, sep, &sep_key[0]) == false)
+        return false;
+
+    //beide Haelften passen (siehe fits() oben)
+    if (write_entries(left_ptr, left_head, buf, split, &lists) == false
+        || write_entries(right_ptr, right_head, buf + right_begin * entrySize(), count - right_begin, &lists) == false)
+        throw DBIndexException("node overflow while redistributing");
+    left.setModified();
+    right.setModified();
+    if (counted->load()) {
+        TID child;
+        child.page = left.getBlockNo();
+        child.slot = node_count(left_ptr);
+        set_child(parent_ptr, parent_head, sep, child);
+        child.page = right.getBlockNo();
+        child.slot = node_count(right_ptr);
+        set_child(parent_ptr, parent_head, sep + 1, child);
+        write_head(parent_ptr, parent_head);
+    }
+    return true;
+}
 
-    // memcpy (*destination, *source, size);
+/**
+ * Haengt alle Eintraege von right an left an. Bei inneren Knoten wird der
+ * Separator sep aus dem Elternknoten mit dem bisherigen rechtesten Kind von left
+ * dazwischen eingefuegt. Den Elternknoten passt der Aufrufer an.
+ * Rueckgabe false, wenn der Inhalt nicht auf eine Seite passt; dann bleiben beide unveraendert.
+ */
+bool DBMyIndex::merge(DBBACB &left, DBBACB &right, char *parent_ptr, int sep) {
+    char *left_ptr = left.getDataPtr();
+    char *right_ptr = right.getDataPtr();
+    node_header left_head, right_head;
+    read_head(left_ptr, left_head);
+    read_head(right_ptr, right_head);
+
+    vector<char> buffer((left_head.fill_level + right_head.fill_level + 1) * entrySize());
+    vector<char> lists;
+    int count = concat_entries(left_ptr, right_ptr, parent_ptr, sep, &buffer[0], lists) + right_head.fill_level;
+
+    //Blattkette bzw. rechtestes Kind uebernehmen
+    left_head.next = right_head.next;
+    if (write_entries(left_ptr, left_head, &buffer[0], count, &lists) == false)
+        return false;
+    left.setModified();
+    return true;
+}
 
-    uint *cnt = (uint *) ptr;
+/**
+ * Ersetzt die leere innere Wurzel durch ihr einziges Kind: dessen Inhalt wird in den
+ * Wurzelblock kopiert und der Block des Kindes freigegeben; der Baum wird um eine Ebene flacher.
+ */
+void DBMyIndex::collapse_root(const TID &child) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    DBBACB child_bacb = bufMgr.fixBlock(file, child.page, LOCK_EXCLUSIVE);
+    inner_changed(rootTID.page);
+    inner_changed(child.page);
+    memcpy(ptr, child_bacb.getDataPtr(), DBFileBlock::getBlockSize());
+
+    node_header head;
+    read_head(ptr, head);
+    head.isroot = true;
+    write_head(ptr, head);
+    bacbStack.top().setModified();
 
-    DBAttrType *searchval;
-    char *insert_position, *end_position;
+    free_node(child_bacb);
+}
 
 
-    bool found = false;
-    bool reached_end = false;
-    value_container vc;
-    vc.tid.page = -1;
-
-    for (int i = 0; i < leaf_size; ++i) {
-        if (*cnt == 0 || i == fill_level) {
-            if (isleaf) {
-                insert_position = ptr;
-                vc = insert_into_node(val, tid, node, ptr + sizeof(val));
-                reached_end = true;
-                found = true;
-            } else {
-                bacbStack.push(bufMgr.fixBlock(file, nextNode.page, LOCK_EXCLUSIVE));
-                vc = search_in_node(val, tid, nextNode, next_ptr, true);
-                found = true;
-            }
-            break;
-        } else {
-            searchval = DBAttrType::read(ptr, attrType);
-            if (val.operator<(*searchval) && !found) {
-                found = true;
-                insert_position = ptr;
-                if (isleaf) {
-                    vc = insert_into_node(val, tid, node, tid_ptr);
-                    break;
-                } else {
-                    ptr += sizeof(val);
-                    TID found_node;
-                    found_node.read(ptr);
-                    bacbStack.push(bufMgr.fixBlock(file, found_node.page, LOCK_EXCLUSIVE));
-                    vc = search_in_node(val, tid, found_node, ptr, false);
-                    break;
-                }
-            }
-        }
-        ptr += (sizeof(val) + sizeof(tid));
-        cnt = (uint *) ptr;
+/**
+ * Anzahl der Tupel-TIDs eines Blatteintrags mit TID ref, base ist die Seite des Blattes
+ */
+uint DBMyIndex::posting_count(const TID &ref, const char *base) {
+    if (is_list(ref) == false)
+        return 1;
+    if ((ref.slot & overflowFlag) == 0) {
+        const char *ptr = base + ref.page;
+        return get_varint(ptr);
     }
+    //die Anzahl steht am Anfang des ersten Ueberlaufblocks
+    DBBACB overflow = bufMgr.fixBlock(file, ref.page, LOCK_SHARED);
+    const char *ptr = overflow.getDataPtr() + sizeof(TID) + sizeof(uint);
+    uint count = get_varint(ptr);
+    unfix_block(overflow);
+    return count;
+}
 
-    if (isleaf && !found) {
-        //If leaf is full we call the split method, the parent pointer is the pointer which was pointing to leaf
-        if (isroot) {
-            vc = insert_into_node(val, tid, node, nullptr);
-        } else {
-            vc = split_leaf(val, tid, node, tid_ptr);
-        }
-
-    } else if (!isleaf && !found) {
-        bacbStack.push(bufMgr.fixBlock(file, nextNode.page, LOCK_EXCLUSIVE));
-        vc = search_in_node(val, tid, nextNode, next_ptr, true);
+/**
+ * Anzahl der Tupel-TIDs unter dem Knoten ptr: im Blatt gezaehlt, im inneren Knoten
+ * die Summe der Anzahlen seiner Kinder (gezaehlter Baum)
+ */
+uint DBMyIndex::node_count(char *ptr) {
+    node_header head;
+    read_head(ptr, head);
+    uint count = 0;
+    if (head.isleaf) {
+        for (int i = 0; i < head.fill_level; ++i)
+            count += posting_count(tid_at(ptr, i), ptr);
+    } else {
+        for (int i = 0; i <= head.fill_level; ++i)
+            count += child_at(ptr, head, i).slot;
     }
+    return count;
+}
 
-    if (vc.isnew) {
-        if (bacbStack.empty()) bacbStack.push(bufMgr.fixBlock(file, node.page, LOCK_EXCLUSIVE));
-        else if (bacbStack.top().getLockMode() != LOCK_EXCLUSIVE) {
-            int swap_block = bacbStack.top().getBlockNo();
-            bufMgr.unfixBlock(bacbStack.top());
-            bacbStack.pop();
-            bacbStack.push(bufMgr.fixBlock(file, swap_block, LOCK_EXCLUSIVE));
-        }
-        value_container vc_new;
-        vc_new = insert_into_node(*vc.val, vc.tid, node, tid_ptr);
-        vc = vc_new;
+/**
+ * Gezaehlter Baum: passt die Anzahlen der Vorgaenger des Knotens auf bacbStack.top() um delta an.
+ * Die Vorgaenger liegen exklusiv gefixt darunter, path enthaelt die Positionen der Kinder.
+ */
+void DBMyIndex::add_counts(stack<int> path, int delta) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    if (counted->load() == false || delta == 0)
+        return;
+    assert(bacbStack.size() > path.size());
+    vector<DBBACB> nodes;
+    while (path.empty() == false) {
+        nodes.push_back(bacbStack.top());
+        bacbStack.pop();
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        TID child = child_at(ptr, head, path.top());
+        child.slot += delta;
+        set_child(ptr, head, path.top(), child);
+        write_head(ptr, head);
+        bacbStack.top().setModified();
+        path.pop();
     }
+    while (nodes.empty() == false) {
+        bacbStack.push(nodes.back());
+        nodes.pop_back();
+    }
+}
 
-
-    if (!bacbStack.empty()) {
-        bufMgr.unfixBlock(bacbStack.top());
-        if (bacbStack.top().getBlockNo() != rootTID.page) {
-            bacbStack.pop();
-
+/**
+ * Setzt die Anzahlen aller inneren Knoten unter block neu (siehe setCounted()).
+ * Rueckgabe: Anzahl der Tupel-TIDs im Teilbaum.
+ */
+uint DBMyIndex::recount(BlockNo block) {
+    DBBACB bacb = bufMgr.fixBlock(file, block, LOCK_EXCLUSIVE);
+    uint count = 0;
+    try {
+        char *ptr = bacb.getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        if (head.isleaf) {
+            count = node_count(ptr);
+        } else {
+            for (int i = 0; i <= head.fill_level; ++i) {
+                TID child = child_at(ptr, head, i);
+                child.slot = recount(child.page);
+                set_child(ptr, head, i, child);
+                count += child.slot;
+                log_progress();
+            }
+            write_head(ptr, head);
+            bacb.setModified();
         }
+    } catch (DBException &e) {
+        unfix_block(bacb);
+        throw;
     }
-
-
-    tree = printTree();
-    return vc;
+    unfix_block(bacb);
+    return count;
 }
 
-string DBMyIndex::printTree() {
-    stringstream ss;
-    ss << "[DBMyIndex]" << endl;
-    for (int i = 0; i < bufMgr.getBlockCnt(file); i++) {
-        bacbStack.push(bufMgr.fixBlock(file, i, LOCK_SHARED));
-        ss << printNode();
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
+/**
+ * Gezaehlter Baum: Anzahl der Tupel-TIDs mit Schluessel < val (orEqual: <= val), val == NULL: alle.
+ * Abstieg mit geteilten Sperren; summiert werden die Anzahlen der Kinder links vom Pfad,
+ * im Blatt die der Eintraege vor der Position von val.
+ */
+uint DBMyIndex::count_below(const DBAttrType *val, bool orEqual) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    uint count = 0;
+    stack<int> path;
+    try {
+        bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED));
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        while (true) {
+            int pos = head.fill_level;
+            if (val != NULL)
+                pos = orEqual ? upper_pos(ptr, head, *val) : lower_pos(ptr, head, *val);
+            if (head.isleaf) {
+                for (int i = 0; i < pos; ++i)
+                    count += posting_count(tid_at(ptr, i), ptr);
+                break;
+            }
+            for (int i = 0; i < pos; ++i)
+                count += child_at(ptr, head, i).slot;
+            TID child = child_at(ptr, head, pos);
+            if (val == NULL) {
+                count += child.slot;
+                break;
+            }
+            bacbStack.push(bufMgr.fixBlock(file, child.page, LOCK_SHARED));
+            ptr = bacbStack.top().getDataPtr();
+            read_head(ptr, head);
+            release_ancestors(path);
+        }
+    } catch (DBException &e) {
+        unfix_path();
+        throw;
     }
-    return ss.str();
-
+    unfix_path();
+    return count;
 }
 
-string DBMyIndex::printNode() {
-    stringstream ss;
-    ss << "Node:" << endl;
-
 
+/** Split leaf
+ * Die count Eintraege aus buf (Inhalt des vollen Blattes auf bacbStack.top() inklusive
+ * des neuen Eintrags) werden auf das Blatt selbst (kleinere Haelfte) und ein neues
+ * rechtes Blatt (groessere Haelfte) verteilt.
+ * @return kuerzester trennender Schluessel und TID des neuen Blattes
+ */
+DBMyIndex::value_container
+DBMyIndex::split_leaf(char *buf, int count, const vector<char> &lists, bool append) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
 
+    int split = split_point(buf, count, true, append);
+    if (split < 0)
+        throw DBIndexException("leaf cannot be split into two pages");
 
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
-    }
-
+    //Groessere Haelfte in das neue Blatt
+    value_container vc;
+    vc.tid = initNode(false, true, head.next);
+    char *newnode_ptr = bacbStack.top().getDataPtr();
+    node_header new_head;
+    read_head(newnode_ptr, new_head);
+    if (write_entries(newnode_ptr, new_head, buf + split * entrySize(), count - split, &lists) == false)
+        throw DBIndexException("leaf overflow while splitting");
+    uint right_count = counted->load() ? node_count(newnode_ptr) : 0;
+    bacbStack.top().setModified();
+    unfix_block(bacbStack.top());
+    bacbStack.pop();
 
-    int page = bacbStack.top().getBlockNo();
-    ss << "Page: " << page << endl;
-    char *leafptr = ptr;
-    bool isroot;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-    ss << "Root:" << isroot << endl;
+    //Separator fuer den Elternknoten: so kurz wie moeglich, aber > groesster Schluessel links
+    vector<char> sep_key(keySize());
+    shortest_separator(buf + (split - 1) * entrySize(), buf + split * entrySize(), &sep_key[0]);
+    vc.val = read_key(&sep_key[0]);
 
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-    ss << "Leaf:" << isleaf << endl;
+    //Kleinere Haelfte bleibt, Blattkette umhaengen
+    head.next = vc.tid;
+    if (write_entries(ptr, head, buf, split, &lists) == false)
+        throw DBIndexException("leaf overflow while splitting");
+    bacbStack.top().setModified();
+    if (counted->load()) {
+        vc.tid.slot = right_count;
+        vc.leftCount = node_count(ptr);
+    }
 
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    ptr += sizeof(int);
-    ss << "Fill Level:" << fill_level << endl;
+    vc.isnew = true;
+    vc.append = append;
+    return vc;
+}
 
+/** Split node of tree
+ * Die count Eintraege aus buf (Inhalt des vollen inneren Knotens auf bacbStack.top()
+ * inklusive des neuen Separators, rechtestes Kind last) werden geteilt.
+ * Der mittlere Schluessel wandert in den Elternknoten.
+ * @return mittlerer Schluessel und TID des neuen rechten Knotens
+ */
+DBMyIndex::value_container
+DBMyIndex::split_node(char *buf, int count, const TID &last, bool append) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+
+    int split = split_point(buf, count, false, append);
+    if (split < 0)
+        throw DBIndexException("node cannot be split into two pages");
+    value_container up;
+    up.val = read_key(buf + split * entrySize());
+    TID middle;
+    memcpy(&middle, buf + split * entrySize() + keySize(), sizeof(TID));
+
+    //Eintraege rechts vom mittleren Schluessel in den neuen Knoten
+    up.tid = initNode(false, false, last);
+    inner_changed(up.tid.page);
+    char *newnode_ptr = bacbStack.top().getDataPtr();
+    node_header new_head;
+    read_head(newnode_ptr, new_head);
+    if (write_entries(newnode_ptr, new_head, buf + (split + 1) * entrySize(), count - split - 1) == false)
+        throw DBIndexException("node overflow while splitting");
+    up.tid.slot = counted->load() ? node_count(newnode_ptr) : 0;
+    bacbStack.top().setModified();
+    unfix_block(bacbStack.top());
+    bacbStack.pop();
 
-    TID nextNode;
-    nextNode.read(ptr);
-    ptr += sizeof(TID);
-    ss << "Next Node:" << nextNode.page << endl;
+    //Eintraege links davon bleiben, das Kind des mittleren Schluessels wird rechtestes Kind
+    head.next = middle;
+    if (write_entries(ptr, head, buf, split) == false)
+        throw DBIndexException("node overflow while splitting");
+    bacbStack.top().setModified();
+    up.leftCount = counted->load() ? node_count(ptr) : 0;
 
+    up.isnew = true;
+    up.append = append;
+    return up;
+}
 
-    // memcpy (*destination, *source, size);
+/**
+ * Die gespaltene Wurzel liegt auf bacbStack.top(). Es wird eine neue Wurzel mit dem
+ * Separator aus vc angelegt, im Metablock eingetragen und anstelle der alten gepinnt.
+ */
+void DBMyIndex::split_root(value_container vc) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    char *ptr = bacbStack.top().getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+
+    //Inhalt der Wurzel wandert in einen neuen linken Knoten, die Wurzel bleibt im selben Block
+    TID left = initNode(false, head.isleaf, head.next);
+    inner_changed(left.page);
+    inner_changed(rootTID.page);
+    char *left_ptr = bacbStack.top().getDataPtr();
+    memcpy(left_ptr, ptr, DBFileBlock::getBlockSize());
+    node_header left_head;
+    read_head(left_ptr, left_head);
+    left_head.isroot = false;
+    write_head(left_ptr, left_head);
+    bacbStack.top().setModified();
+    unfix_block(bacbStack.top());
+    bacbStack.pop();
 
-    uint *cnt = (uint *) ptr;
+    //Wurzel wird innerer Knoten: linker Knoten links vom Separator, neuer Knoten als rechtestes Kind
+    head.isleaf = false;
+    head.next = vc.tid;
+    vector<char> entry(entrySize());
+    vc.val->write(&entry[0]);
+    left.slot = vc.leftCount;
+    left.write(&entry[0] + keySize());
+    delete vc.val;
+    if (write_entries(ptr, head, &entry[0], 1) == false)
+        throw DBIndexException("separator does not fit into the new root");
+    bacbStack.top().setModified();
+}
 
-    DBAttrType *searchval;
+/**
+ * Ausgabe der Statistik zum Debuggen
+ */
+string DBMyIndex::Statistics::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "[DBMyIndex::Statistics]" << endl;
+    ss << linePrefix << "height: " << height << endl;
+    ss << linePrefix << "nodesPerLevel:";
+    for (uint i = 0; i < nodesPerLevel.size(); ++i)
+        ss << " " << nodesPerLevel[i];
+    ss << endl;
+    ss << linePrefix << "fillHistogram:";
+    for (uint i = 0; i < fillHistogram.size(); ++i)
+        ss << " " << i * 10 << "%:" << fillHistogram[i];
+    ss << endl;
+    ss << linePrefix << "entries: " << entries << endl;
+    ss << linePrefix << "leafChainLength: " << leafChainLength << endl;
+    ss << linePrefix << "underfullNodes: " << underfullNodes << endl;
+    ss << linePrefix << "freeBlocks: " << freeBlocks << endl;
+    ss << linePrefix << "overflowBlocks: " << overflowBlocks << endl;
+    ss << linePrefix << "filterBlocks: " << filterBlocks << endl;
+    ss << linePrefix << "violations: " << violations.size() << endl;
+    for (list<string>::const_iterator it = violations.begin(); it != violations.end(); ++it)
+        ss << linePrefix << "\t" << *it << endl;
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
 
+/**
+ * Anteil der Suchen, die der Cache beantwortet hat
+ */
+double DBMyIndex::CacheStatistics::hitRate() const {
+    if (hits + misses == 0)
+        return 0;
+    return (double) hits / (hits + misses);
+}
 
-    for (int i = 0; i < fill_level; ++i) {
+string DBMyIndex::CacheStatistics::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "[DBMyIndex::CacheStatistics]" << endl;
+    ss << linePrefix << "capacity: " << capacity << endl;
+    ss << linePrefix << "maxTids: " << maxTids << endl;
+    ss << linePrefix << "entries: " << entries << endl;
+    ss << linePrefix << "hits: " << hits << endl;
+    ss << linePrefix << "misses: " << misses << endl;
+    ss << linePrefix << "hitRate: " << hitRate() << endl;
+    ss << linePrefix << "evictions: " << evictions << endl;
+    ss << linePrefix << "invalidations: " << invalidations << endl;
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
 
-        DBAttrType *val;
-        val = DBAttrType::read(ptr, attrType);
-        ptr += sizeof(val);
-        ss << i << " " << val->toString("/n");
+string DBMyIndex::LogStatistics::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "[DBMyIndex::LogStatistics]" << endl;
+    ss << linePrefix << "enabled: " << enabled << endl;
+    ss << linePrefix << "bytes: " << bytes << endl;
+    ss << linePrefix << "commits: " << commits << endl;
+    ss << linePrefix << "syncs: " << syncs << endl;
+    ss << linePrefix << "checkpoints: " << checkpoints << endl;
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
 
-        if (!isleaf) {
-            TID tid;
-            tid.read(ptr);
+/**
+ * Friert den Index in die Snapshot-Datei DBMyIndexSnapshot::snapshotName(file) ein.
+ * Die Blattkette wird Blatt fuer Blatt mit geteilten Sperren gelesen und der vorher kopierte
+ * Einfuegepuffer eingemischt; parallele Aenderungen sind daher nur je Blatt konsistent enthalten.
+ * Nur fuer Indexe ueber einem Attribut.
+ */
+void DBMyIndex::writeSnapshot() {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "writeSnapshot()");
 
-            ss << "   TID:    " << tid.page << endl;
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    if (isComposite())
+        throw DBIndexException("snapshots support single attribute indexes only");
+
+    // gepufferten Eintraegen einmischen; wurde der Puffer waehrenddessen geleert, erneut (wie count())
+    buffered_entries buffered;
+    vector<char> keys;
+    vector<uint64_t> starts;
+    vector<TID> tids;
+    vector<TID> postings;
+    while (true) {
+        unsigned long changes = buffer_snapshot(buffered.entries);
+        uint next = 0;
+        // zum linken Blatt absteigen, dann der Blattkette folgen
+        BlockNo block = rootTID.page;
+        while (block != noBlockNo) {
+            bacbStack.push(bufMgr.fixBlock(file, block, LOCK_SHARED));
+            try {
+                char *ptr = bacbStack.top().getDataPtr();
+                node_header head;
+                read_head(ptr, head);
+                for (int pos = 0; head.isleaf && pos < head.fill_level; ++pos) {
+                    DBAttrType *key = key_at(ptr, pos);
+                    while (next < buffered.entries.size() && buffered.entries[next].first->operator<(*key)) {
+                        const DBAttrType &val = *buffered.entries[next].first;
+                        postings.clear();
+                        for (; next < buffered.entries.size() && buffered.entries[next].first->operator==(val); ++next)
+                            postings.push_back(buffered.entries[next].second);
+                        append_snapshot_key(val, postings, keySize(), unique, keys, starts, tids);
+                    }
+                    postings.clear();
+                    read_postings(tid_at(ptr, pos), ptr, postings);
+                    for (; next < buffered.entries.size() && buffered.entries[next].first->operator==(*key); ++next)
+                        postings.push_back(buffered.entries[next].second);
+                    append_snapshot_key(*key, postings, keySize(), unique, keys, starts, tids);
+                    delete key;
+                }
+                block = head.isleaf ? head.next.page : child_at(ptr, head, 0).page;
+            } catch (DBException &e) {
+                unfix_path();
+                throw;
+            }
+            unfix_path();
         }
-        ptr += sizeof(TID);
-
+        while (next < buffered.entries.size()) {
+            const DBAttrType &val = *buffered.entries[next].first;
+            postings.clear();
+            for (; next < buffered.entries.size() && buffered.entries[next].first->operator==(val); ++next)
+                postings.push_back(buffered.entries[next].second);
+            append_snapshot_key(val, postings, keySize(), unique, keys, starts, tids);
+        }
+        if (buffer_unchanged(changes))
+            break;
+        buffered.clear();
+        keys.clear();
+        starts.clear();
+        tids.clear();
     }
-    ss << endl;
-    return ss.str();
-
+    if (unique == false)
+        starts.push_back(tids.size());
 
+    DBMyIndexSnapshot::write(DBMyIndexSnapshot::snapshotName(file), attrType, unique, keySize(), keys, starts,
+                             tids);
 }
 
 /**
- * Used for Finding a Value in Tree and returning the tid of the touple
- * @param val
- * @param tids
+ * Schaltet den gezaehlten Baum ein oder aus (Voraussetzung fuer count(), rank(), select() und
+ * quantile()); die Einstellung wird im Metablock gespeichert. Beim Einschalten werden alle
+ * Anzahlen neu berechnet, waehrenddessen darf der Index wie bei build() nicht anderweitig
+ * geaendert werden. Danach halten Aenderungen den ganzen Pfad exklusiv.
  */
-void DBMyIndex::search_in_node(const DBAttrType &val, DBListTID &tids) {
+void DBMyIndex::setCounted(bool enable) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "setCounted()");
+    LOG4CXX_DEBUG(logger, "enable: " + TO_STR(enable));
 
-    char *ptr = bacbStack.top().getDataPtr();
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    redo_scope scope(*this);
+
+    buffer_access access(*insertBuffer);
+    if (access.buffered)
+        flush_buffer(access.guard);
+    if (enable && counted->load() == false)
+        recount(rootTID.page);
+    counted->store(enable);
+
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_EXCLUSIVE);
+    uint flags;
+    memcpy(&flags, meta.getDataPtr() + meta_flags_offset(), sizeof(uint));
+    flags = enable ? flags | countedFlag : flags & ~countedFlag;
+    memcpy(meta.getDataPtr() + meta_flags_offset(), &flags, sizeof(uint));
+    meta.setModified();
+    unfix_block(meta);
+    access.release();
+    log_commit();
+}
 
+/**
+ * Anzahl der Tupel-TIDs mit lower <= Schluessel <= upper, NULL: unbeschraenkt.
+ * Nur im gezaehlten Baum; zwei Abstiege statt eines Durchlaufs der Blattkette.
+ */
+uint DBMyIndex::count(const DBAttrType *lower, const DBAttrType *upper) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "count()");
 
-    if (bacbStack.top().getBlockNo() == 0) {
-        ptr += sizeof(TID);
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    if (counted->load() == false)
+        throw DBIndexException("index is not counted");
+
+    // gepufferte Eintraege dazuzaehlen; wurde der Puffer waehrenddessen geleert, erneut
+    buffered_entries buffered;
+    while (true) {
+        unsigned long changes = buffer_snapshot(buffered.entries);
+        uint below = lower != NULL ? count_below(lower, false) : 0;
+        uint upto = count_below(upper, true);
+        uint total = upto > below ? upto - below : 0;
+        for (uint i = 0; i < buffered.entries.size(); ++i) {
+            const DBAttrType &key = *buffered.entries[i].first;
+            if ((lower == NULL || key.operator<(*lower) == false) && (upper == NULL || upper->operator<(key) == false))
+                total += 1;
+        }
+        if (buffer_unchanged(changes))
+            return total;
+        buffered.clear();
     }
+}
 
+/**
+ * Rang von val: Anzahl der Tupel-TIDs mit Schluessel < val. Nur im gezaehlten Baum.
+ */
+uint DBMyIndex::rank(const DBAttrType &val) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "rank()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
 
-    char *leafptr = ptr;
-    bool isroot;
-    // memcpy (*destination, *source, size);
-    memcpy(&isroot, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    bool isleaf;
-    memcpy(&isleaf, ptr, sizeof(bool));
-    ptr += sizeof(bool);
-
-    int fill_level;
-    memcpy(&fill_level, ptr, sizeof(int));
-    ptr += sizeof(int);
-
-    TID nextNode;
-    nextNode.read(ptr);
-    ptr += sizeof(TID);
-
-    // memcpy (*destination, *source, size);
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    if (counted->load() == false)
+        throw DBIndexException("index is not counted");
+
+    buffered_entries buffered;
+    while (true) {
+        unsigned long changes = buffer_snapshot(buffered.entries);
+        uint total = count_below(&val, false);
+        for (uint i = 0; i < buffered.entries.size() && buffered.entries[i].first->operator<(val); ++i)
+            total += 1;
+        if (buffer_unchanged(changes))
+            return total;
+        buffered.clear();
+    }
+}
 
-    uint *cnt = (uint *) ptr;
+/**
+ * Liefert die Tupel-TID an Position pos (ab 0) in Schluesselreihenfolge, gleiche Schluessel
+ * in Heap-Reihenfolge, und ihren Schluessel (muss vom Aufrufer geloescht werden).
+ * Rueckgabe false, wenn der Index nicht mehr als pos TIDs enthaelt. Nur im gezaehlten Baum.
+ */
+bool DBMyIndex::select(uint pos, DBAttrType *&key, TID &tid) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
+    LOG4CXX_INFO(logger, "select()");
+    LOG4CXX_DEBUG(logger, "pos: " + TO_STR(pos));
 
-    DBAttrType *searchval;
+    if (bacbStack.empty() == false)
+        throw DBIndexException("BACB Stack is invalid");
+    if (counted->load() == false)
+        throw DBIndexException("index is not counted");
+
+    //Position des gepufferten Eintrags j: j + Anzahl der Eintraege im Baum davor. Liegt pos vor
+    //dieser Position, ist es die Position pos - j im Baum.
+    buffered_entries buffered;
+    while (true) {
+        unsigned long changes = buffer_snapshot(buffered.entries);
+        bool found = false;
+        uint j = 0;
+        for (; j < buffered.entries.size(); ++j) {
+            const DBAttrType &val = *buffered.entries[j].first;
+            uint before = count_below(&val, false);
+            if (unique == false) {
+                DBListTID same;
+                find_in_tree(val, same);
+                for (DBListTID::iterator it = same.begin(); it != same.end(); ++it)
+                    before += less_tid(*it, buffered.entries[j].second) ? 1 : 0;
+            }
+            if (pos < before + j)
+                break;
+            if (pos == before + j) {
+                vector<char> raw(keySize(), 0);
+                val.write(&raw[0]);
+                key = read_key(&raw[0]);
+                tid = buffered.entries[j].second;
+                found = true;
+                break;
+            }
+        }
+        if (found == false)
+            found = select_in_tree(pos - j, key, tid);
+        if (buffer_unchanged(changes))
+            return found;
+        if (found)
+            delete key;
+        key = NULL;
+        buffered.clear();
+    }
+}
 
+/**
+ * select() nur im Baum
+ */
+bool DBMyIndex::select_in_tree(uint pos, DBAttrType *&key, TID &tid) {
+    stack<DBBACB> &bacbStack = cursor().bacbStack;
     bool found = false;
-    for (int i = 0; i < fill_level; ++i) {
-        searchval = DBAttrType::read(ptr, attrType);
-        if (searchval->operator>(val) && !isleaf) {
-            TID found_tid;
-            found_tid.read(ptr + sizeof(val));
-
-            bacbStack.push(bufMgr.fixBlock(file, found_tid.page, LOCK_SHARED));
-
-            search_in_node(val, tids);
-            found = true;
-            break;
-        } else if (searchval->operator==(val) && isleaf) {
-            TID found_tid;
-            found_tid.read(ptr + sizeof(val));
-            tids.push_back(found_tid);
+    stack<int> path;
+    try {
+        bacbStack.push(bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED));
+        char *ptr = bacbStack.top().getDataPtr();
+        node_header head;
+        read_head(ptr, head);
+        while (head.isleaf == false) {
+            //Kinder ueberspringen, deren Teilbaeume ganz vor pos liegen
+            int i = 0;
+            for (; i < head.fill_level && pos >= child_at(ptr, head, i).slot; ++i)
+                pos -= child_at(ptr, head, i).slot;
+            bacbStack.push(bufMgr.fixBlock(file, child_at(ptr, head, i).page, LOCK_SHARED));
+            ptr = bacbStack.top().getDataPtr();
+            read_head(ptr, head);
+            release_ancestors(path);
+        }
+        for (int i = 0; i < head.fill_level && found == false; ++i) {
+            TID ref = tid_at(ptr, i);
+            uint count = posting_count(ref, ptr);
+            if (pos >= count) {
+                pos -= count;
+                continue;
+            }
+            vector<TID> postings;
+            read_postings(ref, ptr, postings);
+            key = key_at(ptr, i);
+            tid = postings[pos];
             found = true;
-            break;
         }
-        ptr += (sizeof(val) + sizeof(TID));
+    } catch (DBException &e) {
+        unfix_path();
+        throw;
     }
-    if (!found && !isleaf) {
-        bacbStack.push(bufMgr.fixBlock(file, nextNode.page, LOCK_SHARED));
-        search_in_node(val, tids);
+    unfix_path();
+    return found;
+}
+
+/**
+ * Schluessel am q-Quantil (0 <= q <= 1) der Tupel-TIDs, exakt ueber select();
+ * NULL bei leerem Index. Der Schluessel muss vom Aufrufer geloescht werden.
+ */
+DBAttrType *DBMyIndex::quantile(double q) {
+    LOG4CXX_INFO(logger, "quantile()");
+    LOG4CXX_DEBUG(logger, "q: " + TO_STR(q));
+
+    uint total = count(NULL, NULL);
+    if (total == 0)
+        return NULL;
+    double pos = floor(max(0.0, min(q, 1.0)) * total);
+    DBAttrType *key = NULL;
+    TID tid;
+    if (select(min((uint) pos, total - 1), key, tid) == false)
+        return NULL;
+    return key;
+}
+
+/**
+ * Untersucht den ganzen Baum: Hoehe, Knoten je Ebene (Ebene 0 = Wurzel), Belegung der
+ * Seiten in 10%-Klassen, Laenge der Blattkette, Freiliste und Ueberlaufbloecke.
+ * Dabei werden die Strukturinvarianten geprueft, Verstoesse stehen in violations.
+ * Die Wurzel bleibt waehrend der Untersuchung geteilt gefixt, so dass sich die Hoehe nicht
+ * aendert; Aenderungen an Blaettern durch parallele Schreiber koennen dennoch einfliessen.
+ * Verwendet nicht bacbStack und kann daher auch aus einem anderen Thread (DBMonitorMgr)
+ * gerufen werden.
+ */
+DBMyIndex::Statistics DBMyIndex::inspect() {
+    LOG4CXX_INFO(logger, "inspect()");
+    Statistics stats;
+    stats.height = 0;
+    stats.fillHistogram.assign(10, 0);
+    stats.entries = 0;
+    stats.leafChainLength = 0;
+    stats.underfullNodes = 0;
+    stats.freeBlocks = 0;
+    stats.overflowBlocks = 0;
+    stats.filterBlocks = 0;
+
+    vector<BlockNo> leaves;
+    int leaf_level = -1;
+    DBBACB root = bufMgr.fixBlock(file, rootTID.page, LOCK_SHARED);
+    try {
+        inspect_node(root, 0, NULL, NULL, stats, leaves, leaf_level);
+    } catch (DBException &e) {
+        unfix_block(root);
+        throw;
+    }
+    unfix_block(root);
+    stats.height = stats.nodesPerLevel.size();
+
+    //Blattkette: muss alle Blaetter in Schluesselreihenfolge verbinden
+    if (leaves.empty() == false) {
+        BlockNo block = leaves[0];
+        while (block != noBlockNo && stats.leafChainLength <= leaves.size()) {
+            if (stats.leafChainLength < leaves.size() && leaves[stats.leafChainLength] != block)
+                stats.violations.push_back("leaf chain reaches block " + TO_STR(block) + " out of key order");
+            stats.leafChainLength += 1;
+            DBBACB leaf = bufMgr.fixBlock(file, block, LOCK_SHARED);
+            node_header head;
+            read_head(leaf.getDataPtr(), head);
+            unfix_block(leaf);
+            block = head.next.page;
+        }
+        if (stats.leafChainLength != leaves.size())
+            stats.violations.push_back("leaf chain length " + TO_STR(stats.leafChainLength) +
+                                       " != leaf count " + TO_STR(leaves.size()));
     }
 
-    if (!isroot) {
-        bufMgr.unfixBlock(bacbStack.top());
-        bacbStack.pop();
+    //Freiliste
+    DBBACB meta = bufMgr.fixBlock(file, rootBlockNo, LOCK_SHARED);
+    TID free_tid;
+    memcpy(&free_tid, meta.getDataPtr() + sizeof(TID), sizeof(TID));
+    uint filter_state;
+    memcpy(&filter_state, meta.getDataPtr() + filterOffset, sizeof(uint));
+    if (filter_state != filterNone)
+        memcpy(&stats.filterBlocks, meta.getDataPtr() + filterOffset + sizeof(uint) * 4, sizeof(uint));
+    unfix_block(meta);
+    while (free_tid.page != noBlockNo && stats.freeBlocks < bufMgr.getBlockCnt(file)) {
+        stats.freeBlocks += 1;
+        DBBACB bacb = bufMgr.fixBlock(file, free_tid.page, LOCK_SHARED);
+        free_tid.read(bacb.getDataPtr());
+        unfix_block(bacb);
     }
 
+    //jeder Block ist Metablock, Knoten, frei, Ueberlauf- oder Filterblock
+    uint nodes = 0;
+    for (uint i = 0; i < stats.nodesPerLevel.size(); ++i)
+        nodes += stats.nodesPerLevel[i];
+    uint blocks = 1 + nodes + stats.freeBlocks + stats.overflowBlocks + stats.filterBlocks;
+    if (blocks != bufMgr.getBlockCnt(file))
+        stats.violations.push_back("block count " + TO_STR(bufMgr.getBlockCnt(file)) +
+                                   " != reachable blocks " + TO_STR(blocks));
+
+    LOG4CXX_DEBUG(logger, "stats:\n" + stats.toString("\t"));
+    return stats;
 }
 
+/**
+ * Untersucht den gefixten Knoten bacb auf Ebene level, dessen Schluessel in [lo, hi) liegen
+ * muessen (NULL: unbeschraenkt), und rekursiv seine Kinder. Blaetter werden in
+ * Schluesselreihenfolge an leaves angehaengt. Rueckgabe: Anzahl der Tupel-TIDs im Teilbaum,
+ * im gezaehlten Baum wird damit die Anzahl jedes Kindes geprueft.
+ */
+uint DBMyIndex::inspect_node(DBBACB &bacb, int level, const DBAttrType *lo, const DBAttrType *hi,
+                             Statistics &stats, vector<BlockNo> &leaves, int &leaf_level) {
+    char *ptr = bacb.getDataPtr();
+    node_header head;
+    read_head(ptr, head);
+    string node = "node " + TO_STR(bacb.getBlockNo()) + ": ";
+    uint total = 0;
+
+    if (stats.nodesPerLevel.size() <= (uint) level)
+        stats.nodesPerLevel.push_back(0);
+    stats.nodesPerLevel[level] += 1;
+    if (head.isroot != (level == 0))
+        stats.violations.push_back(node + "isroot flag is wrong");
+
+    vector<char> buffer(max(head.fill_level, 1) * entrySize());
+    vector<char> lists;
+    read_entries(ptr, head, &buffer[0], &lists);
+    uint prefix, width;
+    uint bytes = encode_layout(&buffer[0], head.fill_level, head.isleaf, prefix, width);
+    uint bucket = bytes * 10 / DBFileBlock::getBlockSize();
+    stats.fillHistogram[min(bucket, 9u)] += 1;
+    if (level > 0 && underfull(ptr, head))
+        stats.underfullNodes += 1;
+
+    //Schluessel streng aufsteigend und innerhalb der Schranken des Elternknotens
+    vector<DBAttrType *> keys;
+    for (int i = 0; i < head.fill_level; ++i)
+        keys.push_back(read_key(&buffer[i * entrySize()]));
+    for (int i = 0; i < head.fill_level; ++i) {
+        if (i > 0 && keys[i]->operator>(*keys[i - 1]) == false)
+            stats.violations.push_back(node + "keys not strictly ascending at " + TO_STR(i));
+        if (lo != NULL && keys[i]->operator<(*lo))
+            stats.violations.push_back(node + "key " + TO_STR(i) + " below lower bound");
+        if (hi != NULL && keys[i]->operator<(*hi) == false)
+            stats.violations.push_back(node + "key " + TO_STR(i) + " not below upper bound");
+    }
 
+    if (head.isleaf) {
+        if (leaf_level < 0)
+            leaf_level = level;
+        else if (leaf_level != level)
+            stats.violations.push_back(node + "leaf on level " + TO_STR(level) + " instead of " + TO_STR(leaf_level));
+        leaves.push_back(bacb.getBlockNo());
+        stats.entries += head.fill_level;
+        for (int i = 0; i < head.fill_level; ++i) {
+            TID ref;
+            ref.read(&buffer[i * entrySize() + keySize()]);
+            total += posting_count(tid_at(ptr, i), ptr);
+            if (is_list(ref) == false || (ref.slot & overflowFlag) == 0)
+                continue;
+            for (BlockNo block = ref.page; block != noBlockNo; stats.overflowBlocks += 1) {
+                DBBACB overflow = bufMgr.fixBlock(file, block, LOCK_SHARED);
+                TID next;
+                next.read(overflow.getDataPtr());
+                unfix_block(overflow);
+                block = next.page;
+            }
+        }
+    } else {
+        for (int i = 0; i <= head.fill_level; ++i) {
+            TID child = i < head.fill_level ? tid_at(ptr, i) : head.next;
+            DBBACB child_bacb = bufMgr.fixBlock(file, child.page, LOCK_SHARED);
+            try {
+                uint count = inspect_node(child_bacb, level + 1, i > 0 ? keys[i - 1] : lo,
+                                          i < head.fill_level ? keys[i] : hi, stats, leaves, leaf_level);
+                if (counted->load() && child.slot != count)
+                    stats.violations.push_back(node + "count of child " + TO_STR(i) + " is " + TO_STR(child.slot)
+                                               + " instead of " + TO_STR(count));
+                total += count;
+            } catch (DBException &e) {
+                unfix_block(child_bacb);
+                for (uint k = 0; k < keys.size(); ++k)
+                    delete keys[k];
+                throw;
+            }
+            unfix_block(child_bacb);
+        }
+    }
+    for (uint k = 0; k < keys.size(); ++k)
+        delete keys[k];
+    return total;
+}
 
+/**
+ * Statistik aller geoeffneten DBMyIndex-Instanzen, z.B. fuer die Ausgabe im DBMonitorMgr
+ */
+string DBMyIndex::inspectAll(string linePrefix) {
+    stringstream ss;
+    lock_guard<mutex> guard(openIndexesMutex);
+    for (set<DBMyIndex *>::iterator it = openIndexes.begin(); it != openIndexes.end(); ++it) {
+        ss << linePrefix << "[DBMyIndex " << (*it)->file.toString() << "]" << endl;
+        ss << (*it)->inspect().toString(linePrefix + "\t");
+    }
+    return ss.str();
+}
 
 
 /**
@@ -1294,10 +5869,13 @@ void DBMyIndex::search_in_node(const DBAttrType &val, DBListTID &tids) {
  * - attrType: Attributtp
  * - ModeType: READ, WRITE
  * - bool: unique Indexattribut
+ * Fuer zusammengesetzte Schluessel zusaetzlich (7 Parameter, attrType wird dann ignoriert):
+ * - const vector<AttrTypeEnum> *: Typen der Schluesselattribute
+ * - const vector<AttrTypeEnum> *: Typen der mitgespeicherten Attribute
  */
 extern "C" void *createDBMyIndex(int nArgs, va_list ap) {
-    // Genau 5 Parameter
-    if (nArgs != 5) {
+    // Genau 5 bzw. 7 Parameter
+    if (nArgs != 5 && nArgs != 7) {
         throw DBException("Invalid number of arguments");
     }
     DBBufferMgr *bufMgr = va_arg(ap, DBBufferMgr *);
@@ -1305,6 +5883,11 @@ extern "C" void *createDBMyIndex(int nArgs, va_list ap) {
     enum AttrTypeEnum attrType = (enum AttrTypeEnum) va_arg(ap, int);
     ModType m = (ModType) va_arg(ap, int);
     bool unique = (bool) va_arg(ap, int);
+    if (nArgs == 7) {
+        const vector<AttrTypeEnum> *keyTypes = va_arg(ap, const vector<AttrTypeEnum> *);
+        const vector<AttrTypeEnum> *includeTypes = va_arg(ap, const vector<AttrTypeEnum> *);
+        return new DBMyIndex(*bufMgr, *file, *keyTypes, *includeTypes, m, unique);
+    }
     return new DBMyIndex(*bufMgr, *file, attrType, m, unique);
 }
 
@@ -0,0 +1,383 @@
+/**
+ * Nur lesbare Snapshots von DBMyIndex fuer Replikate, die ausschliesslich suchen.
+ * Auswahl pro Index ueber den Klassennamen "DBMyIndexSnapshot"; gelesen wird die mit
+ * DBMyIndex::writeSnapshot() geschriebene Datei snapshotName(file).
+ *
+ * Aufbau der Snapshot-Datei (unveraenderlich, lueckenlos gepackt, Abschnitte 8-Byte-ausgerichtet):
+ * - Kopf (file_header): Kennung, Formatversion, Attributtyp, unique, Schluessellaenge,
+ *   Anzahlen und Offsets der Abschnitte
+ * - Schluessel: keyCount Schluessel aufsteigend, je keySize Bytes wie DBAttrType::write
+ * - nur bei nicht eindeutigem Index: keyCount + 1 Startpositionen (uint64_t) in den TIDs,
+ *   die TIDs von Schluessel i liegen in [start i, start i + 1)
+ * - TIDs: bei eindeutigem Index die TID von Schluessel i an Position i
+ * - Zaeune: jeder fenceStride-te Schluessel noch einmal zusammenhaengend; die Suche bestimmt
+ *   darin den Abschnitt und sucht nur in ihm binaer, die oberen Stufen bleiben so im Cache.
+ *
+ * Die Datei wird nur lesend und geteilt eingeblendet, mehrere Prozesse teilen sich die Seiten.
+ * Eine Suche kopiert den Suchschluessel in einen Puffer auf dem Stack und vergleicht danach nur
+ * Bytes der Abbildung: keine Bloecke, keine Sperren, keine Speicheranforderungen ausser fuer
+ * die Ergebnisliste (und fuer Schluessel ueber probeStackBytes). Mehrere Threads koennen so
+ * dieselbe Instanz gleichzeitig benutzen. Ein neuer Snapshot ersetzt die Datei per rename, bestehende Abbildungen
+ * sehen weiter den alten Stand.
+ */
+
+
+#include <hubDB/DBMyIndexSnapshot.h>
+#include <hubDB/DBException.h>
+#include <algorithm>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace HubDB::Index;
+using namespace HubDB::Exception;
+
+LoggerPtr DBMyIndexSnapshot::logger(Logger::getLogger("HubDB.Index.DBMyIndexSnapshot"));
+
+// registerClass()-Methode am Ende dieser Datei: macht die Klasse der Factory bekannt
+int rMyIdxSnapshot = DBMyIndexSnapshot::registerClass();
+const char DBMyIndexSnapshot::magic[8] = {'H', 'U', 'B', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t DBMyIndexSnapshot::formatVersion(1);
+// Abstand der Zaunschluessel
+const uint DBMyIndexSnapshot::fenceStride(64);
+
+// find(): so lange Suchschluessel werden auf dem Stack kodiert
+const uint probeStackBytes = 256;
+
+// Funktion bekannt machen
+extern "C" void *createDBMyIndexSnapshot(int nArgs, va_list ap);
+
+/**
+ * Naechster 8-Byte-ausgerichteter Offset
+ */
+static uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+/**
+ * Ausgabe des Indexes zum Debuggen
+ */
+string DBMyIndexSnapshot::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "[DBMyIndexSnapshot]" << endl;
+    ss << DBIndex::toString(linePrefix + "\t") << endl;
+    ss << linePrefix << "unique: " << unique << endl;
+    ss << linePrefix << "keys: " << header.keyCount << endl;
+    ss << linePrefix << "tids: " << header.tidCount << endl;
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
+
+/** Konstruktor
+ * - DBBufferMgr & bufferMgr (Referenz auf Buffermanager, wird nicht benutzt)
+ * - DBFile & file (Referenz auf Dateiobjekt, bestimmt den Namen der Snapshot-Datei)
+ * - enum AttrTypeEnum (Typ des Indexattributs)
+ * - ModType mode (Accesstyp: READ, WRITE - siehe DBTypes.h)
+ * - bool unique (ist Attribute unique)
+ */
+DBMyIndexSnapshot::DBMyIndexSnapshot(DBBufferMgr &bufferMgr, DBFile &file,
+                                     enum AttrTypeEnum attrType, ModType mode, bool unique) :
+        DBIndex(bufferMgr, file, attrType, mode, unique),
+        map(NULL),
+        mapSize(0),
+        keyArea(NULL),
+        startArea(NULL),
+        tidArea(NULL),
+        fenceArea(NULL),
+        keySize(DBAttrType::getSize4Type(attrType)) {
+    if (logger != NULL) {
+        LOG4CXX_INFO(logger, "DBMyIndexSnapshot()");
+    }
+
+    string path = snapshotName(file);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw DBIndexException("can not open snapshot " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(file_header)) {
+        ::close(fd);
+        throw DBIndexException("snapshot " + path + " is truncated");
+    }
+    mapSize = st.st_size;
+    void *addr = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        throw DBIndexException("can not map snapshot " + path);
+    map = (const char *) addr;
+
+    memcpy(&header, map, sizeof(file_header));
+    try {
+        validate();
+    } catch (DBException &e) {
+        munmap((void *) map, mapSize);
+        throw;
+    }
+    keyArea = map + header.keysOffset;
+    startArea = map + header.startsOffset;
+    tidArea = map + header.tidsOffset;
+    fenceArea = map + header.fencesOffset;
+
+    if (logger != NULL) {
+        LOG4CXX_DEBUG(logger, "this:\n" + toString("\t"));
+    }
+}
+
+DBMyIndexSnapshot::~DBMyIndexSnapshot() {
+    LOG4CXX_INFO(logger, "~DBMyIndexSnapshot()");
+    if (map != NULL)
+        munmap((void *) map, mapSize);
+}
+
+/**
+ * Prueft den Kopf gegen die Parameter des Indexes und die Dateigroesse, bei nicht eindeutigem
+ * Index auch die Startpositionen: find() liest die TIDs in [start i, start i + 1) ungeprueft
+ */
+void DBMyIndexSnapshot::validate() const {
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion)
+        throw DBIndexException("file is no snapshot of a supported format");
+    if (header.attrType != (uint32_t) attrType || header.keySize != keySize ||
+        (header.unique != 0) != unique)
+        throw DBIndexException("snapshot does not match the index definition");
+
+    uint64_t fenceCount = (header.keyCount + fenceStride - 1) / fenceStride;
+    if (header.fenceCount != fenceCount || (unique && header.tidCount != header.keyCount))
+        throw DBIndexException("snapshot is corrupt");
+    //Anzahlen und Offsets einzeln begrenzen, damit die Produkte unten nicht ueberlaufen
+    if (header.keyCount > mapSize || header.tidCount > mapSize || header.keysOffset > mapSize ||
+        header.startsOffset > mapSize || header.tidsOffset > mapSize || header.fencesOffset > mapSize)
+        throw DBIndexException("snapshot is truncated");
+    if (header.keysOffset + header.keyCount * header.keySize > mapSize ||
+        header.tidsOffset + header.tidCount * sizeof(TID) > mapSize ||
+        header.fencesOffset + header.fenceCount * header.keySize > mapSize ||
+        (unique == false && header.startsOffset + (header.keyCount + 1) * sizeof(uint64_t) > mapSize))
+        throw DBIndexException("snapshot is truncated");
+    if (unique)
+        return;
+
+    uint64_t prev = 0;
+    for (uint64_t i = 0; i <= header.keyCount; ++i) {
+        uint64_t start;
+        memcpy(&start, map + header.startsOffset + i * sizeof(uint64_t), sizeof(uint64_t));
+        if ((i == 0 && start != 0) || start < prev || start > header.tidCount)
+            throw DBIndexException("snapshot is corrupt");
+        prev = start;
+    }
+    if (prev != header.tidCount)
+        throw DBIndexException("snapshot is corrupt");
+}
+
+/**
+ * Name der Snapshot-Datei zur Indexdatei file
+ */
+string DBMyIndexSnapshot::snapshotName(const DBFile &file) {
+    return file.getFileName() + ".snap";
+}
+
+/**
+ * Schreibt den Eintrag von path in seinem Verzeichnis (nach rename) auf die Platte; auch fuer
+ * den Redo-Log von DBMyIndex
+ */
+bool DBMyIndexSnapshot::syncDirectory(const string &path) {
+    string::size_type slash = path.rfind('/');
+    string dir = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Schreibt einen Snapshot nach path: keys enthaelt die Schluessel aufsteigend (je keySize Bytes),
+ * starts bei nicht eindeutigem Index die keyCount + 1 Startpositionen ihrer TIDs in tids.
+ * Die Datei wird unter einem temporaeren Namen geschrieben, mit fsync gesichert und dann
+ * umbenannt, so zeigt path auch nach einem Absturz nie auf einen unvollstaendigen Snapshot.
+ */
+void DBMyIndexSnapshot::write(const string &path, enum AttrTypeEnum attrType, bool unique, uint keySize,
+                              const vector<char> &keys, const vector<uint64_t> &starts,
+                              const vector<TID> &tids) {
+    file_header head;
+    memset(&head, 0, sizeof(file_header));
+    memcpy(head.magic, magic, sizeof(magic));
+    head.version = formatVersion;
+    head.attrType = attrType;
+    head.unique = unique ? 1 : 0;
+    head.keySize = keySize;
+    head.keyCount = keys.size() / keySize;
+    head.tidCount = tids.size();
+    head.fenceCount = (head.keyCount + fenceStride - 1) / fenceStride;
+    head.keysOffset = align8(sizeof(file_header));
+    head.startsOffset = align8(head.keysOffset + keys.size());
+    head.tidsOffset = align8(head.startsOffset + (unique ? 0 : starts.size() * sizeof(uint64_t)));
+    head.fencesOffset = align8(head.tidsOffset + tids.size() * sizeof(TID));
+
+    vector<char> fences(head.fenceCount * keySize);
+    for (uint64_t i = 0; i < head.fenceCount; ++i)
+        memcpy(&fences[i * keySize], &keys[i * fenceStride * keySize], keySize);
+
+    string tmp = path + ".tmp";
+    FILE *out = fopen(tmp.c_str(), "wb");
+    if (out == NULL)
+        throw DBIndexException("can not create snapshot " + tmp);
+    const char zeros[8] = {0};
+    bool ok = fwrite(&head, sizeof(file_header), 1, out) == 1;
+    ok = ok && fwrite(zeros, 1, head.keysOffset - sizeof(file_header), out) == head.keysOffset - sizeof(file_header);
+    ok = ok && (keys.empty() || fwrite(&keys[0], 1, keys.size(), out) == keys.size());
+    uint64_t end = head.keysOffset + keys.size();
+    ok = ok && fwrite(zeros, 1, head.startsOffset - end, out) == head.startsOffset - end;
+    if (unique == false)
+        ok = ok && fwrite(&starts[0], sizeof(uint64_t), starts.size(), out) == starts.size();
+    end = head.startsOffset + (unique ? 0 : starts.size() * sizeof(uint64_t));
+    ok = ok && fwrite(zeros, 1, head.tidsOffset - end, out) == head.tidsOffset - end;
+    ok = ok && (tids.empty() || fwrite(&tids[0], sizeof(TID), tids.size(), out) == tids.size());
+    end = head.tidsOffset + tids.size() * sizeof(TID);
+    ok = ok && fwrite(zeros, 1, head.fencesOffset - end, out) == head.fencesOffset - end;
+    ok = ok && (fences.empty() || fwrite(&fences[0], 1, fences.size(), out) == fences.size());
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    ok = fclose(out) == 0 && ok;
+    if (ok == false || rename(tmp.c_str(), path.c_str()) != 0) {
+        ::remove(tmp.c_str());
+        throw DBIndexException("writing snapshot " + path + " failed");
+    }
+    if (syncDirectory(path) == false)
+        throw DBIndexException("syncing directory of snapshot " + path + " failed");
+}
+
+/**
+ * Vergleicht zwei gespeicherte Schluessel: <0, 0 oder >0.
+ * DOUBLE wie die Suchkerne von DBMyIndex (_CMP_LT_OQ/_CMP_LE_OQ): ist NaN beteiligt, ist a
+ * weder kleiner noch gleich b, das Ergebnis ist dann >0. Ein NaN-Schluessel wird so wie im
+ * Baum nie gefunden und verschiebt weder Zaun- noch Binaersuche.
+ */
+int DBMyIndexSnapshot::compare(const char *a, const char *b) const {
+    if (attrType == INT) {
+        int x, y;
+        memcpy(&x, a, sizeof(int));
+        memcpy(&y, b, sizeof(int));
+        return x < y ? -1 : (y < x ? 1 : 0);
+    }
+    if (attrType == DOUBLE) {
+        double x, y;
+        memcpy(&x, a, sizeof(double));
+        memcpy(&y, b, sizeof(double));
+        return x < y ? -1 : (x == y ? 0 : 1);
+    }
+    return strncmp(a, b, header.keySize);
+}
+
+/**
+ * Erste Position in [begin, end), deren Schluessel nicht kleiner als key ist
+ */
+uint64_t DBMyIndexSnapshot::lower_key(uint64_t begin, uint64_t end, const char *key) const {
+    while (begin < end) {
+        uint64_t mid = begin + (end - begin) / 2;
+        if (compare(keyArea + mid * header.keySize, key) < 0)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
+}
+
+/**
+ * Sucht val und gibt die TIDs (bei nicht eindeutigem Index in Heap-Reihenfolge) zurueck
+ */
+void DBMyIndexSnapshot::find(const DBAttrType &val, DBListTID &tids) {
+    LOG4CXX_INFO(logger, "find()");
+    LOG4CXX_DEBUG(logger, "val:\n" + val.toString("\t"));
+    tids.clear();
+    if (header.keyCount == 0)
+        return;
+
+    //Suchschluessel je Aufruf, nicht in der Instanz: gleichzeitige Suchen teilen sie sich
+    char local[probeStackBytes];
+    vector<char> heap;
+    char *probe = local;
+    if (keySize > probeStackBytes) {
+        heap.resize(keySize);
+        probe = &heap[0];
+    }
+    memset(probe, 0, keySize);
+    val.write(probe);
+
+    //letzter Zaun <= val bestimmt den Abschnitt; ist val kleiner als alle Zaeune, ist er nicht enthalten
+    uint64_t lo = 0, hi = header.fenceCount;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (compare(fenceArea + mid * header.keySize, probe) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return;
+    uint64_t begin = (lo - 1) * fenceStride;
+    uint64_t end = min(begin + fenceStride, header.keyCount);
+    uint64_t pos = lower_key(begin, end, probe);
+    if (pos == end || compare(keyArea + pos * header.keySize, probe) != 0)
+        return;
+
+    uint64_t first = pos, last = pos + 1;
+    if (unique == false) {
+        memcpy(&first, startArea + pos * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&last, startArea + (pos + 1) * sizeof(uint64_t), sizeof(uint64_t));
+    }
+    for (uint64_t i = first; i < last; ++i) {
+        TID tid;
+        tid.read(tidArea + i * sizeof(TID));
+        tids.push_back(tid);
+    }
+}
+
+/**
+ * Snapshots werden nur mit DBMyIndex::writeSnapshot() erzeugt
+ */
+void DBMyIndexSnapshot::initializeIndex() {
+    throw DBIndexException("snapshot index is read-only");
+}
+
+void DBMyIndexSnapshot::insert(const DBAttrType &val, const TID &tid) {
+    throw DBIndexException("snapshot index is read-only");
+}
+
+void DBMyIndexSnapshot::remove(const DBAttrType &val, const DBListTID &tid) {
+    throw DBIndexException("snapshot index is read-only");
+}
+
+/**
+ * Ein Snapshot fixt keine Bloecke
+ */
+void DBMyIndexSnapshot::unfixBACBs(bool setDirty) {
+}
+
+/**
+ * Fuegt createDBMyIndexSnapshot zur globalen factory method-map hinzu
+ */
+int DBMyIndexSnapshot::registerClass() {
+    setClassForName("DBMyIndexSnapshot", createDBMyIndexSnapshot);
+    return 0;
+}
+
+/**
+ * Gerufen von HubDB::Types::getClassForName von DBTypes, um DBIndex zu erstellen
+ * - DBBufferMgr *: Buffermanager
+ * - DBFile *: Dateiobjekt
+ * - attrType: Attributtp
+ * - ModeType: READ, WRITE
+ * - bool: unique Indexattribut
+ */
+extern "C" void *createDBMyIndexSnapshot(int nArgs, va_list ap) {
+    // Genau 5 Parameter
+    if (nArgs != 5) {
+        throw DBException("Invalid number of arguments");
+    }
+    DBBufferMgr *bufMgr = va_arg(ap, DBBufferMgr *);
+    DBFile *file = va_arg(ap, DBFile *);
+    enum AttrTypeEnum attrType = (enum AttrTypeEnum) va_arg(ap, int);
+    ModType m = (ModType) va_arg(ap, int);
+    bool unique = (bool) va_arg(ap, int);
+    return new DBMyIndexSnapshot(*bufMgr, *file, attrType, m, unique);
+}
@@ -0,0 +1,272 @@
+/**
+ * Latenzhistogramme fuer Index- und Pufferoperationen (DBMyIndex::find/insert/remove,
+ * DBMyBufferMgr::fixBlock).
+ *
+ * Eine Reihe (series()) wird einmal angemeldet, z.B. beim Oeffnen eines Indexes; danach traegt
+ * record() nur noch in das Histogramm des aufrufenden Threads ein: keine Sperre, keine
+ * Lese-Schreib-Operation auf gemeinsam geschriebenen Zaehlern (nur dieser Thread schreibt,
+ * snapshot() liest). Beim Ende eines Threads werden seine Histogramme in die der Reihe
+ * (registry::series) uebernommen.
+ *
+ * Klassen: Wert v < subBuckets hat Klasse v. Sonst ist e die Position des hoechsten Bits und
+ * die Klasse (e - subBits + 1) * subBuckets + die subBits Bits unter dem hoechsten.
+ */
+
+
+#include <hubDB/DBMyLatency.h>
+#include <hubDB/DBException.h>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+using namespace HubDB::Manager;
+using namespace HubDB::Exception;
+
+LoggerPtr DBMyLatency::logger(Logger::getLogger("HubDB.Manager.DBMyLatency"));
+atomic<bool> DBMyLatency::enabled(false);
+
+/**
+ * Leeres Histogramm
+ */
+DBMyLatencyHistogram::DBMyLatencyHistogram() :
+        counts(bucketCount, 0), total(0), sum(0), minimum(ULLONG_MAX), maximum(0) {
+}
+
+void DBMyLatencyHistogram::record(uint64_t nanos) {
+    counts[bucket(nanos)] += 1;
+    total += 1;
+    sum += nanos;
+    minimum = std::min(minimum, nanos);
+    maximum = std::max(maximum, nanos);
+}
+
+void DBMyLatencyHistogram::merge(const DBMyLatencyHistogram &other) {
+    for (uint i = 0; i < bucketCount; ++i)
+        counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+}
+
+/**
+ * Wert, unter dem der Anteil q (0..1) der Messungen liegt: obere Grenze seiner Klasse,
+ * hoechstens das gemessene Maximum
+ */
+uint64_t DBMyLatencyHistogram::percentile(double q) const {
+    if (total == 0)
+        return 0;
+    uint64_t rank = (uint64_t) ceil(std::max(std::min(q, 1.0), 0.0) * total);
+    rank = std::max(rank, (uint64_t) 1);
+    uint64_t seen = 0;
+    for (uint i = 0; i < bucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return std::min(bucketLimit(i), maximum);
+    }
+    return maximum;
+}
+
+string DBMyLatencyHistogram::toString(string linePrefix) const {
+    stringstream ss;
+    ss << linePrefix << "count: " << count() << " min: " << min() << " mean: " << (uint64_t) mean()
+       << " p50: " << percentile(0.5) << " p90: " << percentile(0.9) << " p99: " << percentile(0.99)
+       << " p99.9: " << percentile(0.999) << " max: " << max() << " (ns)" << endl;
+    return ss.str();
+}
+
+uint DBMyLatencyHistogram::bucket(uint64_t nanos) {
+    if (nanos < subBuckets)
+        return nanos;
+    uint magnitude = 63 - __builtin_clzll(nanos);
+    if (magnitude >= maxMagnitude)
+        return bucketCount - 1;
+    uint shift = magnitude - subBits;
+    return (shift + 1) * subBuckets + ((nanos >> shift) & (subBuckets - 1));
+}
+
+/**
+ * Groesster Wert der Klasse bucket
+ */
+uint64_t DBMyLatencyHistogram::bucketLimit(uint bucket) {
+    if (bucket < subBuckets)
+        return bucket;
+    uint shift = bucket / subBuckets - 1;
+    uint64_t lower = (uint64_t) (subBuckets + bucket % subBuckets) << shift;
+    return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+DBMyLatency::live_histogram::live_histogram() {
+    clear();
+}
+
+void DBMyLatency::live_histogram::clear() {
+    for (uint i = 0; i < DBMyLatencyHistogram::bucketCount; ++i)
+        counts[i].store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    minimum.store(ULLONG_MAX, memory_order_relaxed);
+    maximum.store(0, memory_order_relaxed);
+}
+
+/**
+ * Addiert den aktuellen Stand zu histogram; die Anzahl ergibt sich aus den Klassen, so passen
+ * Anzahl und Perzentile zusammen, auch wenn der Thread gerade schreibt
+ */
+void DBMyLatency::live_histogram::add_to(DBMyLatencyHistogram &histogram) const {
+    for (uint i = 0; i < DBMyLatencyHistogram::bucketCount; ++i) {
+        uint64_t n = counts[i].load(memory_order_relaxed);
+        histogram.counts[i] += n;
+        histogram.total += n;
+    }
+    histogram.sum += sum.load(memory_order_relaxed);
+    histogram.minimum = std::min(histogram.minimum, minimum.load(memory_order_relaxed));
+    histogram.maximum = std::max(histogram.maximum, maximum.load(memory_order_relaxed));
+}
+
+DBMyLatency::recorder::recorder() {
+    for (uint i = 0; i < maxSeries; ++i)
+        slots[i].store(NULL, memory_order_relaxed);
+    registry &reg = shared();
+    lock_guard<mutex> guard(reg.lock);
+    reg.recorders.insert(this);
+}
+
+DBMyLatency::recorder::~recorder() {
+    registry &reg = shared();
+    lock_guard<mutex> guard(reg.lock);
+    reg.recorders.erase(this);
+    for (uint i = 0; i < maxSeries; ++i) {
+        live_histogram *h = slots[i].load(memory_order_relaxed);
+        if (h == NULL)
+            continue;
+        h->add_to(reg.series[i].histogram);
+        delete h;
+    }
+}
+
+/**
+ * Histogramme des aufrufenden Threads
+ */
+DBMyLatency::recorder &DBMyLatency::local() {
+    static thread_local recorder r;
+    return r;
+}
+
+/**
+ * Gemeinsamer Teil; beim ersten Gebrauch angelegt und nie freigegeben, damit Reihen auch
+ * waehrend der Initialisierung bzw. Zerstoerung anderer statischer Objekte benutzbar sind
+ */
+DBMyLatency::registry &DBMyLatency::shared() {
+    static registry *reg = new registry();
+    return *reg;
+}
+
+/**
+ * Nummer der Reihe (operation, name, outcome); dieselbe Reihe bekommt immer dieselbe Nummer.
+ * Sind maxSeries Reihen angemeldet, noSeries: record() ignoriert sie.
+ */
+uint DBMyLatency::series(const string &operation, const string &name, const string &outcome) {
+    registry &reg = shared();
+    lock_guard<mutex> guard(reg.lock);
+    for (uint i = 0; i < reg.series.size(); ++i) {
+        if (reg.series[i].operation == operation && reg.series[i].name == name && reg.series[i].outcome == outcome)
+            return i;
+    }
+    if (reg.series.size() >= maxSeries) {
+        LOG4CXX_WARN(logger, "too many latency series, ignoring " + operation + " " + name);
+        return noSeries;
+    }
+    Snapshot s;
+    s.operation = operation;
+    s.name = name;
+    s.outcome = outcome;
+    reg.series.push_back(s);
+    return reg.series.size() - 1;
+}
+
+/**
+ * Schaltet die Messung fuer alle Reihen ein oder aus; bisherige Werte bleiben erhalten
+ */
+void DBMyLatency::setEnabled(bool enable) {
+    LOG4CXX_INFO(logger, "setEnabled()");
+    LOG4CXX_DEBUG(logger, "enable: " + TO_STR(enable));
+    enabled.store(enable);
+}
+
+/**
+ * Traegt nanos in das Histogramm der Reihe series des aufrufenden Threads ein
+ */
+void DBMyLatency::record(uint series, uint64_t nanos) {
+    if (series >= maxSeries)
+        return;
+    recorder &r = local();
+    live_histogram *h = r.slots[series].load(memory_order_relaxed);
+    if (h == NULL) {
+        h = new live_histogram();
+        r.slots[series].store(h, memory_order_release);
+    }
+    atomic<uint64_t> &count = h->counts[DBMyLatencyHistogram::bucket(nanos)];
+    count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    h->sum.store(h->sum.load(memory_order_relaxed) + nanos, memory_order_relaxed);
+    if (nanos < h->minimum.load(memory_order_relaxed))
+        h->minimum.store(nanos, memory_order_relaxed);
+    if (nanos > h->maximum.load(memory_order_relaxed))
+        h->maximum.store(nanos, memory_order_relaxed);
+}
+
+/**
+ * Stand aller Reihen mit mindestens einer Messung, ueber alle Threads zusammengefasst
+ */
+vector<DBMyLatency::Snapshot> DBMyLatency::snapshot() {
+    registry &reg = shared();
+    lock_guard<mutex> guard(reg.lock);
+    vector<Snapshot> result;
+    for (uint i = 0; i < reg.series.size(); ++i) {
+        Snapshot s = reg.series[i];
+        for (set<recorder *>::iterator it = reg.recorders.begin(); it != reg.recorders.end(); ++it) {
+            live_histogram *h = (*it)->slots[i].load(memory_order_acquire);
+            if (h != NULL)
+                h->add_to(s.histogram);
+        }
+        if (s.histogram.count() > 0)
+            result.push_back(s);
+    }
+    return result;
+}
+
+/**
+ * Setzt alle Histogramme zurueck. Laufende Eintragungen anderer Threads koennen dabei
+ * einzelne Werte behalten.
+ */
+void DBMyLatency::reset() {
+    LOG4CXX_INFO(logger, "reset()");
+    registry &reg = shared();
+    lock_guard<mutex> guard(reg.lock);
+    for (uint i = 0; i < reg.series.size(); ++i) {
+        reg.series[i].histogram = DBMyLatencyHistogram();
+        for (set<recorder *>::iterator it = reg.recorders.begin(); it != reg.recorders.end(); ++it) {
+            live_histogram *h = (*it)->slots[i].load(memory_order_acquire);
+            if (h != NULL)
+                h->clear();
+        }
+    }
+}
+
+/**
+ * Ausgabe aller Reihen; wird nirgends automatisch aufgerufen (auch nicht vom DBMonitorMgr)
+ */
+string DBMyLatency::report(string linePrefix) {
+    vector<Snapshot> all = snapshot();
+    stringstream ss;
+    ss << linePrefix << "[DBMyLatency]" << endl;
+    for (uint i = 0; i < all.size(); ++i) {
+        ss << linePrefix << all[i].operation;
+        if (all[i].name.empty() == false)
+            ss << " " << all[i].name;
+        if (all[i].outcome.empty() == false)
+            ss << " " << all[i].outcome;
+        ss << endl << all[i].histogram.toString(linePrefix + "\t");
+    }
+    ss << linePrefix << "-----------" << endl;
+    return ss.str();
+}
@@ -0,0 +1,1436 @@
+/**
+ * Kommandozeilenprogramm mit Verhaltenstests fuer DBMyIndex und die Indexe daneben. Jeder Test
+ * legt seine Dateien im aktuellen Verzeichnis an und loescht sie danach; je Test eine Zeile
+ * "ok name" bzw. "FAILED name: Grund" auf stdout, Meldungen (ab WARN) auf stderr. Rueckgabe 1,
+ * wenn ein Test scheitert.
+ *
+ * Aufruf: DBTest [Test ...]   (ohne Argument alle)
+ * - batch: insertBatch() in Stapeln ergibt dieselben TIDs wie einzelne Einfuegungen
+ * - remove: Loeschen mit Ausgleich und Verschmelzen laesst keinen Knoten unterbelegt, frei
+ *   gewordene Bloecke werden wieder benutzt
+ * - varchar: VARCHAR-Schluessel mit langen gemeinsamen Praefixen werden nach Splits und
+ *   Loeschen wieder genau gefunden, Praefixe vorhandener Schluessel nicht
+ * - postings: Posting-Listen nicht eindeutiger Schluessel, auch ueber Ueberlaufbloecke, beim
+ *   Wachsen und Schrumpfen
+ * - hash_index: Splits des Verzeichnisses und Ueberlaufketten von DBMyHashIndex
+ * - find_batch: findBatch() liefert je Suchschluessel dieselben TIDs wie find()
+ * - composite: zusammengesetzte Schluessel (INT, VARCHAR) mit mitgespeicherten Attributen,
+ *   findCovered() liefert diese ohne Tabelle
+ * - insert_buffer: Suchen und Loeschen sehen gepufferte Einfuegungen, Duplikate im Puffer
+ *   werden abgewiesen, Leeren und Ausschalten schreiben alles in den Baum
+ * - filter: mit Bloom-Filter lesen Suchen fehlender Schluessel fast nie eine Seite, vorhandene
+ *   und spaeter eingefuegte Schluessel werden immer gefunden
+ * - append: aufsteigend eingefuegte Schluessel fuellen die Blaetter deutlich dichter als
+ *   dieselben Schluessel in zufaelliger Reihenfolge
+ * - build: build() mit mehreren Threads und ausgelagerten Laeufen ergibt einen vollstaendigen
+ *   Baum, ein zweiter Aufbau wird abgewiesen
+ * - format: VARCHAR-Schluessel verschiedener Laenge ueberstehen das erneute Oeffnen, ein
+ *   Index mit fremder Knotenformat-Version wird abgewiesen
+ * - snapshot: writeSnapshot() und DBMyIndexSnapshot liefern dieselben TIDs wie der Baum,
+ *   eine beschaedigte Snapshot-Datei wird abgewiesen
+ * - counted: rank(), select() und count() im gezaehlten Baum gegen eine sortierte Liste
+ * - concurrent: gleichzeitige Einfuegungen und Suchen mehrerer Threads auf einer Instanz
+ * - key_cache: wiederholte Suchen treffen den Schluesselcache, nach Einfuegen und Loeschen
+ *   liefert find() nie ein veraltetes Ergebnis
+ * - find_each: findEach() und findSpan() liefern dieselben TIDs wie find(), auch aus
+ *   Ueberlaufbloecken, und ein Abbruch durch die Senke beendet die Suche
+ * - redo_log: Absturz waehrend Einfuegungen mit Splits (Kindprozess, SIGKILL) und Oeffnen
+ *   danach; der Baum muss stimmen und jede bestaetigte Einfuegung enthalten sein, der
+ *   Einfuegepuffer wird bei eingeschaltetem Log abgewiesen
+ */
+
+
+#include <hubDB/DBMyIndex.h>
+#include <hubDB/DBMyIndexSnapshot.h>
+#include <hubDB/DBMyBufferMgr.h>
+#include <hubDB/DBException.h>
+#include <hubDB/DBMyHashIndex.h>
+#include <hubDB/DBMyCompositeKey.h>
+#include <hubDB/DBMyLatency.h>
+#include <log4cxx/basicconfigurator.h>
+#include <log4cxx/consoleappender.h>
+#include <log4cxx/simplelayout.h>
+#include <log4cxx/level.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace HubDB::Index;
+using namespace HubDB::Manager;
+using namespace HubDB::Exception;
+using namespace log4cxx;
+
+// Pufferbloecke der Tests; klein, damit der Puffermanager verdraengen muss
+const uint testPoolBlocks = 64;
+
+/**
+ * Verletzte Erwartung eines Tests
+ */
+static void check(bool condition, const string &what) {
+    if (condition == false)
+        throw runtime_error(what);
+}
+
+/**
+ * Neue, leere Datei name; Reste eines abgebrochenen Laufs werden ersetzt
+ */
+static DBFile &create_file(DBBufferMgr &bufMgr, const string &name) {
+    try {
+        bufMgr.dropFile(name);
+    } catch (DBException &e) {}
+    unlink((name + ".wal").c_str());
+    unlink((name + ".snap").c_str());
+    bufMgr.createFile(name);
+    return bufMgr.openFile(name);
+}
+
+/**
+ * Schliesst und loescht file samt Redo-Log und Snapshot
+ */
+static void drop_file(DBBufferMgr &bufMgr, DBFile &file) {
+    string name = file.getFileName();
+    unlink(DBMyIndex::logName(file).c_str());
+    unlink(DBMyIndexSnapshot::snapshotName(file).c_str());
+    bufMgr.closeFile(file);
+    bufMgr.dropFile(name);
+}
+
+/**
+ * k-ter VARCHAR-Schluessel; die Reihenfolge der Schluessel entspricht der von k
+ */
+static DBAttrType *vchar_key(uint k) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "k%010u", k);
+    return new DBVCharType(buf);
+}
+
+static TID make_tid(uint page, uint slot) {
+    TID tid;
+    tid.page = page;
+    tid.slot = slot;
+    return tid;
+}
+
+static bool contains(const DBListTID &tids, const TID &tid) {
+    for (DBListTID::const_iterator it = tids.begin(); it != tids.end(); ++it) {
+        if (it->page == tid.page && it->slot == tid.slot)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * found enthaelt genau die TIDs von expected; what nennt die Suche in der Meldung
+ */
+static void check_same(const DBListTID &expected, const DBListTID &found, const string &what) {
+    check(found.size() == expected.size(), what + " returned " + TO_STR(found.size()) + " instead of "
+                                           + TO_STR(expected.size()) + " TIDs");
+    for (DBListTID::const_iterator it = expected.begin(); it != expected.end(); ++it)
+        check(contains(found, *it), what + " misses a TID");
+}
+
+/**
+ * Baum ohne verletzte Strukturinvarianten
+ */
+static void check_structure(DBMyIndex &index) {
+    DBMyIndex::Statistics stats = index.inspect();
+    check(stats.violations.empty(), "tree violates its invariants: " + (stats.violations.empty() ? string("")
+                                                                                                 : stats.violations.front()));
+}
+
+/**
+ * Stapel mit doppelten Schluesseln ueber insertBatch() in die eine, dieselben Paare einzeln in
+ * die andere Datei eines nicht eindeutigen Indexes
+ */
+static void test_batch() {
+    const uint pairs = 4000, keys = 1500, batchSize = 700;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &batchFile = create_file(bufMgr, "test_batch");
+    DBFile &singleFile = create_file(bufMgr, "test_batch_single");
+    DBMyIndex *batched = NULL, *single = NULL;
+    vector<pair<DBAttrType *, TID> > entries;
+    try {
+        batched = new DBMyIndex(bufMgr, batchFile, INT, WRITE, false);
+        single = new DBMyIndex(bufMgr, singleFile, INT, WRITE, false);
+        mt19937 random(4);
+        for (uint i = 0; i < pairs; ++i) {
+            uint k = random() % keys;
+            entries.push_back(make_pair(new DBIntType(k), make_tid(i, k % 5)));
+            single->insert(*entries.back().first, entries.back().second);
+            if (entries.size() < batchSize && i + 1 < pairs)
+                continue;
+            batched->insertBatch(entries);
+            for (uint e = 0; e < entries.size(); ++e)
+                delete entries[e].first;
+            entries.clear();
+        }
+        DBListTID expected, found;
+        for (uint k = 0; k <= keys; ++k) {
+            expected.clear();
+            found.clear();
+            single->find(DBIntType(k), expected);
+            batched->find(DBIntType(k), found);
+            check_same(expected, found, "batched key " + TO_STR(k));
+        }
+        check_structure(*batched);
+        check(batched->inspect().entries == single->inspect().entries, "batch and single inserts differ in keys");
+    } catch (...) {
+        for (uint e = 0; e < entries.size(); ++e)
+            delete entries[e].first;
+        delete batched;
+        delete single;
+        drop_file(bufMgr, batchFile);
+        drop_file(bufMgr, singleFile);
+        throw;
+    }
+    delete batched;
+    delete single;
+    drop_file(bufMgr, batchFile);
+    drop_file(bufMgr, singleFile);
+}
+
+/**
+ * Eindeutiger INT-Index: drei Viertel der Schluessel in zufaelliger Reihenfolge loeschen, die
+ * geloeschten wieder einfuegen, danach alle loeschen
+ */
+static void test_remove() {
+    const uint keys = 6000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_remove");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, true);
+        vector<uint> order;
+        for (uint k = 0; k < keys; ++k) {
+            index->insert(DBIntType(k), make_tid(k, 3));
+            order.push_back(k);
+        }
+        shuffle(order.begin(), order.end(), mt19937(5));
+        DBListTID removed, tids;
+        for (uint i = 0; i < keys / 4 * 3; ++i) {
+            removed.clear();
+            removed.push_back(make_tid(order[i], 3));
+            index->remove(DBIntType(order[i]), removed);
+        }
+        DBMyIndex::Statistics stats = index->inspect();
+        check(stats.violations.empty() && stats.underfullNodes == 0,
+              "tree after removes: " + TO_STR(stats.underfullNodes) + " underfull nodes, "
+              + TO_STR(stats.violations.size()) + " violations");
+        check(stats.entries == keys - keys / 4 * 3, "tree holds " + TO_STR(stats.entries) + " keys after removes");
+        check(stats.freeBlocks > 0, "merged nodes were not put on the free list");
+        for (uint i = 0; i < keys; ++i) {
+            tids.clear();
+            index->find(DBIntType(order[i]), tids);
+            check(tids.size() == (i < keys / 4 * 3 ? 0u : 1u), "key " + TO_STR(order[i]) + " wrong after removes");
+        }
+
+        uint blocks = bufMgr.getBlockCnt(file);
+        for (uint i = 0; i < keys / 4; ++i)
+            index->insert(DBIntType(order[i]), make_tid(order[i], 3));
+        check(index->inspect().freeBlocks < stats.freeBlocks, "splits did not reuse free blocks");
+        //die Datei waechst erst, wenn die Freiliste leer ist
+        check(bufMgr.getBlockCnt(file) == blocks || index->inspect().freeBlocks == 0,
+              "file grew while free blocks were left");
+        check_structure(*index);
+
+        //im Baum stehen jetzt das erste und das letzte Viertel von order
+        for (uint i = 0; i < keys; ++i) {
+            if (i == keys / 4)
+                i = keys / 4 * 3;
+            removed.clear();
+            removed.push_back(make_tid(order[i], 3));
+            index->remove(DBIntType(order[i]), removed);
+        }
+        stats = index->inspect();
+        check(stats.violations.empty() && stats.entries == 0 && stats.height == 1,
+              "tree not empty after removing every key");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// varchar: "rNN" (digits == 0) bzw. "rNN/c" mit customer in digits Ziffern
+static DBAttrType *region_key(uint region, uint customer, uint digits) {
+    char buf[32];
+    if (digits == 0)
+        snprintf(buf, sizeof(buf), "r%02u", region);
+    else
+        snprintf(buf, sizeof(buf), "r%02u/c%0*u", region, (int) digits, customer);
+    return new DBVCharType(buf);
+}
+
+/**
+ * VARCHAR-Schluessel "rNN/cNNNNNNN" (gerade Nummern) und "rNN" je Region; gesucht werden alle,
+ * die ungeraden Nummern und die um eine Ziffer gekuerzten Schluessel
+ */
+static void test_varchar() {
+    const uint regions = 4, customers = 1200;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_varchar");
+    DBMyIndex *index = NULL;
+    DBAttrType *key = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, VCHAR, WRITE, true);
+        for (uint r = 0; r < regions; ++r) {
+            key = region_key(r, 0, 0);
+            index->insert(*key, make_tid(r, 0));
+            delete key;
+            for (uint c = 0; c < customers; c += 2) {
+                key = region_key(r, c, 7);
+                index->insert(*key, make_tid(r * customers + c, 1));
+                delete key;
+            }
+        }
+        key = NULL;
+        //jede zehnte gerade Nummer wieder loeschen, die Praefixe der Knoten aendern sich dabei
+        DBListTID tids;
+        for (uint r = 0; r < regions; ++r) {
+            for (uint c = 0; c < customers; c += 20) {
+                tids.clear();
+                tids.push_back(make_tid(r * customers + c, 1));
+                key = region_key(r, c, 7);
+                index->remove(*key, tids);
+                delete key;
+            }
+        }
+        key = NULL;
+        check_structure(*index);
+
+        for (uint r = 0; r < regions; ++r) {
+            tids.clear();
+            key = region_key(r, 0, 0);
+            index->find(*key, tids);
+            delete key;
+            key = NULL;
+            check(tids.size() == 1 && contains(tids, make_tid(r, 0)), "short key of region " + TO_STR(r) + " lost");
+            for (uint c = 0; c < customers; ++c) {
+                bool present = c % 2 == 0 && c % 20 != 0;
+                tids.clear();
+                key = region_key(r, c, 7);
+                index->find(*key, tids);
+                delete key;
+                key = NULL;
+                string name = "key r" + TO_STR(r) + "/c" + TO_STR(c);
+                check(tids.size() == (present ? 1u : 0u), name + " returned " + TO_STR(tids.size()) + " TIDs");
+                check(present == false || contains(tids, make_tid(r * customers + c, 1)), name + " has a wrong TID");
+                tids.clear();
+                key = region_key(r, c / 10, 6);
+                index->find(*key, tids);
+                delete key;
+                key = NULL;
+                check(tids.empty(), "prefix of a key found for r" + TO_STR(r) + "/c" + TO_STR(c / 10));
+            }
+        }
+    } catch (...) {
+        delete key;
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Nicht eindeutiger INT-Index: ein Schluessel mit so vielen TIDs, dass seine Liste in
+ * Ueberlaufbloecke ausweicht, einer mit kurzer Liste und Nachbarn mit einer TID
+ */
+static void test_postings() {
+    const uint hot = 7, many = 3000, few = 20;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_postings");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        for (uint k = 0; k < 50; ++k) {
+            if (k != hot && k != hot + 1)
+                index->insert(DBIntType(k), make_tid(k, 0));
+        }
+        //Seiten gestreut, damit die Differenzen verschieden lang kodiert werden
+        for (uint t = 0; t < many; ++t)
+            index->insert(DBIntType(hot), make_tid((t * 7919) % 100000, t % 3));
+        for (uint t = 0; t < few; ++t)
+            index->insert(DBIntType(hot + 1), make_tid(t, 1));
+        check(index->inspect().overflowBlocks > 0, "long posting list did not move to overflow blocks");
+        check_structure(*index);
+
+        DBListTID tids, removed;
+        index->find(DBIntType(hot), tids);
+        check(tids.size() == many, "long posting list returned " + TO_STR(tids.size()) + " TIDs");
+        for (uint t = 0; t < many; t += 101)
+            check(contains(tids, make_tid((t * 7919) % 100000, t % 3)), "TID " + TO_STR(t) + " missing");
+        tids.clear();
+        index->find(DBIntType(hot + 1), tids);
+        check(tids.size() == few, "short posting list returned " + TO_STR(tids.size()) + " TIDs");
+
+        for (uint t = 0; t < many; t += 2)
+            removed.push_back(make_tid((t * 7919) % 100000, t % 3));
+        index->remove(DBIntType(hot), removed);
+        tids.clear();
+        index->find(DBIntType(hot), tids);
+        check(tids.size() == many - removed.size(), "shrunk posting list returned " + TO_STR(tids.size()));
+        check(contains(tids, make_tid(0, 0)) == false && contains(tids, make_tid(7919, 1)), "wrong TIDs removed");
+        check_structure(*index);
+
+        removed.clear();
+        for (uint t = 1; t < many; t += 2)
+            removed.push_back(make_tid((t * 7919) % 100000, t % 3));
+        index->remove(DBIntType(hot), removed);
+        tids.clear();
+        index->find(DBIntType(hot), tids);
+        check(tids.empty(), "emptied posting list returned " + TO_STR(tids.size()) + " TIDs");
+        check(index->inspect().overflowBlocks == 0, "overflow blocks of an emptied posting list are left");
+        check_structure(*index);
+        for (uint k = 0; k < 50; ++k) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            check(tids.size() == (k == hot ? 0 : k == hot + 1 ? few : 1), "key " + TO_STR(k) + " wrong");
+        }
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Eindeutiger Index mit vielen Schluesseln (Splits, Verdopplung des Verzeichnisses) und nicht
+ * eindeutiger mit vielen TIDs eines Schluessels (gleicher Hashwert, Ueberlaufkette)
+ */
+static void test_hash_index() {
+    const uint keys = 5000, duplicates = 1500;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_hash_unique");
+    DBMyHashIndex *index = NULL;
+    try {
+        index = new DBMyHashIndex(bufMgr, file, INT, WRITE, true);
+        vector<uint> order;
+        for (uint k = 0; k < keys; ++k)
+            order.push_back(k);
+        shuffle(order.begin(), order.end(), mt19937(1));
+        for (uint i = 0; i < keys; ++i)
+            index->insert(DBIntType(order[i]), make_tid(order[i], 1));
+        bool rejected = false;
+        try {
+            index->insert(DBIntType(7), make_tid(99999, 1));
+        } catch (DBIndexUniqueKeyException &e) {
+            rejected = true;
+        }
+        check(rejected, "duplicate key accepted by unique hash index");
+        DBListTID tids;
+        for (uint k = 0; k < keys; ++k) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(k, 1)), "key " + TO_STR(k) + " lost after splits");
+        }
+        tids.clear();
+        index->find(DBIntType(keys), tids);
+        check(tids.empty(), "missing key found");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+
+    DBFile &chained = create_file(bufMgr, "test_hash_overflow");
+    index = NULL;
+    try {
+        index = new DBMyHashIndex(bufMgr, chained, INT, WRITE, false);
+        for (uint t = 0; t < duplicates; ++t)
+            index->insert(DBIntType(42), make_tid(t, 0));
+        for (uint k = 0; k < 100; ++k)
+            index->insert(DBIntType(1000 + k), make_tid(k, 1));
+        DBListTID tids;
+        index->find(DBIntType(42), tids);
+        check(tids.size() == duplicates, "overflow chain returned " + TO_STR(tids.size()) + " TIDs");
+        for (uint t = 0; t < duplicates; t += 97)
+            check(contains(tids, make_tid(t, 0)), "TID " + TO_STR(t) + " missing from overflow chain");
+
+        DBListTID removed;
+        for (uint t = 0; t < duplicates; t += 3)
+            removed.push_back(make_tid(t, 0));
+        index->remove(DBIntType(42), removed);
+        tids.clear();
+        index->find(DBIntType(42), tids);
+        check(tids.size() == duplicates - removed.size(), "remove from overflow chain left " + TO_STR(tids.size()));
+        check(contains(tids, make_tid(0, 0)) == false && contains(tids, make_tid(1, 0)), "wrong TIDs removed");
+        for (uint k = 0; k < 100; ++k) {
+            tids.clear();
+            index->find(DBIntType(1000 + k), tids);
+            check(tids.size() == 1, "key " + TO_STR(1000 + k) + " lost next to overflow chain");
+        }
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, chained);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, chained);
+}
+
+/**
+ * findBatch() mit unsortierten, doppelten und fehlenden Suchschluesseln gegen find(); der
+ * Baum ist so hoch, dass die Suchen verschraenkt ueber den Spiegel absteigen
+ */
+static void test_find_batch() {
+    const uint keys = 8000, probes = 3000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_find_batch");
+    DBMyIndex *index = NULL;
+    vector<const DBAttrType *> batch;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        for (uint k = 0; k < keys; k += 2) {
+            for (uint d = 0; d <= k % 4; d += 2)
+                index->insert(DBIntType(k), make_tid(k, d));
+        }
+        mt19937 random(6);
+        for (uint i = 0; i < probes; ++i)
+            batch.push_back(new DBIntType(random() % (keys + 10)));
+        vector<DBListTID> results;
+        index->findBatch(batch, results);
+        check(results.size() == batch.size(), "findBatch() returned " + TO_STR(results.size()) + " results");
+        DBListTID expected;
+        for (uint i = 0; i < batch.size(); ++i) {
+            expected.clear();
+            index->find(*batch[i], expected);
+            check_same(expected, results[i], "findBatch() probe " + TO_STR(i));
+        }
+    } catch (...) {
+        for (uint i = 0; i < batch.size(); ++i)
+            delete batch[i];
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    for (uint i = 0; i < batch.size(); ++i)
+        delete batch[i];
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// composite: Typen der Schluessel- und der mitgespeicherten Attribute
+static vector<AttrTypeEnum> composite_types(bool included) {
+    vector<AttrTypeEnum> types;
+    types.push_back(included ? DOUBLE : INT);
+    types.push_back(included ? INT : VCHAR);
+    return types;
+}
+
+/**
+ * Schluessel (a, "nBBB"); mit covered samt mitgespeicherten Attributen (a + b / 4.0, a * b)
+ */
+static DBMyCompositeKey *composite_key(uint a, uint b, bool covered) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "n%03u", b);
+    vector<DBAttrType *> keys, included;
+    keys.push_back(new DBIntType(a));
+    keys.push_back(new DBVCharType(buf));
+    if (covered) {
+        included.push_back(new DBDoubleType(a + b / 4.0));
+        included.push_back(new DBIntType(a * b));
+    }
+    return new DBMyCompositeKey(composite_types(false), composite_types(true), keys, included);
+}
+
+/**
+ * Eindeutiger Index ueber (INT, VARCHAR) mit (DOUBLE, INT) als mitgespeicherten Attributen:
+ * find() und findCovered() mit Suchschluesseln ohne diese, fehlende Schluessel, Duplikat
+ */
+static void test_composite() {
+    const uint as = 40, bs = 50;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_composite");
+    DBMyIndex *index = NULL;
+    DBMyCompositeKey *key = NULL;
+    vector<DBAttrType *> included;
+    try {
+        index = new DBMyIndex(bufMgr, file, composite_types(false), composite_types(true), WRITE, true);
+        //b absteigend, damit nicht nur am rechten Rand eingefuegt wird
+        for (uint a = 0; a < as; ++a) {
+            for (uint b = bs; b-- > 0;) {
+                key = composite_key(a, b, true);
+                index->insert(*key, make_tid(a, b));
+                delete key;
+                key = NULL;
+            }
+        }
+        check_structure(*index);
+        key = composite_key(3, 4, true);
+        bool rejected = false;
+        try {
+            index->insert(*key, make_tid(99, 99));
+        } catch (DBIndexUniqueKeyException &e) {
+            rejected = true;
+        }
+        delete key;
+        key = NULL;
+        check(rejected, "duplicate composite key accepted");
+
+        DBListTID tids;
+        for (uint a = 0; a <= as; ++a) {
+            for (uint b = 0; b <= bs; ++b) {
+                bool present = a < as && b < bs;
+                string name = "key (" + TO_STR(a) + ", " + TO_STR(b) + ")";
+                key = composite_key(a, b, false);
+                tids.clear();
+                index->find(*key, tids);
+                check(tids.size() == (present ? 1u : 0u), name + " returned " + TO_STR(tids.size()) + " TIDs");
+                check(present == false || contains(tids, make_tid(a, b)), name + " has a wrong TID in find()");
+                TID tid;
+                bool found = index->findCovered(*key, tid, included);
+                delete key;
+                key = NULL;
+                check(found == present, name + " wrong in findCovered()");
+                if (present == false)
+                    continue;
+                check(tid.page == a && tid.slot == b && included.size() == 2, name + " has a wrong TID");
+                check(included[0]->operator==(DBDoubleType(a + b / 4.0))
+                      && included[1]->operator==(DBIntType(a * b)), name + " has wrong included attributes");
+                for (uint i = 0; i < included.size(); ++i)
+                    delete included[i];
+                included.clear();
+            }
+        }
+    } catch (...) {
+        for (uint i = 0; i < included.size(); ++i)
+            delete included[i];
+        delete key;
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Eindeutiger INT-Index mit Einfuegepuffer: zuerst weniger Einfuegungen als seine Kapazitaet
+ * (der Baum bleibt leer), dann so viele, dass er sich selbst leert
+ */
+static void test_insert_buffer() {
+    const uint capacity = 1000, first = 600, removed = 100, keys = 2000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_insert_buffer");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, true);
+        index->setInsertBuffer(capacity);
+        for (uint k = 0; k < first; ++k)
+            index->insert(DBIntType(k), make_tid(k, 4));
+        check(index->inspect().entries == 0, "inserts reached the tree before the buffer was full");
+        bool rejected = false;
+        try {
+            index->insert(DBIntType(5), make_tid(5, 5));
+        } catch (DBIndexUniqueKeyException &e) {
+            rejected = true;
+        }
+        check(rejected, "duplicate of a buffered key accepted");
+
+        DBListTID tids;
+        for (uint k = 0; k < removed; ++k) {
+            tids.clear();
+            tids.push_back(make_tid(k, 4));
+            index->remove(DBIntType(k), tids);
+        }
+        for (uint k = 0; k <= first; ++k) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            bool present = k >= removed && k < first;
+            check(tids.size() == (present ? 1u : 0u), "buffered key " + TO_STR(k) + " returned "
+                                                      + TO_STR(tids.size()) + " TIDs");
+            check(present == false || contains(tids, make_tid(k, 4)), "buffered key " + TO_STR(k) + " wrong");
+        }
+        index->flushInsertBuffer();
+        check(index->inspect().entries == first - removed, "flush wrote " + TO_STR(index->inspect().entries)
+                                                            + " keys");
+
+        for (uint k = first; k < keys; ++k)
+            index->insert(DBIntType(k), make_tid(k, 4));
+        index->setInsertBuffer(0);
+        check(index->inspect().entries == keys - removed, "switching the buffer off left keys in it");
+        check_structure(*index);
+        for (uint k = removed; k < keys; ++k) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(k, 4)), "key " + TO_STR(k) + " lost");
+        }
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// filter: Anzahl der bisherigen fixBlock-Aufrufe aller Puffermanager (nur mit DBMyLatency)
+static uint64_t fixed_blocks() {
+    vector<DBMyLatency::Snapshot> series = DBMyLatency::snapshot();
+    uint64_t total = 0;
+    for (uint i = 0; i < series.size(); ++i) {
+        if (series[i].operation == "DBMyBufferMgr::fixBlock")
+            total += series[i].histogram.count();
+    }
+    return total;
+}
+
+/**
+ * Eindeutiger INT-Index mit den geraden Schluesseln und Filter (1% falsch positiv): die
+ * Suchen nach den ungeraden fixen zusammen weniger Bloecke als eine Suche je Schluessel
+ */
+static void test_filter() {
+    const uint keys = 4000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_filter");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, true);
+        for (uint k = 0; k < 2 * keys; k += 2)
+            index->insert(DBIntType(k), make_tid(k, 6));
+        index->setFilter(2 * keys, 0.01);
+
+        DBListTID tids;
+        DBMyLatency::setEnabled(true);
+        uint64_t before = fixed_blocks();
+        for (uint k = 1; k < 2 * keys; k += 2) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            check(tids.empty(), "missing key " + TO_STR(k) + " found");
+        }
+        uint64_t fixes = fixed_blocks() - before;
+        DBMyLatency::setEnabled(false);
+        check(fixes < keys / 10, "lookups of missing keys fixed " + TO_STR(fixes) + " blocks");
+
+        //keine falsch negativen Antworten, auch nach Einfuegen und Loeschen mit Filter
+        for (uint k = 1; k < keys; k += 2)
+            index->insert(DBIntType(k), make_tid(k, 6));
+        DBListTID removed;
+        for (uint k = 0; k < keys; k += 3) {
+            removed.clear();
+            removed.push_back(make_tid(k, 6));
+            index->remove(DBIntType(k), removed);
+        }
+        for (uint k = 0; k < 2 * keys; ++k) {
+            //unter keys alle Schluessel ausser den geloeschten, darueber die geraden
+            bool present = k < keys ? k % 3 != 0 : k % 2 == 0;
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            check(tids.size() == (present ? 1u : 0u), "key " + TO_STR(k) + " returned " + TO_STR(tids.size())
+                                                      + " TIDs with filter");
+        }
+        check_structure(*index);
+    } catch (...) {
+        DBMyLatency::setEnabled(false);
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Dieselben Schluessel aufsteigend (Anhaengen am rechten Rand) und gemischt in je einen
+ * eindeutigen INT-Index; Blaetter zaehlt inspect() auf der untersten Ebene
+ */
+static void test_append() {
+    const uint keys = 20000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &appendFile = create_file(bufMgr, "test_append");
+    DBFile &randomFile = create_file(bufMgr, "test_append_random");
+    DBMyIndex *appended = NULL, *mixed = NULL;
+    try {
+        appended = new DBMyIndex(bufMgr, appendFile, INT, WRITE, true);
+        mixed = new DBMyIndex(bufMgr, randomFile, INT, WRITE, true);
+        vector<uint> order;
+        for (uint k = 0; k < keys; ++k) {
+            appended->insert(DBIntType(k), make_tid(k, 7));
+            order.push_back(k);
+        }
+        shuffle(order.begin(), order.end(), mt19937(7));
+        for (uint i = 0; i < keys; ++i)
+            mixed->insert(DBIntType(order[i]), make_tid(order[i], 7));
+
+        DBMyIndex::Statistics dense = appended->inspect(), loose = mixed->inspect();
+        check(dense.violations.empty() && dense.entries == keys, "appended tree is broken");
+        uint denseLeaves = dense.nodesPerLevel.back(), looseLeaves = loose.nodesPerLevel.back();
+        check(denseLeaves * 10 < looseLeaves * 8, "appending used " + TO_STR(denseLeaves) + " leaves, random order "
+                                                  + TO_STR(looseLeaves));
+        DBListTID tids;
+        for (uint k = 0; k < keys; k += 7) {
+            tids.clear();
+            appended->find(DBIntType(k), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(k, 7)), "appended key " + TO_STR(k) + " lost");
+        }
+    } catch (...) {
+        delete appended;
+        delete mixed;
+        drop_file(bufMgr, appendFile);
+        drop_file(bufMgr, randomFile);
+        throw;
+    }
+    delete appended;
+    delete mixed;
+    drop_file(bufMgr, appendFile);
+    drop_file(bufMgr, randomFile);
+}
+
+// build: Tabelle mit den Paaren (i % keys, (i, 8)) fuer i < pairs, reihum auf die Partitionen verteilt
+class build_source : public DBMyIndexSource {
+public:
+    build_source(uint pairs, uint keys, uint parts) : pairs(pairs), keys(keys), positions(parts, 0) {};
+
+    uint partitionCount() { return positions.size(); };
+
+    bool next(uint part, DBAttrType *&key, TID &tid) {
+        uint i = positions[part]++ * positions.size() + part;
+        if (i >= pairs)
+            return false;
+        key = new DBIntType(i % keys);
+        tid = make_tid(i, 8);
+        return true;
+    };
+
+private:
+    uint pairs;
+    uint keys;
+    vector<uint> positions;
+};
+
+/**
+ * Nicht eindeutiger INT-Index aus 12000 Paaren, drei Threads mit so wenig Speicher, dass die
+ * Laeufe in temporaere Dateien ausgelagert werden
+ */
+static void test_build() {
+    const uint pairs = 12000, keys = 5000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_build");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        build_source source(pairs, keys, 7);
+        index->build(source, 3, 64 * 1024);
+        check_structure(*index);
+        check(index->inspect().entries == keys, "build() stored " + TO_STR(index->inspect().entries) + " keys");
+        DBListTID tids;
+        for (uint k = 0; k <= keys; ++k) {
+            tids.clear();
+            index->find(DBIntType(k), tids);
+            uint expected = 0;
+            for (uint i = k; i < pairs && k < keys; i += keys) {
+                check(contains(tids, make_tid(i, 8)), "key " + TO_STR(k) + " misses TID " + TO_STR(i));
+                expected += 1;
+            }
+            check(tids.size() == expected, "key " + TO_STR(k) + " returned " + TO_STR(tids.size()) + " TIDs");
+        }
+
+        bool rejected = false;
+        try {
+            build_source again(10, keys, 1);
+            index->build(again, 1, 64 * 1024);
+        } catch (DBIndexException &e) {
+            rejected = true;
+        }
+        check(rejected, "build() into a filled index accepted");
+        index->insert(DBIntType(keys), make_tid(pairs, 8));
+        check_structure(*index);
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * VARCHAR-Schluessel aus 2 bis 19 Zeichen in Seiten mit Slotverzeichnis, nach dem Schliessen
+ * neu geoeffnet; danach wird das Formatbyte der Wurzel veraendert
+ */
+static void test_format() {
+    const uint keys = 600;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_format");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, VCHAR, WRITE, true);
+        for (uint k = 0; k < keys; ++k)
+            index->insert(DBVCharType((string(1 + k % 16, 'a' + k % 26) + TO_STR(k)).c_str()), make_tid(k, 2));
+        delete index;
+        index = NULL;
+
+        index = new DBMyIndex(bufMgr, file, VCHAR, READ, true);
+        check_structure(*index);
+        DBListTID tids;
+        for (uint k = 0; k < keys; ++k) {
+            tids.clear();
+            index->find(DBVCharType((string(1 + k % 16, 'a' + k % 26) + TO_STR(k)).c_str()), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(k, 2)), "key " + TO_STR(k) + " lost after reopen");
+        }
+        delete index;
+        index = NULL;
+
+        //Block 0 enthaelt die TID der Wurzel, deren erstes Byte ist die Formatversion
+        DBBACB meta = bufMgr.fixBlock(file, 0, LOCK_SHARED);
+        TID root;
+        root.read(meta.getDataPtr());
+        bufMgr.unfixBlock(meta);
+        DBBACB node = bufMgr.fixBlock(file, root.page, LOCK_EXCLUSIVE);
+        node.getDataPtr()[0] = 1;
+        node.setModified();
+        bufMgr.unfixBlock(node);
+
+        bool rejected = false;
+        try {
+            index = new DBMyIndex(bufMgr, file, VCHAR, READ, true);
+        } catch (DBIndexException &e) {
+            rejected = true;
+        }
+        check(rejected, "index with an old node format was opened");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Snapshot eines nicht eindeutigen DOUBLE-Indexes gegen den Baum, auch fuer fehlende
+ * Schluessel und NaN; danach eine Snapshot-Datei mit falscher Startposition
+ */
+static void test_snapshot() {
+    const uint keys = 700;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_snapshot");
+    DBMyIndex *index = NULL;
+    DBMyIndexSnapshot *snapshot = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, DOUBLE, WRITE, false);
+        for (uint k = 0; k < keys; ++k) {
+            for (uint d = 0; d <= k % 3; ++d)
+                index->insert(DBDoubleType(k * 0.5), make_tid(k, d));
+        }
+        index->writeSnapshot();
+        snapshot = new DBMyIndexSnapshot(bufMgr, file, DOUBLE, READ, false);
+
+        DBListTID expected, found;
+        for (uint k = 0; k <= keys; ++k) {
+            for (uint half = 0; half < 2; ++half) {
+                DBDoubleType val(k * 0.5 + half * 0.25);
+                expected.clear();
+                found.clear();
+                index->find(val, expected);
+                snapshot->find(val, found);
+                check(found.size() == expected.size(), "snapshot returned " + TO_STR(found.size()) + " instead of "
+                                                       + TO_STR(expected.size()) + " TIDs for " + TO_STR(k));
+                for (DBListTID::const_iterator it = expected.begin(); it != expected.end(); ++it)
+                    check(contains(found, *it), "snapshot misses a TID of key " + TO_STR(k));
+            }
+        }
+        found.clear();
+        snapshot->find(DBDoubleType(nan("")), found);
+        check(found.empty(), "snapshot found NaN");
+        delete snapshot;
+        snapshot = NULL;
+
+        //Startposition des ersten Schluessels hinter die TIDs setzen; startsOffset steht im Kopf
+        //hinter Kennung, vier uint32_t und vier uint64_t (siehe DBMyIndexSnapshot::file_header)
+        int fd = ::open(DBMyIndexSnapshot::snapshotName(file).c_str(), O_RDWR);
+        check(fd >= 0, "can not open snapshot");
+        uint64_t startsOffset, bad = 1ULL << 40;
+        bool ok = pread(fd, &startsOffset, sizeof(uint64_t), 8 + 4 * sizeof(uint32_t) + 4 * sizeof(uint64_t))
+                  == sizeof(uint64_t) && pwrite(fd, &bad, sizeof(uint64_t), startsOffset + sizeof(uint64_t))
+                                         == sizeof(uint64_t);
+        close(fd);
+        check(ok, "can not modify snapshot");
+        bool rejected = false;
+        try {
+            snapshot = new DBMyIndexSnapshot(bufMgr, file, DOUBLE, READ, false);
+        } catch (DBIndexException &e) {
+            rejected = true;
+        }
+        check(rejected, "corrupt snapshot accepted");
+    } catch (...) {
+        delete snapshot;
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Heap-Reihenfolge der Tupel-TIDs
+ */
+static bool less_entry(const pair<int, TID> &a, const pair<int, TID> &b) {
+    if (a.first != b.first)
+        return a.first < b.first;
+    return a.second.page < b.second.page || (a.second.page == b.second.page && a.second.slot < b.second.slot);
+}
+
+/**
+ * select() jeder Position, rank() und count() jedes Schluessels gegen entries (sortiert)
+ */
+static void check_counts(DBMyIndex &index, const vector<pair<int, TID> > &entries, int maxKey) {
+    for (uint pos = 0; pos <= entries.size(); ++pos) {
+        DBAttrType *key = NULL;
+        TID tid;
+        bool found = index.select(pos, key, tid);
+        if (pos == entries.size()) {
+            delete key;
+            check(found == false, "select() behind the last entry succeeded");
+            break;
+        }
+        check(found, "select(" + TO_STR(pos) + ") failed");
+        bool same = key->operator==(DBIntType(entries[pos].first)) && tid.page == entries[pos].second.page
+                    && tid.slot == entries[pos].second.slot;
+        delete key;
+        check(same, "select(" + TO_STR(pos) + ") returned the wrong entry");
+    }
+    for (int k = -1; k <= maxKey + 1; ++k) {
+        pair<int, TID> probe(k, make_tid(0, 0));
+        uint below = lower_bound(entries.begin(), entries.end(), probe, less_entry) - entries.begin();
+        check(index.rank(DBIntType(k)) == below, "rank(" + TO_STR(k) + ") is wrong");
+        DBIntType lower(k), upper(k + 10);
+        probe.first = k + 11;
+        uint upto = lower_bound(entries.begin(), entries.end(), probe, less_entry) - entries.begin();
+        check(index.count(&lower, &upper) == upto - below, "count(" + TO_STR(k) + ", +10) is wrong");
+    }
+    check(index.count(NULL, NULL) == entries.size(), "count() of all entries is wrong");
+}
+
+static void test_counted() {
+    const uint tids = 3000, keys = 500;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_counted");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        vector<pair<int, TID> > entries;
+        vector<uint> order;
+        for (uint t = 0; t < tids; ++t)
+            order.push_back(t);
+        shuffle(order.begin(), order.end(), mt19937(2));
+        //die Haelfte vor dem Einschalten (recount()), die andere danach (Anzahlen auf dem Pfad)
+        for (uint i = 0; i < tids; ++i) {
+            if (i == tids / 2)
+                index->setCounted(true);
+            uint t = order[i];
+            index->insert(DBIntType(t % keys), make_tid(t, t % 7));
+            entries.push_back(make_pair((int) (t % keys), make_tid(t, t % 7)));
+        }
+        sort(entries.begin(), entries.end(), less_entry);
+        check_counts(*index, entries, keys);
+
+        //Loeschen bis zur Unterbelegung, Anzahlen nach Ausgleich und Verschmelzen
+        vector<pair<int, TID> > rest;
+        for (uint i = 0; i < entries.size(); ++i) {
+            if (entries[i].first % 4 == 0) {
+                rest.push_back(entries[i]);
+                continue;
+            }
+            DBListTID removed;
+            removed.push_back(entries[i].second);
+            index->remove(DBIntType(entries[i].first), removed);
+        }
+        check_counts(*index, rest, keys);
+        check_structure(*index);
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// concurrent: gemeinsamer Zustand der Threads
+struct concurrent_state {
+    DBMyIndex *index;
+    uint threads;
+    uint keysPerThread;
+    mutex errorMutex;
+    exception_ptr error;
+};
+
+/**
+ * Thread part fuegt die Schluessel k mit k % threads == part ein und sucht dazwischen eigene
+ * (muessen gefunden werden) und fremde Schluessel (hoechstens die richtige TID)
+ */
+static void concurrent_worker(concurrent_state &state, uint part) {
+    try {
+        mt19937 random(part + 3);
+        DBListTID tids;
+        for (uint i = 0; i < state.keysPerThread; ++i) {
+            uint k = i * state.threads + part;
+            state.index->insert(DBIntType(k), make_tid(k, 2));
+            uint own = (random() % (i + 1)) * state.threads + part;
+            tids.clear();
+            state.index->find(DBIntType(own), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(own, 2)), "own key " + TO_STR(own) + " not found");
+            uint other = random() % (state.keysPerThread * state.threads);
+            tids.clear();
+            state.index->find(DBIntType(other), tids);
+            check(tids.empty() || (tids.size() == 1 && contains(tids, make_tid(other, 2))),
+                  "key " + TO_STR(other) + " returned a wrong TID");
+        }
+    } catch (...) {
+        //Ausnahmen duerfen den Thread nicht verlassen
+        lock_guard<mutex> guard(state.errorMutex);
+        if (state.error == NULL)
+            state.error = current_exception();
+    }
+}
+
+static void test_concurrent() {
+    DBMyBufferMgr bufMgr(true, testPoolBlocks * 4);
+    DBFile &file = create_file(bufMgr, "test_concurrent");
+    concurrent_state state;
+    state.index = NULL;
+    state.threads = 4;
+    state.keysPerThread = 3000;
+    state.error = NULL;
+    try {
+        state.index = new DBMyIndex(bufMgr, file, INT, WRITE, true);
+        vector<thread> workers;
+        for (uint part = 1; part < state.threads; ++part)
+            workers.push_back(thread(concurrent_worker, std::ref(state), part));
+        concurrent_worker(state, 0);
+        for (uint i = 0; i < workers.size(); ++i)
+            workers[i].join();
+        if (state.error != NULL)
+            rethrow_exception(state.error);
+
+        DBListTID tids;
+        for (uint k = 0; k < state.keysPerThread * state.threads; ++k) {
+            tids.clear();
+            state.index->find(DBIntType(k), tids);
+            check(tids.size() == 1 && contains(tids, make_tid(k, 2)), "key " + TO_STR(k) + " lost");
+        }
+        check_structure(*state.index);
+    } catch (...) {
+        delete state.index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete state.index;
+    drop_file(bufMgr, file);
+}
+
+/**
+ * Nicht eindeutiger INT-Index mit zwei TIDs je Schluessel und Cache fuer 100 Schluessel;
+ * Schluessel 300 hat mehr TIDs als maxTids und darf nicht in den Cache
+ */
+static void test_key_cache() {
+    const uint keys = 200, maxTids = 16;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_key_cache");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        for (uint k = 0; k < keys; ++k) {
+            index->insert(DBIntType(k), make_tid(k, 0));
+            index->insert(DBIntType(k), make_tid(k, 1));
+        }
+        for (uint d = 0; d <= maxTids; ++d)
+            index->insert(DBIntType(300), make_tid(300, d));
+        index->setKeyCache(100, maxTids);
+
+        DBListTID tids;
+        for (uint pass = 0; pass < 2; ++pass) {
+            for (uint k = 0; k < 50; ++k) {
+                tids.clear();
+                index->find(DBIntType(k), tids);
+                check(tids.size() == 2 && contains(tids, make_tid(k, 0)) && contains(tids, make_tid(k, 1)),
+                      "key " + TO_STR(k) + " returned wrong TIDs in pass " + TO_STR(pass));
+            }
+        }
+        DBMyIndex::CacheStatistics stats = index->cacheStatistics();
+        check(stats.hits >= 50 && stats.entries == 50, "second pass hit the cache " + TO_STR(stats.hits) + " times");
+        for (uint pass = 0; pass < 2; ++pass) {
+            tids.clear();
+            index->find(DBIntType(300), tids);
+            check(tids.size() == maxTids + 1, "key 300 returned " + TO_STR(tids.size()) + " TIDs");
+        }
+        check(index->cacheStatistics().hits == stats.hits, "posting list longer than maxTids was cached");
+
+        //Aenderungen an gecachten Schluesseln
+        index->insert(DBIntType(10), make_tid(10, 2));
+        tids.clear();
+        index->find(DBIntType(10), tids);
+        check(tids.size() == 3 && contains(tids, make_tid(10, 2)), "find() returned a stale list after insert");
+        DBListTID removed;
+        removed.push_back(make_tid(20, 0));
+        index->remove(DBIntType(20), removed);
+        tids.clear();
+        index->find(DBIntType(20), tids);
+        check(tids.size() == 1 && contains(tids, make_tid(20, 1)), "find() returned a stale list after remove");
+        check(index->cacheStatistics().invalidations >= 2, "changed keys were not invalidated");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// find_each: sammelt die TIDs, nach limit TIDs (0: unbegrenzt) bricht put() ab
+class collect_sink : public DBMyIndexSink {
+public:
+    collect_sink(uint limit) : limit(limit), puts(0) {};
+
+    bool put(const TID &tid) {
+        tids.push_back(tid);
+        puts += 1;
+        return limit == 0 || puts < limit;
+    };
+
+    DBListTID tids;
+    uint limit;
+    uint puts;
+};
+
+/**
+ * Nicht eindeutiger INT-Index mit einem Schluessel, dessen Liste in Ueberlaufbloecke ausweicht,
+ * Schluesseln mit wenigen TIDs und einem fehlenden Schluessel
+ */
+static void test_find_each() {
+    const uint keys = 40, hot = 5, many = 2000;
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = create_file(bufMgr, "test_find_each");
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, INT, WRITE, false);
+        for (uint k = 0; k < keys; ++k) {
+            if (k == hot)
+                continue;
+            for (uint d = 0; d <= k % 4; ++d)
+                index->insert(DBIntType(k), make_tid(k, d));
+        }
+        for (uint t = 0; t < many; ++t)
+            index->insert(DBIntType(hot), make_tid((t * 7919) % 100000, t % 3));
+        check(index->inspect().overflowBlocks > 0, "long posting list did not move to overflow blocks");
+
+        DBListTID expected;
+        TID span[7];
+        for (uint k = 0; k <= keys; ++k) {
+            expected.clear();
+            index->find(DBIntType(k), expected);
+
+            collect_sink sink(0);
+            check(index->findEach(DBIntType(k), sink), "findEach() of key " + TO_STR(k) + " was cancelled");
+            check_same(expected, sink.tids, "findEach() of key " + TO_STR(k));
+            TID prev = make_tid(0, 0);
+            for (DBListTID::const_iterator it = sink.tids.begin(); it != sink.tids.end(); prev = *it++)
+                check(it == sink.tids.begin() || prev.page < it->page || (prev.page == it->page && prev.slot < it->slot),
+                      "findEach() of key " + TO_STR(k) + " is not ascending");
+
+            DBListTID spans;
+            DBMyIndex::FindContinuation cont;
+            while (cont.done == false) {
+                uint n = index->findSpan(DBIntType(k), span, 7, cont);
+                check(n <= 7, "findSpan() exceeded its capacity");
+                spans.insert(spans.end(), span, span + n);
+            }
+            check_same(expected, spans, "findSpan() of key " + TO_STR(k));
+        }
+
+        collect_sink limited(3);
+        check(index->findEach(DBIntType(hot), limited) == false, "findEach() ignored a cancelling sink");
+        check(limited.puts == 3, "findEach() called put() " + TO_STR(limited.puts) + " times after cancelling");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+// redo_log: Schluessel der i-ten Einfuegung; gestreut, damit auch mitten im Baum gespalten wird
+static uint crash_key(uint i) {
+    return (uint) (((uint64_t) i * 7919) % 1000003);
+}
+
+/**
+ * Kindprozess des Absturztests: fuegt mit eingeschaltetem Redo-Log ein und meldet nach jeder
+ * zurueckgekehrten (also dauerhaften) Einfuegung deren Nummer ueber out, bis er getoetet wird
+ */
+static int crash_child(const string &name, int out) {
+    try {
+        DBMyBufferMgr bufMgr(false, testPoolBlocks / 2);
+        DBFile &file = create_file(bufMgr, name);
+        DBMyIndex index(bufMgr, file, VCHAR, WRITE, true);
+        index.setWriteAheadLog(true);
+        for (uint i = 0;; ++i) {
+            DBAttrType *key = vchar_key(crash_key(i));
+            index.insert(*key, make_tid(crash_key(i), 0));
+            delete key;
+            if (write(out, &i, sizeof(uint)) != sizeof(uint))
+                return 1;
+        }
+    } catch (DBException &e) {
+        cerr << "crash child failed: " << e.what() << endl;
+    }
+    return 1;
+}
+
+/**
+ * Ein Absturz nach mindestens killAfter bestaetigten Einfuegungen. Der Zeitpunkt innerhalb der
+ * laufenden Einfuegung ist zufaellig, bei den vielen Splits einer VARCHAR-Datei mit kleinem
+ * Puffer trifft er auch halbe Splits mit teilweise verdraengten Seiten.
+ */
+static void crash_round(const string &name, uint killAfter) {
+    int fds[2];
+    check(pipe(fds) == 0, "can not create pipe");
+    pid_t pid = fork();
+    check(pid >= 0, "can not fork");
+    if (pid == 0) {
+        close(fds[0]);
+        _exit(crash_child(name, fds[1]));
+    }
+    close(fds[1]);
+    uint confirmed = 0, i;
+    bool killed = false;
+    while (read(fds[0], &i, sizeof(uint)) == sizeof(uint)) {
+        confirmed = i + 1;
+        if (killed == false && confirmed >= killAfter) {
+            kill(pid, SIGKILL);
+            killed = true;
+        }
+    }
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    check(killed && WIFSIGNALED(status), "crash child stopped after " + TO_STR(confirmed) + " inserts");
+
+    DBMyBufferMgr bufMgr(false, testPoolBlocks);
+    DBFile &file = bufMgr.openFile(name);
+    DBMyIndex *index = NULL;
+    try {
+        index = new DBMyIndex(bufMgr, file, VCHAR, WRITE, true);
+        check(index->logStatistics().enabled, "write-ahead log is off after recovery");
+        check_structure(*index);
+        DBListTID tids;
+        for (i = 0; i < confirmed; ++i) {
+            DBAttrType *key = vchar_key(crash_key(i));
+            tids.clear();
+            index->find(*key, tids);
+            delete key;
+            check(tids.size() == 1 && contains(tids, make_tid(crash_key(i), 0)),
+                  "confirmed insert " + TO_STR(i) + " of " + TO_STR(confirmed) + " lost");
+        }
+        //der wiederhergestellte Index nimmt weitere Einfuegungen an
+        DBAttrType *key = vchar_key(1000003);
+        index->insert(*key, make_tid(1000003, 0));
+        delete key;
+        check_structure(*index);
+        //gepufferte Einfuegungen stuenden in keinem Log
+        bool refused = false;
+        try {
+            index->setInsertBuffer(100);
+        } catch (DBIndexException &e) {
+            refused = true;
+        }
+        check(refused, "insert buffer accepted while the write-ahead log is on");
+    } catch (...) {
+        delete index;
+        drop_file(bufMgr, file);
+        throw;
+    }
+    delete index;
+    drop_file(bufMgr, file);
+}
+
+static void test_redo_log() {
+    const uint killPoints[] = {30, 250, 1200};
+    for (uint r = 0; r < sizeof(killPoints) / sizeof(uint); ++r)
+        crash_round("test_redo_log_" + TO_STR(r), killPoints[r]);
+}
+
+struct test_case {
+    const char *name;
+    void (*run)();
+};
+
+const test_case tests[] = {
+        {"batch", test_batch},
+        {"remove", test_remove},
+        {"varchar", test_varchar},
+        {"postings", test_postings},
+        {"hash_index", test_hash_index},
+        {"find_batch", test_find_batch},
+        {"composite", test_composite},
+        {"insert_buffer", test_insert_buffer},
+        {"filter", test_filter},
+        {"append", test_append},
+        {"build", test_build},
+        {"format", test_format},
+        {"snapshot", test_snapshot},
+        {"counted", test_counted},
+        {"concurrent", test_concurrent},
+        {"key_cache", test_key_cache},
+        {"find_each", test_find_each},
+        {"redo_log", test_redo_log}
+};
+
+int main(int argc, char **argv) {
+    AppenderPtr appender(new ConsoleAppender(LayoutPtr(new SimpleLayout()), ConsoleAppender::getSystemErr()));
+    BasicConfigurator::configure(appender);
+    Logger::getRootLogger()->setLevel(Level::getWarn());
+
+    uint count = sizeof(tests) / sizeof(test_case);
+    for (int a = 1; a < argc; ++a) {
+        bool known = false;
+        for (uint i = 0; i < count; ++i)
+            known = known || string(argv[a]) == tests[i].name;
+        if (known == false) {
+            cerr << "usage: " << argv[0] << " [test ...], tests:";
+            for (uint i = 0; i < count; ++i)
+                cerr << " " << tests[i].name;
+            cerr << endl;
+            return 2;
+        }
+    }
+
+    uint failed = 0;
+    for (uint i = 0; i < count; ++i) {
+        bool selected = argc == 1;
+        for (int a = 1; a < argc; ++a)
+            selected = selected || string(argv[a]) == tests[i].name;
+        if (selected == false)
+            continue;
+        try {
+            tests[i].run();
+            cout << "ok " << tests[i].name << endl;
+        } catch (DBException &e) {
+            cout << "FAILED " << tests[i].name << ": " << e.what() << endl;
+            failed += 1;
+        } catch (exception &e) {
+            cout << "FAILED " << tests[i].name << ": " << e.what() << endl;
+            failed += 1;
+        }
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+#ifndef DBMYBENCHMARK_H_
+#define DBMYBENCHMARK_H_
+
+#include <hubDB/DBIndex.h>
+#include <hubDB/DBMyIndex.h>
+#include <hubDB/DBMyHashIndex.h>
+#include <vector>
+#include <exception>
+
+namespace HubDB {
+    namespace Index {
+        // Dateien fuer DBMyBenchmark: Anlegen und Loeschen haengen vom Dateimanager der
+        // Umgebung ab (wie DBMyIndexSource die Tabelle fuer DBMyIndex::build() liefert)
+        class DBMyBenchmarkFiles {
+        public:
+            virtual ~DBMyBenchmarkFiles() {};
+
+            // neue, leere Datei name fuer bufMgr
+            virtual DBFile &create(DBBufferMgr &bufMgr, const string &name) = 0;
+
+            // die Datei wird nicht mehr gebraucht
+            virtual void drop(DBBufferMgr &bufMgr, DBFile &file) = 0;
+        };
+
+        // Microbenchmarks fuer DBMyIndex, DBMyHashIndex und DBMyBufferMgr, Ergebnis als JSON (siehe run())
+        class DBMyBenchmark {
+
+        public:
+            struct Config {
+                vector<AttrTypeEnum> types;
+                vector<uint> threads;
+                // Pufferbloecke fuer fix/unfix; die Indexlaeufe benutzen indexPoolBlocks
+                vector<uint> poolSizes;
+                uint indexPoolBlocks;
+                // Schluessel je Index, beim duplikatlastigen Einfuegen duplicates TIDs je Schluessel
+                uint keys;
+                uint duplicates;
+                // Suchen bzw. fix/unfix je Thread, Schluessel je Bereichssuche
+                uint lookups;
+                uint scanLength;
+                // Bloecke der Datei fuer fix/unfix
+                uint fileBlocks;
+                unsigned int seed;
+
+                Config();
+            };
+
+            DBMyBenchmark(DBMyBenchmarkFiles &files, const Config &config);
+
+            string run();
+
+        private:
+            enum workload {
+                INSERT_RANDOM, INSERT_SEQUENTIAL, INSERT_DUPLICATES, FIND_POINT, SCAN_RANGE, FIX_UNFIX,
+                HASH_INSERT_RANDOM, HASH_FIND_POINT
+            };
+            struct result {
+                workload kind;
+                AttrTypeEnum type;
+                // gelaufene Threads, weniger als angefordert, wenn sich einer nicht starten liess
+                uint threads;
+                uint poolBlocks;
+                unsigned long operations;
+                double seconds;
+            };
+            // gemeinsamer Zustand der Threads eines Laufs
+            struct run_state {
+                workload kind;
+                DBBufferMgr *bufMgr;
+                DBFile *file;
+                DBMyIndex *index;
+                // je Thread eine Instanz, DBMyHashIndex haelt seine gefixten Bloecke im Objekt
+                vector<DBMyHashIndex *> hashIndexes;
+                vector<DBAttrType *> keys;
+                vector<uint> order;
+                uint threads;
+                mutex errorMutex;
+                exception_ptr error;
+            };
+
+            void index_runs(AttrTypeEnum type, uint threads);
+            void hash_runs(AttrTypeEnum type, uint threads);
+            void buffer_run(uint poolBlocks, uint threads);
+            void release(run_state &state);
+            void measure(run_state &state, AttrTypeEnum type, uint poolBlocks, unsigned long operations);
+            void worker(run_state &state, uint part);
+            void insert_part(run_state &state, uint part);
+            void find_part(run_state &state, uint part);
+            void scan_part(run_state &state, uint part);
+            void fix_part(run_state &state, uint part);
+            DBAttrType *make_key(AttrTypeEnum type, uint k) const;
+            string to_json() const;
+
+            static const char *workloadName(workload kind);
+            static const char *typeName(AttrTypeEnum type);
+
+            static LoggerPtr logger;
+
+            DBMyBenchmarkFiles &files;
+            Config config;
+            vector<result> results;
+        };
+    }
+}
+
+#endif /*DBMYBENCHMARK_H_*/
@@ -3,6 +3,8 @@
 
 #include <hubDB/DBBufferMgr.h>
 #include <limits>
+#include <vector>
+#include <atomic>
 
 namespace HubDB{
 	namespace Manager{
@@ -19,12 +21,30 @@ namespace HubDB{
 
 			static int registerClass();
 
+			// Antwort des Write-Ahead-Logs (siehe DBMyIndex::setWriteAheadLog()) vor dem Schreiben
+			// eines Blocks: sofort, erst nachdem der Log geschrieben ist, oder noch nicht, weil sein
+			// neuestes Bild noch in einer laufenden Operation (ggf. des aufrufenden Threads) liegt;
+			// WRITE_FAILED: das Bild ist nicht dauerhaft und der Log gescheitert, fixBlock wirft
+			enum WriteAheadState { WRITE_NOW, WRITE_AFTER_SYNC, WRITE_BLOCKED, WRITE_BLOCKED_HERE, WRITE_FAILED };
+
+			// wait == false: nur Auskunft, ohne Ein-/Ausgabe (unter der Puffersperre); wait == true
+			// (ohne Puffersperre): schreibt den Log bzw. wartet kurz auf die laufende Operation.
+			// Seiten der laufenden Operation des aufrufenden Threads (WRITE_BLOCKED_HERE) werden
+			// nie vor ihrem Ende geschrieben.
+			// Scheitert das Schreiben des Logs, wirft der Hook eine DBException, fixBlock gibt sie weiter
+			typedef WriteAheadState (*WriteAheadHook)(const string & fileName, BlockNo blockNo, bool wait);
+
+			// NULL (Voreinstellung): kein Log, jeder Block darf sofort geschrieben werden
+			static void setWriteAheadHook(WriteAheadHook hook){ writeAheadHook.store(hook); }
+
 		protected:
 			bool isBlockOfFileOpen(DBFile & file) const;
 			void closeAllOpenBlocks(DBFile & file);
 			DBBCB * fixBlock(DBFile & file,BlockNo blockNo,DBBCBLockMode mode,bool read);
 			int findBlock(DBFile & file,BlockNo blockNo);
 			int findBlock(DBBCB * bcb);
+			WriteAheadState writeAheadState(DBBCB & bcb, bool wait);
+			bool mayFlush(DBBCB & bcb);
 
 			void setBit(int i){ bitMap[i/32] |= (1<<(i%32));}
 			void unsetBit(int i){ bitMap[i/32] &= (~(1<<(i%32)));}
@@ -35,8 +55,15 @@ namespace HubDB{
 			int * bitMap;
 			int mapSize;
   			static LoggerPtr logger;
+			static std::atomic<WriteAheadHook> writeAheadHook;
+			// Verdraengungskandidaten, die der Log in fixBlock abgelehnt hat (nur unter der Puffersperre)
+			std::vector<bool> refused;
+			std::vector<int> refusedIdx;
   			unsigned int * ageBits;
   			unsigned int gloCnt; // this is the current "timestamp"
+			// Reihen in DBMyLatency: Block war im Puffer bzw. musste eingelagert werden
+			unsigned int latencyFixHit;
+			unsigned int latencyFixMiss;
 			unsigned int max_unsigned_int_size = std::numeric_limits<unsigned int>::max();
 		};
 	}
@@ -0,0 +1,73 @@
+#ifndef DBMYCOMPOSITEKEY_H_
+#define DBMYCOMPOSITEKEY_H_
+
+#include <hubDB/DBTypes.h>
+#include <vector>
+
+namespace HubDB {
+    namespace Index {
+        // Zusammengesetzter Indexschluessel: Schluesselattribute (lexikographisch verglichen)
+        // und optional mitgespeicherte Attribute (included), die nicht verglichen werden
+        class DBMyCompositeKey : public DBAttrType {
+
+        public:
+            DBMyCompositeKey(const vector<AttrTypeEnum> &keyTypes, const vector<AttrTypeEnum> &includeTypes);
+
+            DBMyCompositeKey(const vector<AttrTypeEnum> &keyTypes, const vector<AttrTypeEnum> &includeTypes,
+                             const vector<DBAttrType *> &keys, const vector<DBAttrType *> &included);
+
+            DBMyCompositeKey(const DBMyCompositeKey &ref);
+
+            ~DBMyCompositeKey();
+
+            static DBMyCompositeKey *read(const char *ptr, const vector<AttrTypeEnum> &keyTypes,
+                                          const vector<AttrTypeEnum> &includeTypes);
+
+            static uint getSize(const vector<AttrTypeEnum> &types);
+
+            char *write(char *ptr) const;
+
+            enum AttrTypeEnum type() const;
+
+            string toString(string linePrefix = "") const;
+
+            bool operator==(const DBAttrType &ref) const;
+
+            bool operator!=(const DBAttrType &ref) const;
+
+            bool operator<(const DBAttrType &ref) const;
+
+            bool operator<=(const DBAttrType &ref) const;
+
+            bool operator>(const DBAttrType &ref) const;
+
+            bool operator>=(const DBAttrType &ref) const;
+
+            DBAttrType &operator=(const DBAttrType &ref);
+
+            DBMyCompositeKey &operator=(const DBMyCompositeKey &ref);
+
+            uint keyCount() const { return keys.size(); };
+
+            const DBAttrType &key(uint i) const { return *keys[i]; };
+
+            uint includedCount() const { return included.size(); };
+
+            // NULL, wenn der Schluessel ohne mitgespeicherte Attribute erzeugt wurde
+            const DBAttrType *getIncluded(uint i) const { return i < included.size() ? included[i] : NULL; };
+
+        private:
+            int compare(const DBAttrType &ref) const;
+
+            void clear();
+
+            vector<AttrTypeEnum> keyTypes;
+            vector<AttrTypeEnum> includeTypes;
+            vector<DBAttrType *> keys;
+            vector<DBAttrType *> included;
+        };
+    }
+}
+
+
+#endif /*DBMYCOMPOSITEKEY_H_*/
@@ -0,0 +1,85 @@
+#ifndef DBMYHASHINDEX_H_
+#define DBMYHASHINDEX_H_
+
+#include <hubDB/DBIndex.h>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+
+namespace HubDB {
+    namespace Index {
+        class DBMyHashIndex : public DBIndex {
+
+        public:
+            DBMyHashIndex(DBBufferMgr &bufferMgr, DBFile &file, enum AttrTypeEnum attrType, ModType mode, bool unique);
+
+            ~DBMyHashIndex();
+
+            string toString(string linePrefix = "") const;
+
+            void initializeIndex();
+
+            void find(const DBAttrType &val, DBListTID &tids);
+
+            void insert(const DBAttrType &val, const TID &tid);
+
+            void remove(const DBAttrType &val, const DBListTID &tid);
+
+            bool isIndexNonUniqueAble() { return true; };
+
+            void unfixBACBs(bool dirty);
+
+            static int registerClass();
+
+        private:
+            struct bucket_header {
+                uint local_depth;
+                uint count;
+                BlockNo next;
+            };
+
+            void unfix_all();
+            uint hash(const char *key) const;
+            void encode_key(const DBAttrType &val, char *key) const;
+            void read_directory(char *meta_ptr, vector<BlockNo> &dir, uint &depth);
+            void load_directory();
+            void fix_bucket(uint h, DBBCBLockMode mode);
+            void read_header(char *ptr, bucket_header &head) const;
+            void write_header(char *ptr, const bucket_header &head) const;
+            uint read_chain(DBBACB &primary, vector<char> &buf);
+            int find_entry(const vector<char> &buf, const char *key, const TID *tid) const;
+            void write_chain(DBBACB &bacb, const char *buf, uint count, DBBACB *meta);
+            void free_chain(BlockNo block, DBBACB &meta);
+            DBBACB fix_free_block(DBBACB &meta);
+            bool restructure(uint h, const char *entry);
+            void write_directory(DBBACB &meta, const vector<BlockNo> &dir, uint depth);
+
+            uint keySize() const;
+
+            uint entrySize() const;
+
+            uint entriesPerBucket() const;
+
+            uint dirEntriesPerBlock() const;
+
+            uint maxDirBlocks() const;
+
+            static LoggerPtr logger;
+
+            static const BlockNo metaBlockNo;
+            static const BlockNo noBlockNo;
+            static const uint maxDepth;
+            static map<string, atomic<unsigned long> > directoryVersions;
+            static mutex directoryVersionsMutex;
+            stack<DBBACB> bacbStack;
+            vector<BlockNo> directory;
+            uint globalDepth;
+            atomic<unsigned long> *directoryVersion;
+            unsigned long cachedVersion;
+        };
+    }
+}
+
+
+#endif /*DBMYHASHINDEX_H_*/
@@ -2,14 +2,52 @@
 #define DBMYINDEX_H_
 
 #include <hubDB/DBIndex.h>
+#include <hubDB/DBMyCompositeKey.h>
+#include <hubDB/DBMyBufferMgr.h>
+#include <vector>
+#include <utility>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
 
 namespace HubDB {
     namespace Index {
+        // Quelle fuer DBMyIndex::build(): liefert die (Schluessel, TID)-Paare einer Tabelle
+        // in Partitionen, verschiedene Partitionen werden gleichzeitig aus mehreren Threads gelesen
+        class DBMyIndexSource {
+        public:
+            virtual ~DBMyIndexSource() {};
+
+            virtual uint partitionCount() = 0;
+
+            // naechstes Paar der Partition part, key gehoert danach dem Aufrufer; false am Ende
+            virtual bool next(uint part, DBAttrType *&key, TID &tid) = 0;
+        };
+
+        // Empfaenger der TIDs von DBMyIndex::findEach(): put() wird je TID in aufsteigender
+        // Reihenfolge aufgerufen, Rueckgabe false bricht die Suche ab (z.B. bei LIMIT)
+        class DBMyIndexSink {
+        public:
+            virtual ~DBMyIndexSink() {};
+
+            virtual bool put(const TID &tid) = 0;
+        };
+
         class DBMyIndex : public DBIndex {
 
         public:
             DBMyIndex(DBBufferMgr &bufferMgr, DBFile &file, enum AttrTypeEnum attrType, ModType mode, bool unique);
 
+            DBMyIndex(DBBufferMgr &bufferMgr, DBFile &file, const vector<AttrTypeEnum> &keyTypes,
+                      const vector<AttrTypeEnum> &includeTypes, ModType mode, bool unique);
+
             ~DBMyIndex();
 
             string toString(string linePrefix = "") const;
@@ -18,52 +56,517 @@ namespace HubDB {
 
             void find(const DBAttrType &val, DBListTID &tids);
 
+            bool findEach(const DBAttrType &val, DBMyIndexSink &sink);
+
+            // Position von findSpan() zwischen zwei Aufrufen, fuer den ersten Aufruf neu anlegen
+            struct FindContinuation {
+                bool started;
+                bool done;
+                TID last;
+
+                FindContinuation() : started(false), done(false) {};
+            };
+
+            uint findSpan(const DBAttrType &val, TID *tids, uint capacity, FindContinuation &cont);
+
+            void findBatch(const vector<const DBAttrType *> &keys, vector<DBListTID> &results);
+
+            bool findCovered(const DBAttrType &val, TID &tid, vector<DBAttrType *> &included);
+
             void insert(const DBAttrType &val, const TID &tid);
 
+            void insertBatch(vector<pair<DBAttrType *, TID> > &entries);
+
             void remove(const DBAttrType &val, const DBListTID &tid);
 
-            bool isIndexNonUniqueAble() { return false; };
+            void build(DBMyIndexSource &source, uint threads, size_t memoryBudget);
+
+            void setInsertBuffer(uint capacity);
+
+            void flushInsertBuffer();
+
+            void setFilter(uint expectedKeys, double falsePositiveRate);
+
+            void writeSnapshot();
+
+            void setKeyCache(uint capacity, uint maxTids);
+
+            void setWriteAheadLog(bool enable);
+
+            void checkpointLog();
+
+            static string logName(const DBFile &file);
+
+            void setCounted(bool enable);
+
+            bool isCounted() const { return counted->load(); };
+
+            uint count(const DBAttrType *lower, const DBAttrType *upper);
+
+            uint rank(const DBAttrType &val);
+
+            bool select(uint pos, DBAttrType *&key, TID &tid);
+
+            DBAttrType *quantile(double q);
+
+            bool isIndexNonUniqueAble() { return true; };
 
             void unfixBACBs(bool dirty);
 
             static int registerClass();
 
+            // Ergebnis von inspect(): Aufbau des Baumes und verletzte Strukturinvarianten
+            struct Statistics {
+                uint height;
+                vector<uint> nodesPerLevel;
+                vector<uint> fillHistogram;
+                uint entries;
+                uint leafChainLength;
+                uint underfullNodes;
+                uint freeBlocks;
+                uint overflowBlocks;
+                uint filterBlocks;
+                list<string> violations;
+
+                string toString(string linePrefix = "") const;
+            };
+
+            Statistics inspect();
+
+            // Kennzahlen des Caches haeufig gesuchter Schluessel (siehe setKeyCache())
+            struct CacheStatistics {
+                uint capacity;
+                uint maxTids;
+                uint entries;
+                unsigned long hits;
+                unsigned long misses;
+                unsigned long evictions;
+                unsigned long invalidations;
+
+                double hitRate() const;
+
+                string toString(string linePrefix = "") const;
+            };
+
+            CacheStatistics cacheStatistics();
+
+            // Kennzahlen des Redo-Logs (siehe setWriteAheadLog()): commits je syncs zeigt,
+            // wie viele Operationen ein fsync im Mittel zusammenfasst
+            struct LogStatistics {
+                bool enabled;
+                uint64_t bytes;
+                unsigned long commits;
+                unsigned long syncs;
+                unsigned long checkpoints;
+
+                string toString(string linePrefix = "") const;
+            };
+
+            LogStatistics logStatistics();
+
+            static string inspectAll(string linePrefix = "");
+
         private:
-            static const uint MAX_TID_PER_ENTRY;
-            const uint tidsPerEntry;
+            struct node_header{
+                unsigned char format;
+                bool isroot;
+                bool isleaf;
+                int fill_level;
+                TID next;
+            };
+            enum latch_intent {
+                LATCH_READ, LATCH_INSERT, LATCH_REMOVE
+            };
+            // Spiegel eines inneren Knotens: Schluessel (raw je keySize() Bytes), Kinder als
+            // Blocknummern und, sobald geladen, als direkte Zeiger auf deren Spiegel
+            struct mirror_node {
+                bool stale;
+                bool leaf_children;
+                vector<char> raw;
+                vector<DBAttrType *> keys;
+                vector<BlockNo> blocks;
+                vector<mirror_node *> children;
+            };
+            // Zustand der in findBatch() verschraenkt laufenden Suchen eines Abschnitts [probe, end)
+            // von probes: aktuelle Suche und der als naechstes zu durchsuchende Spiegelknoten
+            struct probe_state {
+                uint probe;
+                uint end;
+                mirror_node *node;
+            };
+            // Zustand der Operationen eines Threads auf dieser Instanz (siehe cursor()): die gefixten
+            // Knoten des aktuellen Abstiegs, der Spiegel der inneren Knoten und das zuletzt gesehene
+            // rechteste Blatt (gueltig solange structureVersion == rightVersion, first_ ist dessen
+            // erster Schluessel)
+            struct op_cursor {
+                stack<DBBACB> bacbStack;
+                map<BlockNo, mirror_node *> mirror;
+                unsigned long mirrorVersion;
+                BlockNo rightLeaf;
+                unsigned long rightVersion;
+                DBAttrType *first_;
+                // Seitenbilder der laufenden Operation fuer den Redo-Log (siehe log_page()), ihre
+                // Gruppe in redo_log::open (0: keine) und LSN, bis zu der der Log bei ihrem Ende
+                // dauerhaft sein muss
+                vector<char> redo;
+                vector<pair<BlockNo, uint64_t> > redoPages;
+                uint64_t redoGroup;
+                uint64_t redoEnd;
+
+                op_cursor() : mirrorVersion(0), rightLeaf(noBlockNo), rightVersion(0), first_(NULL), redoGroup(0),
+                              redoEnd(0) {};
+            };
+            // Cursor eines Threads je Instanz (instanceId), nur von diesem Thread gelesen; gibt sie
+            // beim Ende des Threads frei
+            struct cursor_owner {
+                map<unsigned long, op_cursor *> cursors;
+
+                ~cursor_owner();
+            };
+            struct less_key {
+                bool operator()(const DBAttrType *a, const DBAttrType *b) const { return a->operator<(*b); };
+            };
+            // Einfuegepuffer einer Indexdatei, gemeinsam fuer alle Instanzen im Prozess.
+            // capacity == 0: ausgeschaltet und leer, Operationen zaehlen sich dann ohne lock in
+            // bypass. busy: Schluessel, die gerade ohne lock im Baum geaendert werden. flushing:
+            // Eintraege, die eine Leerung gerade ohne lock in den Baum schreibt (fuer Suchen noch
+            // sichtbar). changes zaehlt Beginn und Ende von Leerungen und Aenderungen mit busy.
+            struct insert_buffer {
+                mutex lock;
+                condition_variable changed;
+                atomic<uint> capacity;
+                atomic<uint> bypass;
+                multimap<DBAttrType *, TID, less_key> entries;
+                multimap<DBAttrType *, TID, less_key> flushing;
+                multiset<const DBAttrType *, less_key> busy;
+                unsigned long changes;
+
+                insert_buffer() : capacity(0), bypass(0), changes(0) {};
+            };
+            // Zugriff einer Operation auf den Einfuegepuffer (siehe insert_buffer): ist er
+            // eingeschaltet, haelt guard den lock, sonst ist die Operation in bypass gezaehlt.
+            // release() (spaetestens der Destruktor) gibt beides und die busy-Schluessel frei.
+            struct buffer_access {
+                insert_buffer &buffer;
+                unique_lock<mutex> guard;
+                bool buffered;
+                bool released;
+                vector<const DBAttrType *> busy;
+
+                buffer_access(insert_buffer &buffer);
+                ~buffer_access() { release(); };
+                void mark_busy(const vector<const DBAttrType *> &keys);
+                void release();
+            };
+            // aendernde Operation: wirft sie, kommen die Bilder der schon geaenderten Seiten beim
+            // Verlassen trotzdem in den Log (siehe log_abort())
+            struct redo_scope {
+                DBMyIndex &index;
+
+                redo_scope(DBMyIndex &index) : index(index) {};
+                ~redo_scope() { index.log_abort(); };
+            };
+            // Bloom-Filter einer Indexdatei (siehe setFilter()), gemeinsam fuer alle Instanzen im Prozess.
+            // bits ist leer, wenn die Datei keinen Filter hat; writers zaehlt laufende Aenderungen
+            // des Baums ohne insertBuffer->lock, waehrend rebuilding werden keine neuen zugelassen.
+            struct key_filter {
+                mutex lock;
+                condition_variable changed;
+                bool loaded;
+                bool dirty;
+                bool rebuilding;
+                uint writers;
+                uint removed;
+                uint expectedKeys;
+                uint numHashes;
+                vector<uint64_t> bits;
+                vector<BlockNo> blocks;
+
+                key_filter() : loaded(false), dirty(false), rebuilding(false), writers(0), removed(0),
+                               expectedKeys(0), numHashes(0) {};
+            };
+            // Cache haeufig gesuchter Schluessel einer Indexdatei (siehe setKeyCache()), gemeinsam fuer
+            // alle Instanzen im Prozess. index bildet den Schluessel auf seinen Platz in slots ab, ein
+            // leerer key markiert einen freien Platz. generation zaehlt die Invalidierungen.
+            struct key_cache {
+                struct slot {
+                    string key;
+                    vector<TID> tids;
+                    bool referenced;
+                };
+                mutex lock;
+                uint capacity;
+                uint maxTids;
+                uint hand;
+                unsigned long generation;
+                vector<slot> slots;
+                unordered_map<string, uint> index;
+                unsigned long hits;
+                unsigned long misses;
+                unsigned long evictions;
+                unsigned long invalidations;
+
+                key_cache() : capacity(0), maxTids(0), hand(0), generation(0), hits(0), misses(0),
+                              evictions(0), invalidations(0) {};
+            };
+            // Redo-Log einer Indexdatei (siehe setWriteAheadLog()), gemeinsam fuer alle Instanzen im Prozess.
+            // LSNs zaehlen die Bytes seit dem Oeffnen, die Datei beginnt bei LSN base; bis durable ist
+            // sie mit fsync geschrieben, pending haelt die angehaengten Gruppen bis appended.
+            // pages: je seit dem letzten Checkpoint geaenderter Seite die Version ihres letzten Bildes,
+            // Anfang und Gruppenende des zuletzt angehaengten Bildes (lsn 0: keines im Log) und ob ein
+            // neueres Bild noch im Cursor des Threads owner in Gruppe group liegt (pending, die Seite darf
+            // dann nicht geschrieben werden). open: Gruppen mit Bildern in einem Cursor, je mit den
+            // Gruppen, die vor ihr angehaengt sein muessen (after), und ob ihr Thread darauf wartet
+            // (siehe log_append()). syncing: sync_log() oder truncate_log() schreibt gerade ohne lock
+            // in die Datei; pressure: ein Thread wartet auf eine pending-Seite (siehe log_progress())
+            struct redo_log {
+                struct page_state {
+                    uint64_t version;
+                    uint64_t offset;
+                    uint64_t lsn;
+                    bool pending;
+                    thread::id owner;
+                    uint64_t group;
+                };
+                struct open_group {
+                    op_cursor *cursor;
+                    vector<uint64_t> after;
+                    bool waiting;
+
+                    open_group() : cursor(NULL), waiting(false) {};
+                };
+                mutex lock;
+                condition_variable changed;
+                atomic<bool> enabled;
+                atomic<bool> pressure;
+                bool opened;
+                bool recovering;
+                bool syncing;
+                bool checkpointing;
+                bool failed;
+                int fd;
+                uint64_t base;
+                uint64_t durable;
+                uint64_t appended;
+                uint64_t version;
+                uint64_t groups;
+                vector<char> pending;
+                map<BlockNo, page_state> pages;
+                map<uint64_t, open_group> open;
+                unsigned long commits;
+                unsigned long syncs;
+                unsigned long checkpoints;
+
+                redo_log() : enabled(false), pressure(false), opened(false), recovering(false), syncing(false),
+                             checkpointing(false), failed(false), fd(-1), base(0), durable(0), appended(0), version(0),
+                             groups(0), commits(0), syncs(0), checkpoints(0) {};
+            };
+            // sortierter Lauf beim Aufbau (build()), im Speicher oder in einer temporaeren Datei
+            struct build_run;
             struct value_container{
                 DBAttrType *val;
                 TID tid;
                 bool isnew = false;
+                // Split beim Anhaengen am rechten Rand des Baumes (siehe split_point())
+                bool append = false;
+                // gezaehlter Baum: TIDs im linken Knoten, die des rechten stehen in tid.slot
+                uint leftCount = 0;
             };
 
 
+            op_cursor &cursor();
+            static cursor_owner &owned_cursors();
+            static void free_cursor(redo_log &log, op_cursor *cur);
             void emtpyBACBs();
-            string printTree();
-            string printNode();
+            void unfix_path();
+            void release_ancestors(stack<int> &path);
+            void unfix_block(DBBACB &bacb);
             TID initNode(bool isroot, bool isleaf, TID next);
+            DBBACB fix_free_block();
+            void free_node(DBBACB &bacb);
 
+            void read_head(char *ptr, node_header &head) const;
+            void write_head(char *ptr, const node_header &head) const;
+            void read_keyhead(char *ptr, uint &prefix, uint &width) const;
+            char *entry_ptr(char *ptr, int pos, uint &length) const;
+            char *key_ptr(char *ptr, int pos) const;
+            char *tid_ptr(char *ptr, int pos) const;
+            char *entries_end(char *ptr, int count) const;
+            uint node_bytes(int count) const;
+            uint used_bytes(char *ptr, const node_header &head) const;
+            bool underfull(char *ptr, const node_header &head) const;
+            void open_slot(char *ptr, const node_header &head, int pos) const;
+            int search_keys(const char *keys, int count, const DBAttrType &val, bool orEqual) const;
+            void decode_key(char *ptr, int pos, char *dst) const;
+            DBAttrType *key_at(char *ptr, int pos) const;
+            TID tid_at(char *ptr, int pos) const;
+            TID child_at(char *ptr, const node_header &head, int pos) const;
+            void set_child(char *ptr, node_header &head, int pos, const TID &child);
+            void read_entries(char *ptr, const node_header &head, char *buf, vector<char> *lists = NULL) const;
+            uint encode_layout(const char *buf, int count, bool isleaf, uint &prefix, uint &width) const;
+            bool fits(const char *buf, int count, bool isleaf) const;
+            bool write_entries(char *ptr, node_header &head, const char *buf, int count,
+                               const vector<char> *lists = NULL);
+            void write_compressed(char *ptr, const char *buf, int count, uint prefix, uint width) const;
+            bool replace_key(char *ptr, node_header &head, int pos, const char *key);
+            void shortest_separator(const char *left, const char *right, char *dst) const;
+            int split_point(const char *buf, int count, bool isleaf, bool append) const;
+            bool is_list(const TID &ref) const;
+            uint maxInlineList() const;
+            void read_postings(const TID &ref, const char *base, vector<TID> &tids);
+            bool decode_postings(const TID &ref, const char *base, DBMyIndexSink &sink);
+            TID write_postings(const vector<TID> &tids, vector<char> &lists, bool spill);
+            void free_postings(const TID &ref);
+            void read_overflow(BlockNo block, vector<char> &blob);
+            BlockNo write_overflow(const vector<char> &blob);
+            int upper_pos(char *ptr, const node_header &head, const DBAttrType &val) const;
+            int lower_pos(char *ptr, const node_header &head, const DBAttrType &val) const;
+
+            void descend_to_leaf(const DBAttrType &val, latch_intent intent, stack<int> &path, DBAttrType **upper);
+            void track_upper(char *ptr, const node_header &head, int pos, DBAttrType **upper) const;
+            void crab_shared(const DBAttrType &val, DBBCBLockMode leafMode, stack<int> &path, DBAttrType **upper);
+            void crab_exclusive(const DBAttrType &val, latch_intent intent, stack<int> &path, DBAttrType **upper);
+            bool is_safe(latch_intent intent);
+            bool fix_right_leaf(const DBAttrType &val);
+            void track_right_leaf();
+            bool descend_mirror(const DBAttrType &val, DBBCBLockMode leafMode, DBAttrType **upper);
+            int mirror_child(const mirror_node *node, const DBAttrType &val) const;
+            void prefetch_node(const mirror_node *node) const;
+            bool locate_leaves(const vector<const DBAttrType *> &keys, const vector<uint> &probes,
+                               vector<BlockNo> &leaves);
+            uint search_leaves(const vector<const DBAttrType *> &keys, const vector<uint> &probes,
+                               const vector<BlockNo> &leaves, vector<DBListTID> &results);
+            mirror_node *swizzle(BlockNo block);
+            static void clear_mirror(op_cursor &cur);
+            void inner_changed(BlockNo block);
             void search_in_node(const DBAttrType &val, DBListTID &tids);
-            value_container search_in_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr, bool islast);
-            value_container insert_into_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr);
-            value_container split_node(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr);
-            value_container split_leaf(const DBAttrType &val, const TID &tid, TID node, char *tid_ptr);
-            value_container split_root(const DBAttrType &val, const TID &tid, TID node);
-            value_container split_root_leaf(const DBAttrType &val, const TID &tid, TID node);
+            bool insert_into_leaf(const DBAttrType &val, const TID &tid, stack<int> &path);
+            void insert_into_parent(value_container vc, stack<int> &path);
+            void insert_into_node(char *ptr, node_header &head, int pos, const DBAttrType &sep, const TID &right);
+            void add_separator(char *ptr, const node_header &head, int pos, const DBAttrType &sep,
+                               const TID &right, char *buf, TID &last) const;
+            value_container split_leaf(char *buf, int count, const vector<char> &lists, bool append);
+            value_container split_node(char *buf, int count, const TID &last, bool append);
+            void split_root(value_container vc);
+            void remove_from_node(char *ptr, node_header &head, int pos);
+            uint remove_from_leaf(const DBAttrType &val, const DBListTID &tids);
+            uint remove_postings(char *ptr, node_header &head, const DBAttrType &val, const DBListTID &tids);
+            void rebalance(stack<int> &path);
+            int concat_entries(char *left_ptr, char *right_ptr, char *parent_ptr, int sep, char *buf,
+                               vector<char> &lists) const;
+            bool redistribute(DBBACB &left, DBBACB &right, char *parent_ptr, node_header &parent_head,
+                              int sep, bool from_left);
+            bool merge(DBBACB &left, DBBACB &right, char *parent_ptr, int sep);
+            void collapse_root(const TID &child);
+            uint posting_count(const TID &ref, const char *base);
+            uint node_count(char *ptr);
+            void add_counts(stack<int> path, int delta);
+            uint recount(BlockNo block);
+            uint count_below(const DBAttrType *val, bool orEqual);
+            bool select_in_tree(uint pos, DBAttrType *&key, TID &tid);
+            uint inspect_node(DBBACB &bacb, int level, const DBAttrType *lo, const DBAttrType *hi,
+                              Statistics &stats, vector<BlockNo> &leaves, int &leaf_level);
+            void open();
+            DBAttrType *read_key(const char *ptr) const;
+            void find_in_tree(const DBAttrType &val, DBListTID &tids);
+            bool stream_find(const DBAttrType &val, const TID *after, DBMyIndexSink &sink);
+            void insert_sorted(vector<pair<DBAttrType *, TID> > &entries);
+            void buffer_insert(const DBAttrType &val, const TID &tid, unique_lock<mutex> &guard);
+            void flush_buffer(unique_lock<mutex> &guard);
+            void buffer_lookup(const DBAttrType &val, vector<TID> &tids) const;
+            unsigned long buffer_snapshot(vector<pair<DBAttrType *, TID> > &snapshot);
+            bool buffer_unchanged(unsigned long changes);
+            uint normalize_key(const DBAttrType &val, vector<char> &raw) const;
+            uint64_t filter_hash(const DBAttrType &val) const;
+            bool may_contain(const DBAttrType &val);
+            void filter_add(const vector<const DBAttrType *> &keys, bool writer);
+            void filter_done();
+            void filter_removed(uint count);
+            void mark_filter_dirty();
+            void load_filter(bool created);
+            void rebuild_filter(uint expectedKeys, uint numHashes, uint lines, unique_lock<mutex> &bufferGuard);
+            void persist_filter();
+            uint maxFilterBlocks() const;
+            bool cache_lookup(const DBAttrType &val, DBListTID &tids, unsigned long &generation);
+            void cache_fill(const DBAttrType &val, const DBListTID &tids, unsigned long generation);
+            void cache_invalidate(const vector<const DBAttrType *> &keys);
+            void cache_clear();
+            void log_page(DBBACB &bacb);
+            static bool log_append(redo_log &log, op_cursor &cur, bool wait = true);
+            static bool log_ready(redo_log &log, uint64_t group, set<uint64_t> &together);
+            void log_progress();
+            void log_commit();
+            void log_abort();
+            void open_log(bool created);
+            void recover_log();
+            void flush_file();
+            bool checkpoint_log();
+            void truncate_log(uint64_t mark, const vector<BlockNo> &carry);
+            static void sync_log(redo_log &log, uint64_t lsn);
+            static DBMyBufferMgr::WriteAheadState may_write(redo_log &log, BlockNo blockNo, bool wait);
+            static DBMyBufferMgr::WriteAheadState before_block_write(const string &fileName, BlockNo blockNo,
+                                                                      bool wait);
+            void build_worker(DBMyIndexSource &source, atomic<uint> &nextPart, size_t budget,
+                              vector<build_run *> &runs, mutex &runsMutex, exception_ptr &error);
+            void spill_run(vector<pair<DBAttrType *, TID> > &entries, vector<build_run *> &runs, mutex &runsMutex);
+            bool advance_run(build_run &run);
+            void build_leaves(vector<build_run *> &runs, vector<BlockNo> &children, vector<char> &seps,
+                              vector<BlockNo> &written);
+            void build_inner(vector<BlockNo> &children, vector<char> &seps, vector<BlockNo> &written);
+            void discard_build(const vector<BlockNo> &written);
 
 
             uint entriesPerPage() const;
 
-            DBAttrType &first() { return *first_; };
+            uint keySize() const;
+
+            uint entrySize() const;
+
+            bool isComposite() const { return keyTypes.empty() == false; };
+
+            bool isCompressed() const { return attrType == VCHAR && isComposite() == false; };
+
+            bool isNumeric() const { return (attrType == INT || attrType == DOUBLE) && isComposite() == false; };
+
+            DBAttrType &first() { return *cursor().first_; };
 
             DBAttrType &last() { return *last_; };
 
             static LoggerPtr logger;
+            static set<DBMyIndex *> openIndexes;
+            static mutex openIndexesMutex;
+            static map<string, atomic<unsigned long> > structureVersions;
+            static map<string, insert_buffer> insertBuffers;
+            static map<string, key_filter> filters;
+            static map<string, atomic<bool> > countedIndexes;
+            static map<string, key_cache> keyCaches;
+            static map<string, redo_log> redoLogs;
+            static mutex redoLogsMutex;
+            static atomic<unsigned long> instanceCount;
 
             static const BlockNo rootBlockNo;
+            static const BlockNo noBlockNo;
+            // nur bei zusammengesetzten Schluesseln belegt
+            vector<AttrTypeEnum> keyTypes;
+            vector<AttrTypeEnum> includeTypes;
             TID rootTID;
-            stack<DBBACB> bacbStack;
-            DBAttrType *first_;
+            atomic<unsigned long> *structureVersion;
+            insert_buffer *insertBuffer;
+            key_filter *filter;
+            atomic<bool> *counted;
+            key_cache *keyCache;
+            redo_log *redoLog;
+            // Reihen in DBMyLatency
+            uint latencyFindHit;
+            uint latencyFindMiss;
+            uint latencyInsert;
+            uint latencyRemove;
+            // Cursor je Thread, instanceId unterscheidet die Instanz in cursor_owner. cursorsMutex
+            // schuetzt cursors aller Instanzen und liveIndexes (Instanzen mit Cursorn)
+            unsigned long instanceId;
+            static mutex cursorsMutex;
+            static map<unsigned long, DBMyIndex *> liveIndexes;
+            map<thread::id, op_cursor *> cursors;
             DBAttrType *last_;
         };
     }
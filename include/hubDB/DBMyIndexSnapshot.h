@@ -0,0 +1,83 @@
+#ifndef DBMYINDEXSNAPSHOT_H_
+#define DBMYINDEXSNAPSHOT_H_
+
+#include <hubDB/DBIndex.h>
+#include <vector>
+#include <cstdint>
+
+namespace HubDB {
+    namespace Index {
+        // Nur lesbarer Index ueber einer mit DBMyIndex::writeSnapshot() eingefrorenen
+        // Snapshot-Datei; die Datei wird eingeblendet (mmap), Suchen brauchen weder
+        // Puffermanager noch Sperren
+        class DBMyIndexSnapshot : public DBIndex {
+
+        public:
+            DBMyIndexSnapshot(DBBufferMgr &bufferMgr, DBFile &file, enum AttrTypeEnum attrType, ModType mode,
+                              bool unique);
+
+            ~DBMyIndexSnapshot();
+
+            string toString(string linePrefix = "") const;
+
+            void initializeIndex();
+
+            void find(const DBAttrType &val, DBListTID &tids);
+
+            void insert(const DBAttrType &val, const TID &tid);
+
+            void remove(const DBAttrType &val, const DBListTID &tid);
+
+            bool isIndexNonUniqueAble() { return true; };
+
+            void unfixBACBs(bool dirty);
+
+            static int registerClass();
+
+            static string snapshotName(const DBFile &file);
+
+            static void write(const string &path, enum AttrTypeEnum attrType, bool unique, uint keySize,
+                              const vector<char> &keys, const vector<uint64_t> &starts, const vector<TID> &tids);
+
+            static bool syncDirectory(const string &path);
+
+        private:
+            // Kopf der Snapshot-Datei, alle Offsets vom Dateianfang
+            struct file_header {
+                char magic[8];
+                uint32_t version;
+                uint32_t attrType;
+                uint32_t unique;
+                uint32_t keySize;
+                uint64_t keyCount;
+                uint64_t tidCount;
+                uint64_t fenceCount;
+                uint64_t keysOffset;
+                uint64_t startsOffset;
+                uint64_t tidsOffset;
+                uint64_t fencesOffset;
+            };
+
+            int compare(const char *a, const char *b) const;
+            uint64_t lower_key(uint64_t begin, uint64_t end, const char *key) const;
+            void validate() const;
+
+            static LoggerPtr logger;
+
+            static const char magic[8];
+            static const uint32_t formatVersion;
+            static const uint fenceStride;
+            const char *map;
+            size_t mapSize;
+            file_header header;
+            const char *keyArea;
+            const char *startArea;
+            const char *tidArea;
+            const char *fenceArea;
+            const uint keySize;
+        };
+    }
+}
+
+
+#endif /*DBMYINDEXSNAPSHOT_H_*/
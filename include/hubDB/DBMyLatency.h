@@ -0,0 +1,142 @@
+#ifndef DBMYLATENCY_H_
+#define DBMYLATENCY_H_
+
+#include <hubDB/DBTypes.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace HubDB {
+    namespace Manager {
+        // Latenzhistogramm nach Art von HDR: Werte (Nanosekunden) unter subBuckets exakt, darueber
+        // je Zweierpotenz subBuckets gleich breite Klassen, relativer Fehler also hoechstens
+        // 1/subBuckets; Werte ab 2^maxMagnitude landen in der letzten Klasse
+        class DBMyLatencyHistogram {
+
+        public:
+            static const uint subBits = 4;
+            static const uint subBuckets = 1 << subBits;
+            static const uint maxMagnitude = 40;
+            static const uint bucketCount = (maxMagnitude - subBits + 1) * subBuckets;
+
+            DBMyLatencyHistogram();
+
+            void record(uint64_t nanos);
+
+            void merge(const DBMyLatencyHistogram &other);
+
+            uint64_t count() const { return total; };
+
+            uint64_t min() const { return total == 0 ? 0 : minimum; };
+
+            uint64_t max() const { return maximum; };
+
+            double mean() const { return total == 0 ? 0 : (double) sum / total; };
+
+            uint64_t percentile(double q) const;
+
+            string toString(string linePrefix = "") const;
+
+            static uint bucket(uint64_t nanos);
+
+            static uint64_t bucketLimit(uint bucket);
+
+            vector<uint64_t> counts;
+            uint64_t total;
+            uint64_t sum;
+            uint64_t minimum;
+            uint64_t maximum;
+        };
+
+        // Latenzen je Reihe (Operation, Name z.B. der Indexdatei, Ergebnis z.B. hit/miss).
+        // Jeder Thread schreibt ohne Sperre in eigene Histogramme; snapshot() fasst die aller
+        // Threads zusammen (auch beendeter), report() formatiert sie. Der DBMonitorMgr gibt sie
+        // noch nicht aus, dazu muss er report() aufrufen.
+        // Gemessen wird nur nach setEnabled(true), sonst kostet ein Timer keinen Uhrzugriff.
+        class DBMyLatency {
+
+        public:
+            struct Snapshot {
+                string operation;
+                string name;
+                string outcome;
+                DBMyLatencyHistogram histogram;
+            };
+
+            // misst vom Anlegen bis zum Zerstoeren und traegt die Zeit in die Reihe series ein
+            class Timer {
+            public:
+                explicit Timer(uint series) : series(series), running(enabled.load(memory_order_relaxed)) {
+                    if (running)
+                        start = chrono::steady_clock::now();
+                };
+
+                ~Timer() {
+                    if (running)
+                        record(series, chrono::duration_cast<chrono::nanoseconds>(
+                                chrono::steady_clock::now() - start).count());
+                };
+
+                void setSeries(uint series) { this->series = series; };
+
+            private:
+                uint series;
+                bool running;
+                chrono::steady_clock::time_point start;
+            };
+
+            static uint series(const string &operation, const string &name, const string &outcome);
+
+            static void setEnabled(bool enable);
+
+            static bool isEnabled() { return enabled.load(memory_order_relaxed); };
+
+            static void record(uint series, uint64_t nanos);
+
+            static vector<Snapshot> snapshot();
+
+            static void reset();
+
+            static string report(string linePrefix = "");
+
+            static const uint maxSeries = 1024;
+            static const uint noSeries = maxSeries;
+
+        private:
+            // Histogramm, das nur sein Thread schreibt; atomar, damit snapshot() es lesen darf
+            struct live_histogram {
+                atomic<uint64_t> counts[DBMyLatencyHistogram::bucketCount];
+                atomic<uint64_t> sum;
+                atomic<uint64_t> minimum;
+                atomic<uint64_t> maximum;
+
+                live_histogram();
+                void clear();
+                void add_to(DBMyLatencyHistogram &histogram) const;
+            };
+            // Histogramme eines Threads je Reihe, beim Ende des Threads in retired uebernommen
+            struct recorder {
+                atomic<live_histogram *> slots[maxSeries];
+
+                recorder();
+                ~recorder();
+            };
+            struct registry {
+                mutex lock;
+                vector<Snapshot> series;
+                set<recorder *> recorders;
+            };
+
+            static recorder &local();
+            static registry &shared();
+
+            static LoggerPtr logger;
+            static atomic<bool> enabled;
+        };
+    }
+}
+
+#endif /*DBMYLATENCY_H_*/